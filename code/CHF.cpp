@@ -8,6 +8,19 @@
 #pragma package(smart_init)//Ensures that packaged units are initialized in the order determined by their dependencies
 
 #include "CHF.h"
+#include <psapi.h>		// GetProcessMemoryInfo
+#pragma comment(lib, "psapi")//GetProcessMemoryInfo is exported by psapi.dll on older systems
+
+/// \brief Mutex for state of memory budget
+static std::mutex BudgetLock;
+/// \brief Signal about released part of memory budget
+static std::condition_variable BudgetSignal;
+/// \brief Memory budget in bytes (0 - no budget)
+static cnv::qword BudgetLimit = 0;
+/// \brief Leased part of memory budget in bytes
+static cnv::qword BudgetUsed = 0;
+/// \brief Maximum leased part of memory budget in bytes
+static cnv::qword BudgetPeak = 0;
 
 /// \brief Decomposition of path to components returned in the arguments of this function
 /// \param[in] local_Input Path for decomposition
@@ -15,34 +28,7 @@
 /// \param[out] PathOfDirectory Path of directory
 /// \param[out] NameOfFile Name of file without extension
 /// \param[out] ExtensionOfFile Extension of file
-void chf::SplitPath(char* local_Input, char** SymbolOfDisk, char** PathOfDirectory, char** NameOfFile, char** ExtensionOfFile)
-{
-	char _SymbolOfDisk			[MAX_PATH];
-	char _PathOfDirectory		[MAX_PATH];
-	char _NameOfFile			[MAX_PATH];
-	char _ExtensionOfFile		[MAX_PATH];
-	//Separating the path of file - into separate strings (specified in the function parameters)
-	_splitpath(local_Input, _SymbolOfDisk, _PathOfDirectory, _NameOfFile, _ExtensionOfFile);
-	//Drive letter
-	if(SymbolOfDisk != nullptr)
-		*SymbolOfDisk		= strdup((std::string(_SymbolOfDisk)).data());
-	//Path to folder with file
-	if(PathOfDirectory != nullptr)
-		*PathOfDirectory	= strdup((std::string(_PathOfDirectory)).data());
-	//File name
-	if(NameOfFile != nullptr)
-		*NameOfFile 		= strdup((std::string(_NameOfFile)).data());
-	//File extension
-	if(ExtensionOfFile != nullptr)
-		*ExtensionOfFile	= strdup((std::string(_ExtensionOfFile)).data());
-}
-/// \brief Decomposition of path to components returned in the arguments of this function
-/// \param[in] local_Input Path for decomposition
-/// \param[out] SymbolOfDisk Symbol of disk
-/// \param[out] PathOfDirectory Path of directory
-/// \param[out] NameOfFile Name of file without extension
-/// \param[out] ExtensionOfFile Extension of file
-void chf::SplitPath(std::string local_Input, std::string& SymbolOfDisk, std::string& PathOfDirectory, std::string& NameOfFile, std::string& ExtensionOfFile)
+void chf::SplitPath(const std::string& local_Input, std::string& SymbolOfDisk, std::string& PathOfDirectory, std::string& NameOfFile, std::string& ExtensionOfFile)
 {
 	char _SymbolOfDisk			[_MAX_DRIVE];
 	char _PathOfDirectory		[_MAX_DIR];
@@ -153,23 +139,20 @@ cnv::unistr chf::GetExecutableDirectory()
 /// \return File name
 cnv::unistr chf::GetFileName(cnv::unistr local_Input)
 {
-	char* StrBuffer = new char[MAX_PATH];
-	SplitPath(STRINGtoCHAR(USTRINGtoSTRING(local_Input)), nullptr, nullptr, &StrBuffer, nullptr);
-	cnv::unistr local_Output = CHARtoUSTRING(StrBuffer);
-	delete[] StrBuffer; StrBuffer = nullptr;
-	return local_Output;
+	std::string SymbolOfDisk, PathOfDirectory, NameOfFile, ExtensionOfFile;
+	SplitPath(USTRINGtoSTRING(local_Input), SymbolOfDisk, PathOfDirectory, NameOfFile, ExtensionOfFile);
+	return STRINGtoUSTRING(NameOfFile);
 }
 /// \brief Get file extension from the path
 /// \param[in] local_Input File path
 /// \return File extension
 cnv::unistr chf::GetFileExtension(cnv::unistr local_Input)
 {
-	char* StrBuffer = new char[MAX_PATH];
-	SplitPath(STRINGtoCHAR(USTRINGtoSTRING(local_Input)), nullptr, nullptr, nullptr, &StrBuffer);
-	cnv::unistr local_Output = CHARtoUSTRING(StrBuffer);
-	local_Output.Delete0(0, 1);//Removes the first character (null) from UnicodeString. '1' here is equal to number of characters to be deleted
-	delete[] StrBuffer; StrBuffer = nullptr;
-	return local_Output;
+	std::string SymbolOfDisk, PathOfDirectory, NameOfFile, ExtensionOfFile;
+	SplitPath(USTRINGtoSTRING(local_Input), SymbolOfDisk, PathOfDirectory, NameOfFile, ExtensionOfFile);
+	if(!ExtensionOfFile.empty())
+		ExtensionOfFile.erase(0, 1);//Removes the dot before extension
+	return STRINGtoUSTRING(ExtensionOfFile);
 }
 /// \brief Get file size
 /// \param[in] local_Input File descriptor
@@ -181,18 +164,18 @@ cnv::dword chf::GetFileSize(FILE* local_Input)
 /// \brief Get file size
 /// \param[in] local_Input File stream
 /// \return File size
-cnv::dword chf::GetFileSize(ifstream& local_Input)
+cnv::qword chf::GetFileSize(ifstream& local_Input)
 {
 	std::streamoff pos = local_Input.tellg();
 	local_Input.seekg(0, local_Input.end);
 	std::streamoff fsize = local_Input.tellg();
 	local_Input.seekg(pos, local_Input.beg);
-	return static_cast<cnv::dword>(fsize);
+	return static_cast<cnv::qword>(fsize);
 }
 /// \brief Get file size
 /// \param[in] local_Input Path to file
 /// \return File size (or 0 - if file can't be open or not exist)
-cnv::dword chf::GetFileSize(std::string local_Input)
+cnv::qword chf::GetFileSize(std::string local_Input)
 {
 	ifstream InputFile;
 	InputFile.open(local_Input, ios::in|ios::binary);
@@ -201,28 +184,23 @@ cnv::dword chf::GetFileSize(std::string local_Input)
 		InputFile.seekg(0, InputFile.end);
 		std::streamoff fsize = InputFile.tellg();
 		InputFile.close();
-		return static_cast<cnv::dword>(fsize);
+		return static_cast<cnv::qword>(fsize);
 	}
 	return 0;
 }
 /// \brief Get full path to a file based on the path to the executable
 /// \param[in] local_Input Path to the file to restore
-/// \return Full path to the file
-char* chf::GetFullPath(char* local_Input)
-{
-	std::string local_Output; local_Output.resize(MAX_PATH);
-	std::string SymbolOfDisk; SymbolOfDisk.resize(_MAX_DRIVE);
-	std::string PathOfDirectory; PathOfDirectory.resize(_MAX_DIR);
-	std::string NameOfFile; NameOfFile.resize(_MAX_DIR);
-	std::string ExtensionOfFile; ExtensionOfFile.resize(_MAX_EXT);
+/// \return Full path to the file (path with disk symbol is returned unchanged)
+std::string chf::GetFullPath(const std::string& local_Input)
+{
+	std::string SymbolOfDisk, PathOfDirectory, NameOfFile, ExtensionOfFile;
 	SplitPath(local_Input, SymbolOfDisk, PathOfDirectory, NameOfFile, ExtensionOfFile);
 	if(SymbolOfDisk.size() != 2)
 	{
 		wchar_t ExecutableFile[MAX_PATH];
 		GetModuleFileName(GetModuleHandle(nullptr), ExecutableFile, MAX_PATH);//Get path for the executable file
 		PathRemoveFileSpec(ExecutableFile);//Strip file name
-		local_Output = WCHARTtoSTRING(ExecutableFile) + "\\" + NameOfFile + ExtensionOfFile;
-		return local_Output.data();
+		return WCHARTtoSTRING(ExecutableFile) + "\\" + NameOfFile + ExtensionOfFile;
 	}
 	return local_Input;
 }
@@ -246,7 +224,7 @@ bool chf::IsDirectoryExists(const wchar_t* local_Input)
 /// \return True - if exists, False - otherwise
 bool chf::IsDirectoryExists(const char* local_Input)
 {
-	DWORD Flag = GetFileAttributes(CONSTCHARtoCONSTWCHART(local_Input));
+	DWORD Flag = GetFileAttributesA(local_Input);
 	if(Flag == 0xFFFFFFFFUL)
 	{
 		if(GetLastError() == ERROR_FILE_NOT_FOUND || GetLastError() == ERROR_PATH_NOT_FOUND)
@@ -259,15 +237,336 @@ bool chf::IsDirectoryExists(const char* local_Input)
 /// \brief Check if a directory exists
 /// \param[in] local_Input Path to the directory
 /// \return True - if exists, False - otherwise
-bool chf::IsDirectoryExists(std::string local_Input)
+bool chf::IsDirectoryExists(const std::string& local_Input)
 {
-	DWORD Flag = GetFileAttributes(STRINGtoCONSTWCHART(local_Input));
-	if(Flag == 0xFFFFFFFFUL)
+	return IsDirectoryExists(local_Input.c_str());
+}
+/// \brief Check that character separates components of path
+/// \param[in] local_Input Character
+/// \return True - if character is separator
+bool chf::IsSeparator(char local_Input)
+{
+	return local_Input == '\\' || local_Input == '/';
+}
+/// \brief Get directory of the path (without copying)
+/// \param[in] local_Input Path
+/// \return Part of path up to and including the last separator (or disk symbol); empty - if path has no directory
+chf::PathPart chf::GetDirectoryPart(const std::string& local_Input)
+{
+	cnv::unsint Size = static_cast<cnv::unsint>(local_Input.size());
+	while(Size > 0 && !IsSeparator(local_Input[Size - 1]) && local_Input[Size - 1] != ':')
+		Size--;
+	return {local_Input.data(), Size};
+}
+/// \brief Get file name with extension of the path (without copying)
+/// \param[in] local_Input Path
+/// \return Part of path after the directory
+chf::PathPart chf::GetNamePart(const std::string& local_Input)
+{
+	PathPart Directory = GetDirectoryPart(local_Input);
+	return {local_Input.data() + Directory.Size, static_cast<cnv::unsint>(local_Input.size()) - Directory.Size};
+}
+/// \brief Build path from two parts in the arena
+/// \param[in,out] Arena Arena whose path is replaced (its capacity is reused)
+/// \param[in] Head First part of the path (e.g. output directory with trailing separator)
+/// \param[in] Tail Second part of the path (e.g. path of file-entry)
+/// \return Built path (valid until the next use of the arena)
+const std::string& chf::JoinPath(PathArena& Arena, PathPart Head, PathPart Tail)
+{
+	Arena.Path.assign(Head.Data, Head.Size);
+	Arena.Path.append(Tail.Data, Tail.Size);
+	return Arena.Path;
+}
+/// \brief Create all directories of the path built in the arena
+/// \param[in,out] Arena Arena with built path (path of file, its last component is not created)
+/// \param[in] From Directories ending before this position are assumed to exist
+/// \return Error code: 0 - no errors, 1 - operation error (path of the arena is cut to the directory which can't be created)
+/// \details Directories of the previous call are remembered, so entries of the same directory don't touch the file system
+int chf::CreateDirectories(PathArena& Arena, cnv::unsint From)
+{
+	std::string& Path = Arena.Path;
+	cnv::unsint End = GetDirectoryPart(Path).Size;
+	//Skip directories shared with the previous call (they are created already)
+	cnv::unsint Known = 0;
+	while(Known < End && Known < Arena.Created.size() && Path[Known] == Arena.Created[Known])
+		Known++;
+	if(Known == End)
+		return 0;
+	for(cnv::unsint i = From; i < End; i++)
 	{
-		if(GetLastError() == ERROR_FILE_NOT_FOUND || GetLastError() == ERROR_PATH_NOT_FOUND)
-            return false;
-    }
-	if(!(Flag & FILE_ATTRIBUTE_DIRECTORY))
+		if(!IsSeparator(Path[i]) || i < Known)
+			continue;
+		//Directory is terminated in place, so no copy of the path is made
+		char Separator = Path[i];
+		Path[i] = '\0';
+		CreateDirectoryA(Path.c_str(), nullptr);
+		bool Exists = IsDirectoryExists(Path.c_str());
+		Path[i] = Separator;
+		if(!Exists)
+		{
+			Arena.Created.clear();
+			Path.resize(i);
+			return 1;
+		}
+	}
+	Arena.Created.assign(Path, 0, End);
+	return 0;
+}
+/// \brief Get file size with single metadata request (file is not opened)
+/// \param[in] local_Input Path to file
+/// \param[out] Size File size (0 - if file does not exist)
+/// \return True - if file exists (and it is not a directory), False - otherwise
+bool chf::GetFileStat(const std::string& local_Input, cnv::qword& Size)
+{
+	WIN32_FILE_ATTRIBUTE_DATA Data;
+	Size = 0;
+	if(!GetFileAttributesExA(local_Input.data(), GetFileExInfoStandard, &Data))
 		return false;
+	if(Data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		return false;
+	Size = (static_cast<cnv::qword>(Data.nFileSizeHigh) << 32) | Data.nFileSizeLow;
 	return true;
 }
+/// \brief Check if path matches wildcard pattern (case and separators are ignored)
+/// \param[in] local_Input Path
+/// \param[in] Pattern Pattern ('*' - any sequence of characters including separators, '?' - any single character)
+/// \return True - if path matches, False - otherwise
+bool chf::MatchPattern(std::string local_Input, std::string Pattern)
+{
+	cnv::unsint i = 0;
+	cnv::unsint j = 0;
+	cnv::unsint StarPattern = 0;
+	cnv::unsint StarInput = 0;
+	bool Star = false;
+	auto Normal = [](char Symbol)
+	{
+		return (Symbol == '/') ? '\\' : static_cast<char>(tolower(Symbol));
+	};
+	while(i < local_Input.size())
+	{
+		if(j < Pattern.size() && Pattern.at(j) == '*')
+		{
+			//Remember position of the star and try to match it with empty sequence
+			Star = true;
+			StarPattern = ++j;
+			StarInput = i;
+		}
+		else if(j < Pattern.size() && (Pattern.at(j) == '?' || Normal(Pattern.at(j)) == Normal(local_Input.at(i))))
+		{
+			i++;
+			j++;
+		}
+		else if(Star)
+		{
+			//Star takes one more character
+			j = StarPattern;
+			i = ++StarInput;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	while(j < Pattern.size() && Pattern.at(j) == '*')
+	{
+		j++;
+	}
+	return j == Pattern.size();
+}
+/// \brief Append DWORD to byte buffer (little-endian)
+/// \param[out] local_Output Byte buffer
+/// \param[in] local_Input DWORD value
+void chf::PutDword(std::vector<cnv::byte>& local_Output, cnv::dword local_Input)
+{
+	for(int j = 0; j < 4; j++)
+	{
+		local_Output.push_back(static_cast<cnv::byte>(local_Input >> 8 * j));
+	}
+}
+/// \brief Append QWORD to byte buffer (little-endian)
+/// \param[out] local_Output Byte buffer
+/// \param[in] local_Input QWORD value
+void chf::PutQword(std::vector<cnv::byte>& local_Output, cnv::qword local_Input)
+{
+	for(int j = 0; j < 8; j++)
+	{
+		local_Output.push_back(static_cast<cnv::byte>(local_Input >> 8 * j));
+	}
+}
+/// \brief Calculate hash of data block (FNV-1a, 64 bit)
+/// \param[in] local_Input Data block
+/// \param[in] Size Size of data block
+/// \param[in] Seed Initial value (result of previous call to continue hashing of the data stream)
+/// \return Hash value
+cnv::qword chf::HashData(const cnv::byte* local_Input, cnv::unsint Size, cnv::qword Seed)
+{
+	cnv::qword local_Output = Seed;
+	for(cnv::unsint i = 0; i < Size; i++)
+	{
+		local_Output ^= local_Input[i];
+		local_Output *= 0x100000001B3ULL;
+	}
+	return local_Output;
+}
+/// \brief Get amount of worker threads for parallel operations
+/// \return Amount of worker threads (at least 1)
+cnv::unsint chf::GetWorkerCount()
+{
+	cnv::unsint local_Output = std::thread::hardware_concurrency();
+	if(local_Output == 0)
+	{
+		local_Output = 1;
+	}
+	return local_Output;
+}
+/// \brief Execute task for each index in range [0, Amount) on worker threads
+/// \param[in] Amount Number of tasks
+/// \param[in] Task Function called for each task index (second argument - number of worker, less than GetWorkerCount())
+/// \details Indexes are handed out through shared counter, so long tasks don't hold back the rest of the range
+void chf::ParallelFor(cnv::unsint Amount, std::function<void(cnv::unsint, cnv::unsint)> Task)
+{
+	cnv::unsint Workers = GetWorkerCount();
+	if(Workers > Amount)
+	{
+		Workers = Amount;
+	}
+	if(Workers <= 1)
+	{
+		for(cnv::unsint i = 0; i < Amount; i++)
+		{
+			Task(i, 0);
+		}
+		return;
+	}
+	std::atomic<cnv::unsint> Counter(0);
+	std::vector<std::thread> Pool;
+	for(cnv::unsint w = 0; w < Workers; w++)
+	{
+		Pool.push_back(std::thread([&Counter, &Task, Amount, w]()
+		{
+			for(cnv::unsint i = Counter++; i < Amount; i = Counter++)
+			{
+				Task(i, w);
+			}
+		}));
+	}
+	for(cnv::unsint w = 0; w < Workers; w++)
+	{
+		Pool.at(w).join();
+	}
+}
+/// \brief Setting memory budget shared by all leases
+/// \param[in] local_Input Budget in bytes (0 - no budget, leases are only counted)
+void chf::SetMemoryLimit(cnv::qword local_Input)
+{
+	std::lock_guard<std::mutex> Lock(BudgetLock);
+	BudgetLimit = local_Input;
+	BudgetSignal.notify_all();
+}
+/// \brief Getting memory budget
+/// \return Budget in bytes (0 - no budget)
+cnv::qword chf::GetMemoryLimit()
+{
+	std::lock_guard<std::mutex> Lock(BudgetLock);
+	return BudgetLimit;
+}
+/// \brief Getting maximum amount of memory leased at the same time
+/// \return Size in bytes
+cnv::qword chf::GetPeakLeased()
+{
+	std::lock_guard<std::mutex> Lock(BudgetLock);
+	return BudgetPeak;
+}
+/// \brief Getting peak resident memory of the process (peak working set)
+/// \return Size in bytes (0 - if it can't be received)
+cnv::qword chf::GetPeakMemory()
+{
+	PROCESS_MEMORY_COUNTERS Counters;
+	if(!GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters)))
+	{
+		return 0;
+	}
+	return Counters.PeakWorkingSetSize;
+}
+/// \brief Changing leased size, waiting while the budget is exhausted by other leases
+/// \param[in] local_Input New leased size in bytes
+void chf::MemoryLease::Acquire(cnv::qword local_Input)
+{
+	std::unique_lock<std::mutex> Lock(BudgetLock);
+	BudgetSignal.wait(Lock, [this, local_Input]()
+	{
+		return local_Input <= Size || BudgetLimit == 0 || BudgetUsed - Size + local_Input <= BudgetLimit || BudgetUsed == Size;
+	});
+	BudgetUsed = BudgetUsed - Size + local_Input;
+	Size = local_Input;
+	if(BudgetUsed > BudgetPeak)
+	{
+		BudgetPeak = BudgetUsed;
+	}
+	BudgetSignal.notify_all();
+}
+/// \brief Changing leased size without waiting
+/// \param[in] local_Input New leased size in bytes
+/// \return True - size is leased, False - budget is exhausted (leased size is not changed)
+/// \details Used by sequential code, which can hold other leases itself and must not wait for them
+bool chf::MemoryLease::TryAcquire(cnv::qword local_Input)
+{
+	std::lock_guard<std::mutex> Lock(BudgetLock);
+	if(local_Input > Size && BudgetLimit != 0 && BudgetUsed - Size + local_Input > BudgetLimit)
+	{
+		return false;
+	}
+	BudgetUsed = BudgetUsed - Size + local_Input;
+	Size = local_Input;
+	if(BudgetUsed > BudgetPeak)
+	{
+		BudgetPeak = BudgetUsed;
+	}
+	BudgetSignal.notify_all();
+	return true;
+}
+/// \brief Returning leased size to the budget
+void chf::MemoryLease::Release()
+{
+	if(Size == 0)
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> Lock(BudgetLock);
+	BudgetUsed -= Size;
+	Size = 0;
+	BudgetSignal.notify_all();
+}
+/// \brief Setting data read through the buffer
+/// \param[in] local_Input Data in memory
+/// \param[in] Size Size of data
+void chf::MemoryBuffer::Assign(const cnv::byte* local_Input, cnv::qword Size)
+{
+	char* Begin = const_cast<char*>(reinterpret_cast<const char*>(local_Input));
+	setg(Begin, Begin, Begin + Size);
+}
+/// \brief Moving read position relative to beginning, current position or end of data
+/// \param[in] Offset Offset of new position
+/// \param[in] Direction Base of the offset
+/// \param[in] Mode Only input mode is supported
+/// \return New position or -1 if it lies outside the data
+std::streambuf::pos_type chf::MemoryBuffer::seekoff(off_type Offset, std::ios_base::seekdir Direction, std::ios_base::openmode Mode)
+{
+	off_type Position = Offset;
+	if(Direction == std::ios_base::cur)
+		Position += gptr() - eback();
+	else if(Direction == std::ios_base::end)
+		Position += egptr() - eback();
+	if(!(Mode & std::ios_base::in) || Position < 0 || Position > egptr() - eback())
+		return pos_type(off_type(-1));
+	setg(eback(), eback() + Position, egptr());
+	return pos_type(Position);
+}
+/// \brief Moving read position relative to beginning of data
+/// \param[in] Position New position
+/// \param[in] Mode Only input mode is supported
+/// \return New position or -1 if it lies outside the data
+std::streambuf::pos_type chf::MemoryBuffer::seekpos(pos_type Position, std::ios_base::openmode Mode)
+{
+	return seekoff(off_type(Position), std::ios_base::beg, Mode);
+}
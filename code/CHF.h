@@ -7,17 +7,76 @@
 #define CHFH
 
 #include <stdlib.h> 	// _splitpath
-#include <string> 		// strdup
+#include <string>
 #include <io.h>         // filelength
 #include <fstream>
+#include <thread>		// std::thread
+#include <atomic>		// std::atomic
+#include <mutex>		// std::mutex
+#include <condition_variable>	// std::condition_variable
+#include <functional>	// std::function
+#include <vector>
+#include <streambuf>	// std::streambuf
 #pragma hdrstop//This directive terminates the list of header files eligible for precompilation (Using ONLY for <standard> headers, no "custom")
 
 #include "Conversion.h"
 
 namespace chf
 {
-	void		SplitPath(char*, char**, char**, char**, char**);
-	void		SplitPath(std::string, std::string&, std::string&, std::string&, std::string&);
+	/// \brief Part of path referring to characters of another string (nothing is copied, valid while that string is unchanged)
+	struct PathPart
+	{
+		/// \brief First character
+		const char* Data;
+		/// \brief Number of characters
+		cnv::unsint Size;
+	};
+
+	/// \brief Reusable buffers for building paths of one worker
+	/// \details Strings keep their capacity between calls, so after the longest path is built no more heap allocation is made
+	struct PathArena
+	{
+		/// \brief Built path
+		std::string Path;
+		/// \brief Directory part of the path for which CreateDirectories was called last
+		std::string Created;
+	};
+
+	/// \brief Read-only stream buffer over data in memory (data is not copied, it must live while the buffer is used)
+	/// \details Used to read archive decoded into memory with the same stream functions as archive file
+	class MemoryBuffer : public std::streambuf
+	{
+		public:
+		void Assign(const cnv::byte*, cnv::qword);
+
+		protected:
+		pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode) override;
+		pos_type seekpos(pos_type, std::ios_base::openmode) override;
+	};
+
+	/// \brief Part of process-wide memory budget held by one user (released on destruction)
+	/// \details Budget is shared by buffers of packing and unpacking and by work in flight on worker threads.
+	/// Acquire waits while other leases exhaust the budget (backpressure); lease larger than the whole budget
+	/// is granted when nothing else is held, so a single large entry can't stop the run. Without budget nothing waits
+	class MemoryLease
+	{
+		private:
+		/// \brief Leased size in bytes
+		cnv::qword Size;
+
+		public:
+		MemoryLease() : Size(0) {}
+		explicit MemoryLease(cnv::qword local_Input) : Size(0) {Acquire(local_Input);}
+		~MemoryLease() {Release();}
+		MemoryLease(const MemoryLease&) = delete;
+		MemoryLease& operator=(const MemoryLease&) = delete;
+		void		Acquire(cnv::qword);
+		bool		TryAcquire(cnv::qword);
+		void		Release();
+		cnv::qword	GetSize() const {return Size;}
+	};
+
+	void		SplitPath(const std::string&, std::string&, std::string&, std::string&, std::string&);
 	cnv::unsint	SizeOfVector(char*);
 	cnv::unsint	SizeOfVector(const char*);
 	cnv::unsint	SizeOfArray(const char[]);
@@ -27,11 +86,27 @@ namespace chf
 	cnv::unistr	GetFileName(cnv::unistr);
 	cnv::unistr	GetFileExtension(cnv::unistr);
 	cnv::dword	GetFileSize(FILE*);
-	cnv::dword	GetFileSize(ifstream&);
-    cnv::dword	GetFileSize(std::string);
-	char*		GetFullPath(char*);
+	cnv::qword	GetFileSize(ifstream&);
+    cnv::qword	GetFileSize(std::string);
+	std::string	GetFullPath(const std::string&);
 	bool		IsDirectoryExists(const wchar_t*);
 	bool		IsDirectoryExists(const char*);
-	bool		IsDirectoryExists(std::string);
+	bool		IsDirectoryExists(const std::string&);
+	bool		IsSeparator(char);
+	PathPart	GetDirectoryPart(const std::string&);
+	PathPart	GetNamePart(const std::string&);
+	const std::string& JoinPath(PathArena&, PathPart, PathPart);
+	int			CreateDirectories(PathArena&, cnv::unsint);
+	bool		GetFileStat(const std::string&, cnv::qword&);
+	bool		MatchPattern(std::string, std::string);
+	void		PutDword(std::vector<cnv::byte>&, cnv::dword);
+	void		PutQword(std::vector<cnv::byte>&, cnv::qword);
+	cnv::qword	HashData(const cnv::byte*, cnv::unsint, cnv::qword = 0xCBF29CE484222325ULL);
+	cnv::unsint	GetWorkerCount();
+	void		ParallelFor(cnv::unsint, std::function<void(cnv::unsint, cnv::unsint)>);
+	void		SetMemoryLimit(cnv::qword);
+	cnv::qword	GetMemoryLimit();
+	cnv::qword	GetPeakLeased();
+	cnv::qword	GetPeakMemory();
 }
 #endif
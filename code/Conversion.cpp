@@ -36,10 +36,7 @@ std::string 	WCHARTtoSTRING		(wchar_t* local_Input)
 /// \return Output value
 const char* 	STRINGtoCONSTCHAR	(std::string local_Input)
 {
-	char* StrBuffer = new char[local_Input.size() + 1];
-	StrBuffer = strdup(local_Input.data());
-	const char* local_Output = StrBuffer;
-	return local_Output;
+	return strdup(local_Input.data());
 }
 /// \brief Conversion from int to char*
 /// \param[in] local_Input Input value to be converted
@@ -70,26 +67,25 @@ cnv::unistr		CHARtoUSTRING       (char* local_Input)
 	cnv::unistr local_Output = StrBuffer.data();
 	return local_Output;
 }
-/// \brief Conversion from const char* to const wchar_t*
+/// \brief Conversion from const char* to wide string (const wchar_t* is taken by c_str() and lives with the returned string)
 /// \param[in] local_Input Input value to be converted
 /// \return Output value
-const wchar_t* CONSTCHARtoCONSTWCHART(const char* local_Input)
+std::wstring	CONSTCHARtoCONSTWCHART(const char* local_Input)
 {
-	const size_t Size = strlen(local_Input) + 1;
-	wchar_t* local_Output = new wchar_t[Size];
-	mbstowcs(local_Output, local_Input, Size);
+	std::wstring local_Output(strlen(local_Input), L'\0');
+	if(!local_Output.empty())
+	{
+		const size_t Size = mbstowcs(&local_Output[0], local_Input, local_Output.size());
+		local_Output.resize(Size == static_cast<size_t>(-1) ? 0 : Size);//Invalid multibyte sequence gives an empty string
+	}
 	return local_Output;
 }
-/// \brief Conversion from std::string to const wchar_t*
+/// \brief Conversion from std::string to wide string (const wchar_t* is taken by c_str() and lives with the returned string)
 /// \param[in] local_Input Input value to be converted
 /// \return Output value
-const wchar_t* 	STRINGtoCONSTWCHART	(std::string local_Input)
+std::wstring 	STRINGtoCONSTWCHART	(const std::string& local_Input)
 {
-	char* StrBuffer = new char[local_Input.size() + 1];
-	StrBuffer = strdup(local_Input.data());
-	wchar_t* local_Output = new wchar_t[local_Input.size()];
-	mbstowcs(local_Output, StrBuffer, local_Input.size());
-	return local_Output;
+	return CONSTCHARtoCONSTWCHART(local_Input.c_str());
 }
 /// \brief Conversion from UnicodeString to char*
 /// \param[in] local_Input Input value to be converted
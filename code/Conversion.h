@@ -21,6 +21,8 @@ namespace cnv
 	typedef unsigned short      word;
 	/// \brief Dword implementation (4 bytes)
 	typedef unsigned long       dword;
+	/// \brief Qword implementation (8 bytes)
+	typedef unsigned long long	qword;
 	/// \brief Unsigned alias for int
 	typedef unsigned int		unsint;
 }
@@ -32,8 +34,8 @@ const char* 	STRINGtoCONSTCHAR		(std::string);
 char* 			INTtoCHAR				(int);
 std::string		INTtoSTRING				(int);
 cnv::unistr		CHARtoUSTRING       	(char*);
-const wchar_t* 	CONSTCHARtoCONSTWCHART	(const char*);
-const wchar_t* 	STRINGtoCONSTWCHART		(std::string);
+std::wstring 	CONSTCHARtoCONSTWCHART	(const char*);
+std::wstring 	STRINGtoCONSTWCHART		(const std::string&);
 char* 			USTRINGtoCHAR			(cnv::unistr);
 cnv::unistr		STRINGtoUSTRING         (std::string);
 cnv::unistr		INTtoUSTRING         	(int);
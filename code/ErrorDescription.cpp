@@ -10,8 +10,14 @@
 
 #include "ErrorDescription.h"
 
-/// \brief Instance of structure to store error information
+/// \brief Instance of structure to store error information (the last error of the program, shown by the console)
 ErrorData LastError;
+/// \brief Mutex for LastError (errors can be sent from worker threads)
+std::mutex LastErrorMutex;
+/// \brief The last error of the current thread
+static thread_local ErrorData ThreadError;
+/// \brief Ordinal number of file-entry processed by the current thread
+static thread_local cnv::qword ThreadEntry = ErrorNoEntry;
 
 /// \brief The function to handle error message
 /// \param[in] FILE Module name
@@ -20,11 +26,9 @@ ErrorData LastError;
 /// \param[in] Index Error index
 /// \param[in] DeSet Active array number
 /// \param[in] Add Additional error information
-void SendAlert(const char* FILE, const char FUNC[], int LINE, cnv::unsint Index, cnv::unsint DeSet, std::string Add)
+void SendAlert(const char* FILE, const char FUNC[], int LINE, cnv::unsint Index, cnv::unsint DeSet, const std::string& Add)
 {
-	LastError.Additional = new char[MAX_PATH];
-	strncpy(LastError.Additional, Add.data(), Add.size());
-	AlertControl(FILE, FUNC, LINE, Index, DeSet);
+	AlertControl(FILE, FUNC, LINE, Index, DeSet, Add.data(), Add.size());
 }
 /// \brief The function to handle error message
 /// \param[in] FILE Module name
@@ -32,13 +36,10 @@ void SendAlert(const char* FILE, const char FUNC[], int LINE, cnv::unsint Index,
 /// \param[in] LINE Line number in the module
 /// \param[in] Index Error index
 /// \param[in] DeSet Active array number
-/// \param[in] Add Additional error information
-void SendAlert(const char* FILE, const char FUNC[], int LINE, cnv::unsint Index, cnv::unsint DeSet, char* Add)
+/// \param[in] Add Additional error information (may be nullptr)
+void SendAlert(const char* FILE, const char FUNC[], int LINE, cnv::unsint Index, cnv::unsint DeSet, const char* Add)
 {
-	LastError.Additional = new char[MAX_PATH];
-	if(Add != nullptr)
-		strncpy(LastError.Additional, Add, chf::SizeOfVector(Add));
-	AlertControl(FILE, FUNC, LINE, Index, DeSet);
+	AlertControl(FILE, FUNC, LINE, Index, DeSet, Add, (Add != nullptr) ? strlen(Add) : 0);
 }
 /// \brief The function to handle error message
 /// \param[in] FILE Module name
@@ -49,9 +50,8 @@ void SendAlert(const char* FILE, const char FUNC[], int LINE, cnv::unsint Index,
 /// \param[in] Add Additional error information
 void SendAlert(const char* FILE, const char FUNC[], int LINE, cnv::unsint Index, cnv::unsint DeSet, cnv::unistr Add)
 {
-	LastError.Additional = new char[MAX_PATH];
-	LastError.Additional = USTRINGtoCHAR(Add);
-	AlertControl(FILE, FUNC, LINE, Index, DeSet);
+	std::string Buffer = USTRINGtoSTRING(Add);
+	AlertControl(FILE, FUNC, LINE, Index, DeSet, Buffer.data(), Buffer.size());
 }
 /// \brief Error handling control function
 /// \param[in] FILE Module name
@@ -59,16 +59,109 @@ void SendAlert(const char* FILE, const char FUNC[], int LINE, cnv::unsint Index,
 /// \param[in] LINE Line number in the module
 /// \param[in] Index Error index
 /// \param[in] DeSet Active array number
-void AlertControl(const char* FILE, const char FUNC[], int LINE, cnv::unsint Index, cnv::unsint DeSet)
+/// \param[in] Add Additional error information
+/// \param[in] AddSize Length of additional error information
+/// \details Error is saved into error of the current thread without memory allocation and becomes the last error of the program
+void AlertControl(const char* FILE, const char FUNC[], int LINE, cnv::unsint Index, cnv::unsint DeSet, const char* Add, cnv::unsint AddSize)
+{
+	if(AddSize > MAX_PATH - 1)
+		AddSize = MAX_PATH - 1;
+	ThreadError.File = FILE;
+	ThreadError.Function = FUNC;
+	ThreadError.Line = LINE;
+	ThreadError.ErrorIndex = Index;
+	ThreadError.DescriptionSet = DeSet;
+	ThreadError.EntryIndex = ThreadEntry;
+	if(AddSize != 0)
+		memcpy(ThreadError.Additional, Add, AddSize);
+	ThreadError.Additional[AddSize] = 0;
+
+	std::lock_guard<std::mutex> Lock(LastErrorMutex);
+	LastError = ThreadError;
+}
+/// \brief Get the last error of the current thread
+/// \return Error data (ErrorIndex 0 - no errors since the last clearing)
+ErrorData& GetThreadError()
+{
+	return ThreadError;
+}
+/// \brief Clearing the last error of the program and of the current thread
+void ClearError()
+{
+	ClearThreadError();
+	std::lock_guard<std::mutex> Lock(LastErrorMutex);
+	LastError = ThreadError;
+}
+/// \brief Clearing the last error of the current thread
+/// \details Called when worker thread starts a task, so a failed task doesn't report error left by previous one
+void ClearThreadError()
+{
+	ThreadError = ErrorData();
+	ThreadError.EntryIndex = ErrorNoEntry;
+}
+
+
+/// \brief Marking errors of the current thread with ordinal number of file-entry
+/// \param[in] local_Input Ordinal number of file-entry
+/// \details Error of the current thread is cleared: errors of previous file-entries must not be reported for this one
+ErrorEntry::ErrorEntry(cnv::qword local_Input)
+{
+	ClearThreadError();
+	Previous = ThreadEntry;
+	ThreadEntry = local_Input;
+}
+/// \brief Restoring ordinal number of file-entry which was set before
+ErrorEntry::~ErrorEntry()
 {
-	LastError.File		= new char[MAX_PATH];
-	LastError.Function	= new char[MAX_PATH];
-	LastError.Line		= new char[MAX_PATH];
-	strncpy(LastError.File,		FILE, chf::SizeOfVector(FILE));
-	strncpy(LastError.Function,	FUNC, chf::SizeOfArray(FUNC));
-	strncpy(LastError.Line,		INTtoCHAR(LINE), chf::SizeOfVector(INTtoCHAR(LINE)));
-	LastError.ErrorIndex = Index;
-	LastError.DescriptionSet = DeSet;
+	ThreadEntry = Previous;
+}
+
+
+/// \brief Saving the last errors of the program and of the current thread
+ErrorCheckpoint::ErrorCheckpoint()
+{
+	SavedThread = ThreadError;
+	std::lock_guard<std::mutex> Lock(LastErrorMutex);
+	SavedLast = LastError;
+}
+/// \brief Discarding error sent by the current thread after the checkpoint
+/// \details The last error of the program is restored only if it is still the error of this thread, so error sent by
+/// other thread meanwhile is kept
+void ErrorCheckpoint::Rollback()
+{
+	std::lock_guard<std::mutex> Lock(LastErrorMutex);
+	if(LastError.Line == ThreadError.Line && LastError.ErrorIndex == ThreadError.ErrorIndex && LastError.EntryIndex == ThreadError.EntryIndex &&
+		LastError.File == ThreadError.File && strcmp(LastError.Additional, ThreadError.Additional) == 0)
+		LastError = SavedLast;
+	ThreadError = SavedThread;
+}
+
+
+/// \brief Adding the last error of the current thread to the batch
+void ErrorBatch::AddThreadError()
+{
+	std::lock_guard<std::mutex> BatchLock(Lock);
+	if(Amount == 0 || ThreadError.EntryIndex < First.EntryIndex)
+		First = ThreadError;
+	Amount++;
+}
+/// \brief Making reported error of the batch the last error of the program
+/// \details Amount of other errors is appended to additional error information
+void ErrorBatch::Publish()
+{
+	std::lock_guard<std::mutex> BatchLock(Lock);
+	if(Amount == 0)
+		return;
+	ErrorData Output = First;
+	if(Amount > 1)
+	{
+		std::string More = " (and " + INTtoSTRING(static_cast<int>(Amount - 1)) + " more)";
+		cnv::unsint Size = strlen(Output.Additional);
+		if(Size + More.size() < MAX_PATH)
+			memcpy(Output.Additional + Size, More.data(), More.size() + 1);
+	}
+	std::lock_guard<std::mutex> ErrorLock(LastErrorMutex);
+	LastError = Output;
 }
 
 /// \brief Vector containing description of errors for FstFile
@@ -108,5 +201,45 @@ std::vector<std::string> FstFileErrorDescription =
 		"ReadStream - Read error on input operation.", "Logic error",
 		"The file data ended before data block was read. The file is corrupted.", "File error",
 		"ReadStream - Logical error on input operation.", "Logic error",
-		"ReadStream - Read error on input operation.", "Logic error"
+		"ReadStream - Read error on input operation.", "Logic error",
+/*35*/	"Violating boundaries of the table of contents (Attempted to read outside the list limits).", "Logic error",
+		"Data of file-entry lies outside the archive file. The file is corrupted.", "File error",
+		"The decompressed sizes of file and file-entry do not match.", "File error",
+		"Can't open input archive file. File does not exist or is locked. (Or the file path contains Unicode characters.)", "File error",
+		"Can't open output file.", "File error",
+/*40*/	"Can't open patch file. File does not exist or is locked. (Or the file path contains Unicode characters.)", "File error",
+		"The file is not a patch for FST archives or has unsupported version.", "File error",
+		"The patch does not match the source archive (size or checksum differs).", "Logic error",
+		"The patch contains invalid instruction. The file is corrupted.", "File error",
+		"The rebuilt archive does not match the patch checksum.", "File error",
+/*45*/	"File limit exceeded. Files larger than 4 GB can't be stored in the archive.", "File error",
+		"Can't open rules file. File does not exist or is locked. (Or the file path contains Unicode characters.)", "File error",
+		"Rules read error. Incorrect rule. Check if the rule is entered correctly.", "File error",
+		"Path of file-entry is longer than 249 characters and can't be stored in the archive.", "File error",
+		"Unsupported version of extended archive (FST64).", "File error",
+/*50*/	"Table of contents lies outside the archive file. The file is corrupted.", "File error",
+		"Archive size exceeds 4 GB. Classic archive format can't address it (use --fst64 option).", "File error",
+		"StreamCopy - Write error on output operation.", "Logic error",
+		"Patches are limited to archives smaller than 4 GB.", "Logic error",
+		"Can't open access trace file. File does not exist or is locked. (Or the file path contains Unicode characters.)", "File error",
+/*55*/	"Shared dictionary lies outside the archive file. The file is corrupted.", "File error",
+		"Output buffer is smaller than uncompressed size of file-entry.", "Logic error",
+		"Requested range starts past the end of file-entry.", "Logic error",
+		"Can't write unpack journal file. File is locked or disk is full. (Or the file path contains Unicode characters.)", "File error",
+		"Memory limit exceeded. Nested archive doesn't fit into the memory budget (use larger --memory value).", "Logic error",
+/*60*/	"Can't open index file. File does not exist or is locked. (Or the file path contains Unicode characters.)", "File error",
+		"The file is not a path index of FST archives, has unsupported version or is damaged.", "File error",
+		"Search pattern is empty or is not valid regular expression.", "Logic error",
+		"Data of file-entry lies outside the archive file or inside its header. The archive can't be compacted.", "File error",
+		"Compacted archive must be written to other file than the source archive.", "Logic error",
+/*65*/	"File-entry is not found in the archive.", "Logic error",
+		"New path of file-entry is empty, longer than 249 characters or already exists in the archive.", "Logic error",
+		"Can't write edit journal file. File is locked or disk is full. (Or the file path contains Unicode characters.)", "File error",
+		"Archive has unfinished edit (journal <archive>.edit exists). Repeat any edit of the archive to complete it.", "File error",
+		"Can't write the archive file. File is read-only or locked, or disk is full.", "File error",
+/*70*/	"Can't read directory. Directory is locked or was removed while packing.", "File error",
+		"Can't flush unpacked file to disk. File is locked or was removed while unpacking.", "File error",
+		"Can't remove journal file. File is read-only or locked. (Or the file path contains Unicode characters.)", "File error",
+		"Edit journal doesn't match the archive (size or header differs). Remove journal <archive>.edit if the archive was replaced.", "File error",
+		"Regular expression is too complex for data of file-entry (limit of the regular expression engine is reached).", "Logic error"
 };
@@ -7,30 +7,101 @@
 #define ErrorDescriptionH
 
 #include <vector>
+#include <mutex>
+#include <atomic>
 #pragma hdrstop//This directive terminates the list of header files eligible for precompilation (Using ONLY for <standard> headers, no "custom")
 
 #include "Conversion.h"
 #include "CHF.h"
 
+/// \brief Ordinal number of file-entry for errors which don't belong to any file-entry
+const cnv::qword ErrorNoEntry = ~0ULL;
+
 /// \brief Structure describing list of data for error
+/// \details Fixed-size structure: filling it doesn't allocate memory, so it is cheap for worker threads
 struct ErrorData
 {
-	/// \brief Name of module where error occurred
-	char*		File;
-	/// \brief Name of function (in the module) where error occurred
-	char*		Function;
+	/// \brief Name of module where error occurred (string literal, not copied)
+	const char*	File;
+	/// \brief Name of function (in the module) where error occurred (string literal, not copied)
+	const char*	Function;
 	/// \brief Line number (in the module) where error occurred
-	char*		Line;
+	int			Line;
 	/// \brief Error index
 	cnv::unsint	ErrorIndex;
 	/// \brief Active array number
 	cnv::unsint DescriptionSet;
-	/// \brief Additional error information
-	char*		Additional;
+	/// \brief Ordinal number of file-entry being processed when error occurred (ErrorNoEntry - no file-entry)
+	cnv::qword	EntryIndex;
+	/// \brief Additional error information (truncated to MAX_PATH - 1 characters)
+	char		Additional[MAX_PATH];
+};
+
+/// \brief Marks errors sent by the current thread with ordinal number of file-entry while the object exists
+class ErrorEntry
+{
+	private:
+	/// \brief Ordinal number of file-entry which was set before this object
+	cnv::qword Previous;
+
+	public:
+	ErrorEntry(cnv::qword);
+	~ErrorEntry();
+};
+
+/// \brief Saved last errors of the program and of the current thread
+/// \details Used when error of an operation must not be reported (e.g. failed comparison only means that file is written again)
+class ErrorCheckpoint
+{
+	private:
+	/// \brief The last error of the program when the object was created
+	ErrorData SavedLast;
+	/// \brief The last error of the current thread when the object was created
+	ErrorData SavedThread;
+
+	public:
+	ErrorCheckpoint();
+
+	void Rollback();
+};
+
+/// \brief Errors of batch operation collected from worker threads
+/// \details Reported error is the one with the lowest ordinal number of file-entry, so it doesn't depend on timing of threads
+class ErrorBatch
+{
+	private:
+	/// \brief Mutex for fields of the batch (taken only when error is added)
+	std::mutex Lock;
+	/// \brief Amount of collected errors (may be checked by workers without the mutex to stop early)
+	std::atomic<cnv::unsint> Amount;
+	/// \brief Reported error
+	ErrorData First;
+
+	public:
+	ErrorBatch()
+	{
+		Amount = 0;
+		First = ErrorData();
+	}
+	~ErrorBatch()
+	{
+
+	}
+
+	void AddThreadError();
+	void Publish();
+
+	/// \brief Get amount of collected errors
+	cnv::unsint GetAmount(){return Amount;}
+	/// \brief Get reported error
+	const ErrorData& GetFirst(){return First;}
 };
 
-void SendAlert(const char*, const char[], int, cnv::unsint, cnv::unsint, std::string);
-void SendAlert(const char*, const char[], int, cnv::unsint, cnv::unsint, char*);
+void SendAlert(const char*, const char[], int, cnv::unsint, cnv::unsint, const std::string&);
+void SendAlert(const char*, const char[], int, cnv::unsint, cnv::unsint, const char*);
 void SendAlert(const char*, const char[], int, cnv::unsint, cnv::unsint, cnv::unistr);
-void AlertControl(const char*, const char[], int, cnv::unsint, cnv::unsint);
+void AlertControl(const char*, const char[], int, cnv::unsint, cnv::unsint, const char*, cnv::unsint);
+ErrorData& GetThreadError();
+void ClearError();
+void ClearThreadError();
 #endif
@@ -0,0 +1,116 @@
+/// \file
+/// \brief Event trace module
+/// \author SpinelDusk
+/// \details Recording of begin/end events of pack and unpack steps into per-thread buffers and export as Chrome trace JSON
+
+#pragma GCC diagnostic ignored "-Wc++98-compat"					//Disable warning: 'nullptr' is incompatible with C++98
+#pragma GCC diagnostic ignored "-Wexit-time-destructors"		//Disable warning: Declaration requires an exit-time destructor
+#pragma GCC diagnostic ignored "-Wglobal-constructors"			//Disable warning: Declaration requires a global constructor
+
+#pragma package(smart_init)//Ensures that packaged units are initialized in the order determined by their dependencies
+
+#include "EventTrace.h"
+
+/// \brief Flag of recording events (set once before worker threads are started)
+static bool Enabled = false;
+/// \brief Start time of tracing
+static std::chrono::steady_clock::time_point StartTime;
+/// \brief Buffers of all threads which recorded events (buffers live until the end of the program)
+static std::vector<evt::ThreadBuffer*> BufferList;
+/// \brief Mutex for the list of buffers (taken only when thread records its first event and on export)
+static std::mutex BufferLock;
+/// \brief Buffer of the current thread
+static thread_local evt::ThreadBuffer* LocalBuffer = nullptr;
+
+/// \brief Begin event
+/// \param[in] local_Name Name of event (string literal)
+/// \param[in] local_Arg Ordinal number of file-entry (or NoArg)
+evt::Scope::Scope(const char* local_Name, cnv::qword local_Arg)
+{
+	Name = local_Name;
+	Arg = local_Arg;
+	Active = Enabled;
+	Begin = Active ? Now() : 0;
+}
+/// \brief End event and record it (repeated calls are ignored)
+void evt::Scope::End()
+{
+	if(!Active)
+		return;
+	Active = false;
+	Record(Name, Arg, Begin);
+}
+
+
+/// \brief Start recording of events
+void evt::Start()
+{
+	StartTime = std::chrono::steady_clock::now();
+	Enabled = true;
+}
+/// \brief Check that events are recorded
+/// \return true - events are recorded
+bool evt::IsEnabled()
+{
+	return Enabled;
+}
+/// \brief Get current time of the trace
+/// \return Time in nanoseconds from start of tracing
+cnv::qword evt::Now()
+{
+	return static_cast<cnv::qword>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - StartTime).count());
+}
+/// \brief Record ended event into buffer of the current thread
+/// \param[in] Name Name of event (string literal)
+/// \param[in] Arg Ordinal number of file-entry (or NoArg)
+/// \param[in] Begin Begin time of event
+void evt::Record(const char* Name, cnv::qword Arg, cnv::qword Begin)
+{
+	if(LocalBuffer == nullptr)
+	{
+		std::lock_guard<std::mutex> Lock(BufferLock);
+		LocalBuffer = new ThreadBuffer;
+		LocalBuffer->Id = BufferList.size();
+		LocalBuffer->Events.reserve(1024);
+		BufferList.push_back(LocalBuffer);
+	}
+	LocalBuffer->Events.push_back({Name, Arg, Begin, Now()});
+}
+/// \brief Writing recorded events to file in Chrome trace format (JSON, viewed in Perfetto or chrome://tracing)
+/// \param[in] local_Output Path to the trace file
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Must be called when worker threads are finished. Times are written in microseconds
+int evt::Export(std::string local_Output)
+{
+	std::ofstream Output(local_Output, std::ios::out|std::ios::binary);
+	if(!Output.is_open())
+		return 1;
+	auto PutTime = [&Output](cnv::qword Time)
+	{
+		Output << Time / 1000 << '.' << static_cast<char>('0' + Time / 100 % 10) << static_cast<char>('0' + Time / 10 % 10) << static_cast<char>('0' + Time % 10);
+	};
+	std::lock_guard<std::mutex> Lock(BufferLock);
+	Output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool First = true;
+	for(cnv::unsint i = 0; i < BufferList.size(); i++)
+	{
+		const ThreadBuffer& Buffer = *BufferList.at(i);
+		Output << (First ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << Buffer.Id
+			<< ",\"args\":{\"name\":\"Thread " << Buffer.Id << "\"}}";
+		First = false;
+		for(cnv::unsint j = 0; j < Buffer.Events.size(); j++)
+		{
+			const Event& Item = Buffer.Events.at(j);
+			Output << ",\n{\"name\":\"" << Item.Name << "\",\"cat\":\"fst\",\"ph\":\"X\",\"pid\":1,\"tid\":" << Buffer.Id << ",\"ts\":";
+			PutTime(Item.Begin);
+			Output << ",\"dur\":";
+			PutTime(Item.End - Item.Begin);
+			if(Item.Arg != NoArg)
+				Output << ",\"args\":{\"entry\":" << Item.Arg << "}";
+			Output << "}";
+		}
+	}
+	Output << "\n]}\n";
+	Output.close();
+	return Output.fail() ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+/// \file
+/// \brief Event trace module (Header)
+/// \author SpinelDusk
+
+#pragma GCC diagnostic ignored "-Wdocumentation-unknown-command"//Disable warning: Unknown command tag name
+#pragma GCC diagnostic ignored "-Wpadded"						//Disable warning: Padding class -- with -- byte to align --
+
+#pragma once//This header guard directive designed to cause the current source file to be included only once in a single compilation
+#ifndef EventTraceH
+#define EventTraceH
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#pragma hdrstop//This directive terminates the list of header files eligible for precompilation (Using ONLY for <standard> headers, no "custom")
+
+#include "Conversion.h"
+
+/// \brief Event tracing is compiled in, unless FSTFILE_NO_EVENT_TRACE is defined (then macros below expand to nothing)
+#ifndef FSTFILE_NO_EVENT_TRACE
+	#define FSTFILE_EVENT_TRACE
+#endif
+
+#ifdef FSTFILE_EVENT_TRACE
+	/// \brief Begin event which ends with the scope of the variable (or with EVENT_END)
+	#define EVENT_SCOPE(Variable, Name, Arg) evt::Scope Variable(Name, Arg)
+	/// \brief End event before the end of the scope
+	#define EVENT_END(Variable) Variable.End()
+#else
+	#define EVENT_SCOPE(Variable, Name, Arg)
+	#define EVENT_END(Variable)
+#endif
+
+namespace evt
+{
+	/// \brief Argument value of events which don't belong to file-entry
+	const cnv::qword NoArg = ~0ULL;
+
+	/// \brief Recorded event (begin time and duration)
+	struct Event
+	{
+		/// \brief Name of event (string literal)
+		const char* Name;
+		/// \brief Ordinal number of file-entry (or NoArg)
+		cnv::qword Arg;
+		/// \brief Begin time in nanoseconds from start of tracing
+		cnv::qword Begin;
+		/// \brief End time in nanoseconds from start of tracing
+		cnv::qword End;
+	};
+
+	/// \brief Events of single thread (written only by its thread, read after all workers are finished)
+	struct ThreadBuffer
+	{
+		/// \brief Number of thread in the trace
+		cnv::unsint Id;
+		/// \brief Recorded events
+		std::vector<Event> Events;
+	};
+
+	/// \brief Event which is recorded when the object is destroyed or ended
+	class Scope
+	{
+		private:
+		/// \brief Name of event
+		const char* Name;
+		/// \brief Ordinal number of file-entry
+		cnv::qword Arg;
+		/// \brief Begin time
+		cnv::qword Begin;
+		/// \brief Flag of event waiting for its end (false - tracing is disabled or event is already recorded)
+		bool Active;
+
+		public:
+		Scope(const char*, cnv::qword);
+		~Scope()
+		{
+			End();
+		}
+		void End();
+	};
+
+	void		Start();
+	bool		IsEnabled();
+	cnv::qword	Now();
+	void		Record(const char*, cnv::qword, cnv::qword);
+	int			Export(std::string);
+}
+#endif
@@ -0,0 +1,94 @@
+/// \file
+/// \brief Fst census module
+/// \author SpinelDusk
+/// \details Classification of contents of FST file by signatures of file-entries (only beginning of every file-entry is decoded)
+
+#pragma GCC diagnostic ignored "-Wc++98-compat"					//Disable warning: 'nullptr' is incompatible with C++98
+
+#pragma package(smart_init)//Ensures that packaged units are initialized in the order determined by their dependencies
+
+#include "FstCensus.h"
+
+/// \brief Clearing instance fields (census instance)
+void FstCensus::Clear()
+{
+	TypeList.erase(TypeList.begin(), TypeList.end());
+	EntryType.erase(EntryType.begin(), EntryType.end());
+	FailReport.erase(FailReport.begin(), FailReport.end());
+}
+/// \brief Classifying all file-entries of the archive
+/// \param[in] local_Input Path to the archive
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details File-entries are classified on worker threads (each worker uses its own file stream). Only prefix holding
+/// signature is decoded from every file-entry, so the archive is not unpacked (file-entries compressed without shared
+/// dictionary are decoded whole, so memory for whole file-entry is leased). Sizes are taken from table of contents.
+/// File-entries which can't be decoded are listed in FailReport and are not counted in totals
+int FstCensus::Collect(char* local_Input)
+{
+	//Clearing the instance fields
+	Clear();
+
+	if(Archive.Load(local_Input))
+		return 1;
+
+	EntryType.assign(Archive.GetAmountEntries(), FM_UNKNOWN);
+	std::vector<ifstream> Streams(chf::GetWorkerCount());
+	std::vector<cnv::unsint> FailedError(Archive.GetAmountEntries(), 0);
+	chf::ParallelFor(Archive.GetAmountEntries(), [&](cnv::unsint i, cnv::unsint w)
+	{
+		ErrorEntry EntryMark(i);
+		ifstream& Stream = Streams.at(w);
+		if(!Stream.is_open())
+			Stream.open(Archive.GetArchivePath(), ios::in|ios::binary);
+
+		//Uncompressed data and compressed data read for decoding
+		chf::MemoryLease Lease((Archive.GetCompressFlag(i) == CF_EMPTY) ? 0 : Archive.GetUncompressSize(i) + Archive.GetCompressSize(i));
+		if(Archive.ClassifyEntry(Stream, i, EntryType.at(i)))
+		{
+			FailedError.at(i) = GetThreadError().ErrorIndex;
+			Stream.close();//Stream state is restored for the next file-entry
+		}
+	});
+	for(cnv::unsint i = 0; i < Archive.GetAmountEntries(); i++)
+	{
+		if(FailedError.at(i) != 0)
+			FailReport.push_back("Not read  : " + Archive.GetPath(i) + " (error " + INTtoSTRING(static_cast<int>(FailedError.at(i))) + ")");
+	}
+	if(!FailReport.empty())
+		ClearError();
+
+	//Totals by type
+	for(cnv::unsint i = 0; i < Archive.GetAmountEntries(); i++)
+	{
+		if(FailedError.at(i) != 0)
+			continue;
+		std::vector<TypeTotal>::iterator Total = std::find_if(TypeList.begin(), TypeList.end(), [this, i](const TypeTotal& Item)
+		{
+			return Item.Type == EntryType.at(i);
+		});
+		if(Total == TypeList.end())
+		{
+			TypeList.push_back({EntryType.at(i), 0, 0, 0, 0});
+			Total = TypeList.end() - 1;
+		}
+		Total->Amount++;
+		Total->UncompressSize += Archive.GetUncompressSize(i);
+		Total->CompressSize += (Archive.GetCompressFlag(i) == CF_EMPTY) ? 0 : Archive.GetCompressSize(i);
+		if(IsMismatched(i))
+			Total->Mismatched++;
+	}
+	std::stable_sort(TypeList.begin(), TypeList.end(), [](const TypeTotal& First, const TypeTotal& Second)
+	{
+		return First.UncompressSize > Second.UncompressSize;
+	});
+	return 0;
+}
+/// \brief Checking that extension of file-entry path doesn't match type found by signature
+/// \param[in] i Ordinal number of the file-entry
+/// \return True - type is known and extension belongs to other type
+bool FstCensus::IsMismatched(cnv::unsint i)
+{
+	if(EntryType.at(i) == FM_UNKNOWN || EntryType.at(i) == FM_NOTYPE)
+		return false;
+	return GetFileTypeFromExt(GetExtFromPath(Archive.GetPath(i))) != EntryType.at(i);
+}
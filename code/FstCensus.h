@@ -0,0 +1,86 @@
+/// \file
+/// \brief Fst census module (Header)
+/// \author SpinelDusk
+
+#pragma GCC diagnostic ignored "-Wpadded"						//Disable warning: Padding class -- with -- byte to align --
+
+#pragma once//This header guard directive designed to cause the current source file to be included only once in a single compilation
+#ifndef FstCensusH
+#define FstCensusH
+
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#pragma hdrstop//This directive terminates the list of header files eligible for precompilation (Using ONLY for <standard> headers, no "custom")
+
+#include "FstFile.h"
+
+/// \brief The class contains data and functions necessary for classifying contents of FST file by signatures of file-entries
+class FstCensus
+{
+	private:
+	/// \brief Totals of single type of content
+	struct TypeTotal
+	{
+		/// \brief Type of content (FileMode)
+		cnv::dword Type;
+		/// \brief Amount of file-entries
+		cnv::dword Amount;
+		/// \brief Total uncompressed size (in bytes) of file-entries
+		cnv::qword UncompressSize;
+		/// \brief Total compressed size (in bytes) of file-entries
+		cnv::qword CompressSize;
+		/// \brief Amount of file-entries whose path extension doesn't match the type
+		cnv::dword Mismatched;
+	};
+	/// \brief Totals by type of content (ordered by uncompressed size, the largest first)
+	std::vector<TypeTotal> TypeList;
+	/// \brief Type of content of every file-entry (FileMode)
+	std::vector<cnv::dword> EntryType;
+	/// \brief File-entries which couldn't be decoded (they are not counted in totals)
+	std::vector<std::string> FailReport;
+	/// \brief Classified archive
+	FstUnpack Archive;
+
+	public:
+	FstCensus()
+	{
+
+	}
+	~FstCensus()
+	{
+
+	}
+
+	int Collect(char*);
+
+	/// \brief Get archive path
+	std::string GetArchivePath(){return Archive.GetArchivePath();}
+	/// \brief Get amount of table of contents entries
+	cnv::dword GetAmountEntries(){return Archive.GetAmountEntries();}
+	/// \brief Get amount of types of content
+	cnv::dword GetAmountTypes(){return TypeList.size();}
+	/// \brief Get type of content (FileMode)
+	cnv::dword GetType(cnv::unsint i){return TypeList.at(i).Type;}
+	/// \brief Get amount of file-entries of the type
+	cnv::dword GetAmount(cnv::unsint i){return TypeList.at(i).Amount;}
+	/// \brief Get total uncompressed size of file-entries of the type
+	cnv::qword GetUncompressSize(cnv::unsint i){return TypeList.at(i).UncompressSize;}
+	/// \brief Get total compressed size of file-entries of the type
+	cnv::qword GetCompressSize(cnv::unsint i){return TypeList.at(i).CompressSize;}
+	/// \brief Get amount of file-entries of the type whose path extension doesn't match it
+	cnv::dword GetMismatched(cnv::unsint i){return TypeList.at(i).Mismatched;}
+	/// \brief Get type of content of file-entry (FileMode)
+	cnv::dword GetEntryType(cnv::unsint i){return EntryType.at(i);}
+	/// \brief Get path of file-entry in the archive
+	std::string GetPath(cnv::unsint i){return Archive.GetPath(i);}
+	/// \brief Get amount of file-entries which couldn't be decoded
+	cnv::unsint GetAmountReport(){return FailReport.size();}
+	/// \brief Get line of report about file-entry which couldn't be decoded
+	std::string GetReportLine(cnv::unsint i){return FailReport.at(i);}
+	bool IsMismatched(cnv::unsint);
+
+	private:
+	void Clear();
+};
+#endif
@@ -0,0 +1,287 @@
+/// \file
+/// \brief Fst compaction module
+/// \author SpinelDusk
+/// \details Analysis of data layout of FST file (dead space, shared and overlapping data, fragmentation) and rewriting
+/// of the archive without gaps
+
+#pragma GCC diagnostic ignored "-Wc++98-compat"					//Disable warning: 'nullptr' is incompatible with C++98
+#pragma GCC diagnostic ignored "-Wdisabled-macro-expansion"		//Disable warning: Disabled expansion of recursive macro
+#pragma GCC diagnostic ignored "-Wlanguage-extension-token"		//Disable warning: Extension used
+
+#pragma package(smart_init)//Ensures that packaged units are initialized in the order determined by their dependencies
+
+#include "FstCompact.h"
+
+/// \brief Macro makes it easy to write SendAlert function in the code
+#define SendAlert(a,b) SendAlert(__FILE__,__FUNCSIG__,__LINE__,a,3,b)
+
+/// \brief Clearing instance fields (compaction instance)
+void FstCompact::Clear()
+{
+	PayloadList.erase(PayloadList.begin(), PayloadList.end());
+	EntryPayload.erase(EntryPayload.begin(), EntryPayload.end());
+	HeadSize = 0;
+	ReferencedSize = 0;
+	UnreferencedSize = 0;
+	AmountGaps = 0;
+	LargestGap = 0;
+	AmountShared = 0;
+	SharedSize = 0;
+	AmountOverlaps = 0;
+	OverlapSize = 0;
+	AmountOutside = 0;
+	AmountTransitions = 0;
+	AmountBreaks = 0;
+	TargetSize = 0;
+	AmountCopies = 0;
+	TargetPath.erase(TargetPath.begin(), TargetPath.end());
+}
+/// \brief Analysis of data layout of the archive
+/// \param[in] local_Input Path to the archive
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Only table of contents is read. Ranges of data (of file-entries and of shared dictionary) are swept in order
+/// of offsets: space before the next range is not referenced, range starting before the end of previous ranges
+/// overlaps them. Records with equal offset and size share single payload, which is kept shared by compaction
+int FstCompact::Analyze(char* local_Input)
+{
+	//Clearing the instance fields
+	Clear();
+
+	if(Archive.Load(local_Input))
+		return 1;
+	HeadSize = Archive.GetHeadSize();
+	cnv::qword FileSize = Archive.GetFileSize();
+	cnv::dword Amount = Archive.GetAmountEntries();
+
+	//Ranges of data ordered by offset (the longest first); the dictionary is marked by ordinal number Amount
+	std::vector<cnv::unsint> Order;
+	for(cnv::unsint i = 0; i < Amount; i++)
+	{
+		cnv::qword Offset = Archive.GetDataOffset(i);
+		cnv::qword Size = Archive.GetCompressSize(i);
+		if(Size == 0)
+			continue;
+		if(Offset < HeadSize || Offset > FileSize || Size > FileSize - Offset)
+		{
+			AmountOutside++;
+			continue;
+		}
+		Order.push_back(i);
+	}
+	if(Archive.GetDictionarySize() != 0)
+		Order.push_back(Amount);
+	auto Begin = [this, Amount](cnv::unsint i){return (i == Amount) ? Archive.GetDictionaryOffset() : Archive.GetDataOffset(i);};
+	auto Length = [this, Amount](cnv::unsint i){return (i == Amount) ? Archive.GetDictionarySize() : Archive.GetCompressSize(i);};
+	std::stable_sort(Order.begin(), Order.end(), [&](cnv::unsint First, cnv::unsint Second)
+	{
+		if(Begin(First) != Begin(Second))
+			return Begin(First) < Begin(Second);
+		return Length(First) > Length(Second);
+	});
+
+	//Sweep over ranges
+	cnv::dword None = 0xFFFFFFFF;
+	EntryPayload.assign(Amount, None);
+	cnv::qword Cursor = HeadSize;
+	cnv::unsint Previous = None;
+	for(cnv::unsint i : Order)
+	{
+		cnv::qword Offset = Begin(i);
+		cnv::qword End = Offset + Length(i);
+		if(i != Amount && Previous != None && Archive.GetDataOffset(Previous) == Offset && Archive.GetCompressSize(Previous) == Length(i))
+		{
+			AmountShared++;
+			SharedSize += Length(i);
+			EntryPayload.at(i) = EntryPayload.at(Previous);
+			continue;
+		}
+		if(Offset > Cursor)
+		{
+			AmountGaps++;
+			UnreferencedSize += Offset - Cursor;
+			LargestGap = std::max(LargestGap, Offset - Cursor);
+		}
+		else if(Offset < Cursor)
+		{
+			AmountOverlaps++;
+			OverlapSize += std::min(Cursor, End) - Offset;
+		}
+		if(End > Cursor)
+		{
+			ReferencedSize += End - std::max(Cursor, Offset);
+			Cursor = End;
+		}
+		Previous = (i == Amount) ? None : i;
+		if(i != Amount)
+		{
+			EntryPayload.at(i) = PayloadList.size();
+			PayloadList.push_back({Offset, Length(i), 0, Archive.GetCompressFlag(i)});
+		}
+	}
+	if(FileSize > Cursor)
+	{
+		AmountGaps++;
+		UnreferencedSize += FileSize - Cursor;
+		LargestGap = std::max(LargestGap, FileSize - Cursor);
+	}
+
+	//Fragmentation: reading in table of contents order jumps at every break (payloads are still in order of offsets,
+	//gaps between neighbouring payloads are not breaks)
+	Previous = None;
+	for(cnv::unsint i = 0; i < Amount; i++)
+	{
+		if(EntryPayload.at(i) == None)
+			continue;
+		if(Previous != None)
+		{
+			AmountTransitions++;
+			cnv::dword Last = EntryPayload.at(Previous);
+			cnv::dword Next = EntryPayload.at(i);
+			if(Next != Last && Next != Last + 1)
+				AmountBreaks++;
+		}
+		Previous = i;
+	}
+
+	Place();
+	return 0;
+}
+/// \brief Placement of payloads in the compacted archive
+/// \details Payloads follow the header and shared dictionary without gaps, in order of data in the source archive or
+/// (with TocOrder) in order of the first file-entry referencing them. With alignment set, zero padding is placed before
+/// payloads by the same rule as packing uses, so compaction of an aligned archive keeps its data aligned
+void FstCompact::Place()
+{
+	if(TocOrder)
+	{
+		std::vector<Payload> Placed;
+		std::vector<cnv::dword> Remap(PayloadList.size(), 0xFFFFFFFF);
+		Placed.reserve(PayloadList.size());
+		for(cnv::dword& Item : EntryPayload)
+		{
+			if(Item == 0xFFFFFFFF)
+				continue;
+			if(Remap.at(Item) == 0xFFFFFFFF)
+			{
+				Remap.at(Item) = Placed.size();
+				Placed.push_back(PayloadList.at(Item));
+			}
+			Item = Remap.at(Item);
+		}
+		PayloadList.swap(Placed);
+	}
+	TargetSize = HeadSize + Archive.GetDictionarySize();
+	for(Payload& Item : PayloadList)
+	{
+		TargetSize += GetAlignGap(TargetSize, Alignment, AlignStoredOnly, Item.Flag);
+		Item.Target = TargetSize;
+		TargetSize += Item.Size;
+	}
+}
+/// \brief Rewriting the archive without gaps
+/// \param[in] local_Input Path to the source archive
+/// \param[in] local_Output Path to the compacted archive (must differ from the source)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Format of the archive, table of contents order and all fields of records except data offsets are kept.
+/// Data is copied raw by blocks; payloads which are neighbours both in the source and in the target are copied by
+/// single request, padding before aligned payloads is written as zeros. Classic archive which would exceed 4 GB (e.g. after
+/// alignment) is not written, and partly written archive is removed on error. The compacted archive is loaded again to
+/// check its table of contents
+int FstCompact::Compact(char* local_Input, char* local_Output)
+{
+	if(Analyze(local_Input))
+		return 1;
+	TargetPath = local_Output;
+	if(GetComparablePath(TargetPath) == GetComparablePath(Archive.GetArchivePath()))
+	{
+		SendAlert(64, TargetPath);//Compacted archive must be written to other file than the source archive.
+		return 1;
+	}
+	if(AmountOutside != 0)
+	{
+		SendAlert(63, Archive.GetArchivePath());//Data of file-entry lies outside the archive file or inside its header. The archive can't be compacted.
+		return 1;
+	}
+	if(Archive.GetFormat() == AF_FST && TargetSize > 0xFFFFFFFFULL)
+	{
+		SendAlert(51, TargetPath);//Archive size exceeds 4 GB. Classic archive format can't address it (use --fst64 option).
+		return 1;
+	}
+
+	//Data offsets of the compacted archive (entries without data point at beginning of data)
+	std::vector<cnv::qword> Offsets(Archive.GetAmountEntries(), HeadSize + Archive.GetDictionarySize());
+	for(cnv::unsint i = 0; i < Archive.GetAmountEntries(); i++)
+	{
+		if(EntryPayload.at(i) != 0xFFFFFFFF)
+			Offsets.at(i) = PayloadList.at(EntryPayload.at(i)).Target;
+	}
+
+	if(ClearEditJournal(TargetPath))
+		return 1;
+	ofstream Target(TargetPath, ios::out|ios::binary|ios::trunc);
+	if(!Target.is_open())
+	{
+		SendAlert(39, TargetPath);//Can't open output file.
+		return 1;
+	}
+	if(Archive.WriteHead(Target, Offsets, HeadSize))
+	{
+		Target.close();
+		remove(TargetPath.data());
+		return 1;
+	}
+	const std::vector<cnv::byte>& Dictionary = Archive.GetDictionaryData();
+	Target.write(reinterpret_cast<const char*>(Dictionary.data()), Dictionary.size());
+	if(CopyPayloads(Target))
+	{
+		Target.close();
+		remove(TargetPath.data());
+		return 1;
+	}
+	Target.close();
+	if(!Target.good())
+	{
+		remove(TargetPath.data());
+		SendAlert(52, TargetPath);//StreamCopy - Write error on output operation.
+		return 1;
+	}
+
+	FstUnpack Check;
+	return Check.Load(&TargetPath[0]);
+}
+/// \brief Copying payloads to the compacted archive
+/// \param[in] Target File stream of the compacted archive (positioned after the header)
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstCompact::CopyPayloads(ofstream& Target)
+{
+	EVENT_SCOPE(Event, "Copy data", evt::NoArg);
+
+	ifstream Source(Archive.GetArchivePath(), ios::in|ios::binary);
+	if(!Source.is_open())
+	{
+		SendAlert(18, Archive.GetArchivePath());//Can't open input archive file. File does not exist or is locked. (Or the file path contains Unicode characters.)
+		return 1;
+	}
+	cnv::qword Position = HeadSize + Archive.GetDictionarySize();
+	for(cnv::unsint k = 0; k < PayloadList.size(); )
+	{
+		if(PayloadList.at(k).Target > Position)
+		{
+			std::vector<char> Zero(PayloadList.at(k).Target - Position, 0);
+			Target.write(Zero.data(), Zero.size());
+		}
+		cnv::qword Begin = PayloadList.at(k).Offset;
+		cnv::qword End = Begin + PayloadList.at(k).Size;
+		Position = PayloadList.at(k).Target + PayloadList.at(k).Size;
+		for(k++; k < PayloadList.size() && PayloadList.at(k).Offset == End && PayloadList.at(k).Target == Position; k++)
+		{
+			End += PayloadList.at(k).Size;
+			Position += PayloadList.at(k).Size;
+		}
+		Source.seekg(Begin, std::ios_base::beg);
+		if(StreamCopy(Source, Target, End - Begin))
+			return 1;
+		AmountCopies++;
+	}
+	return 0;
+}
@@ -0,0 +1,146 @@
+/// \file
+/// \brief Fst compaction module (Header)
+/// \author SpinelDusk
+
+#pragma GCC diagnostic ignored "-Wpadded"						//Disable warning: Padding class -- with -- byte to align --
+
+#pragma once//This header guard directive designed to cause the current source file to be included only once in a single compilation
+#ifndef FstCompactH
+#define FstCompactH
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#pragma hdrstop//This directive terminates the list of header files eligible for precompilation (Using ONLY for <standard> headers, no "custom")
+
+#include "FstFile.h"
+#include "FstDiff.h"
+
+/// \brief The class contains data and functions necessary for analysis of data layout of FST file and its compaction
+/// \details Analysis checks how table of contents covers the archive file: bytes not referenced by any record (dead
+/// space left by editing or alignment), data shared by several records, overlapping data, data outside the file and
+/// fragmentation (breaks of data order when the archive is read in table of contents order). Compaction rewrites the
+/// archive without gaps: data of file-entries is copied raw (never decompressed or compressed again) by blocks, so
+/// memory consumption doesn't depend on size of the archive
+class FstCompact
+{
+	private:
+	/// \brief Data referenced by one or several records of table of contents
+	struct Payload
+	{
+		/// \brief Offset of data in the source archive
+		cnv::qword Offset;
+		/// \brief Size of data in bytes
+		cnv::qword Size;
+		/// \brief Offset of data in the compacted archive
+		cnv::qword Target;
+		/// \brief Compression flag of the first file-entry referencing data (for alignment)
+		cnv::dword Flag;
+	};
+	/// \brief Source archive
+	FstUnpack Archive;
+	/// \brief Distinct data of file-entries (records with equal offset and size share one payload)
+	std::vector<Payload> PayloadList;
+	/// \brief Ordinal number of payload of every file-entry (PayloadList size - entry without data)
+	std::vector<cnv::dword> EntryPayload;
+	/// \brief Flag of placement of data in order of table of contents (otherwise order of data in the source is kept)
+	bool TocOrder;
+	/// \brief Alignment boundary for data of file-entries in the compacted archive (0 or 1 - no alignment)
+	cnv::dword Alignment;
+	/// \brief Flag of alignment of uncompressed file-entries only
+	bool AlignStoredOnly;
+	/// \brief Size of header (table of contents)
+	cnv::qword HeadSize;
+	/// \brief Size of data referenced by table of contents (every byte counted once)
+	cnv::qword ReferencedSize;
+	/// \brief Size of data not referenced by table of contents
+	cnv::qword UnreferencedSize;
+	/// \brief Amount of ranges of not referenced data
+	cnv::unsint AmountGaps;
+	/// \brief Size of the largest range of not referenced data
+	cnv::qword LargestGap;
+	/// \brief Amount of file-entries sharing data with previous file-entry (same offset and size)
+	cnv::unsint AmountShared;
+	/// \brief Size of data of file-entries counted in AmountShared
+	cnv::qword SharedSize;
+	/// \brief Amount of file-entries whose data partially overlaps data of other file-entries
+	cnv::unsint AmountOverlaps;
+	/// \brief Size of overlapping parts of data
+	cnv::qword OverlapSize;
+	/// \brief Amount of file-entries whose data lies outside the file or inside its header
+	cnv::unsint AmountOutside;
+	/// \brief Amount of transitions between neighbouring file-entries (table of contents order, entries with data)
+	cnv::unsint AmountTransitions;
+	/// \brief Amount of transitions where data of the next file-entry doesn't follow data of the previous one
+	cnv::unsint AmountBreaks;
+	/// \brief Size of the compacted archive
+	cnv::qword TargetSize;
+	/// \brief Amount of read requests of the last compaction (neighbouring payloads are copied together)
+	cnv::unsint AmountCopies;
+	/// \brief Path of the compacted archive
+	std::string TargetPath;
+
+	public:
+	FstCompact()
+	{
+		TocOrder = false;
+		Alignment = 0;
+		AlignStoredOnly = false;
+		Clear();
+	}
+	~FstCompact()
+	{
+
+	}
+
+	int Analyze(char*);
+	int Compact(char*, char*);
+
+	/// \brief Set placement of data in order of table of contents
+	void SetTocOrder(bool local_Input){TocOrder = local_Input;}
+	/// \brief Set alignment of data of file-entries in the compacted archive (same rule as packing with alignment)
+	void SetAlignment(cnv::dword local_Input, bool StoredOnly){Alignment = local_Input; AlignStoredOnly = StoredOnly;}
+	/// \brief Get archive path
+	std::string GetArchivePath(){return Archive.GetArchivePath();}
+	/// \brief Get path of the compacted archive
+	std::string GetTargetPath(){return TargetPath;}
+	/// \brief Get amount of table of contents entries
+	cnv::dword GetAmountEntries(){return Archive.GetAmountEntries();}
+	/// \brief Get size of the archive file
+	cnv::qword GetFileSize(){return Archive.GetFileSize();}
+	/// \brief Get size of header (table of contents)
+	cnv::qword GetHeadSize(){return HeadSize;}
+	/// \brief Get size of data referenced by table of contents
+	cnv::qword GetReferencedSize(){return ReferencedSize;}
+	/// \brief Get size of data not referenced by table of contents
+	cnv::qword GetUnreferencedSize(){return UnreferencedSize;}
+	/// \brief Get amount of ranges of not referenced data
+	cnv::unsint GetAmountGaps(){return AmountGaps;}
+	/// \brief Get size of the largest range of not referenced data
+	cnv::qword GetLargestGap(){return LargestGap;}
+	/// \brief Get amount of file-entries sharing data with other file-entry
+	cnv::unsint GetAmountShared(){return AmountShared;}
+	/// \brief Get size of shared data (counted for every sharing file-entry)
+	cnv::qword GetSharedSize(){return SharedSize;}
+	/// \brief Get amount of file-entries whose data partially overlaps data of other file-entries
+	cnv::unsint GetAmountOverlaps(){return AmountOverlaps;}
+	/// \brief Get size of overlapping parts of data
+	cnv::qword GetOverlapSize(){return OverlapSize;}
+	/// \brief Get amount of file-entries whose data lies outside the file or inside its header
+	cnv::unsint GetAmountOutside(){return AmountOutside;}
+	/// \brief Get amount of transitions between neighbouring file-entries with data
+	cnv::unsint GetAmountTransitions(){return AmountTransitions;}
+	/// \brief Get amount of transitions where data of the next file-entry doesn't follow data of the previous one
+	cnv::unsint GetAmountBreaks(){return AmountBreaks;}
+	/// \brief Get size of the compacted archive (projected by analysis)
+	cnv::qword GetTargetSize(){return TargetSize;}
+	/// \brief Get amount of read requests of the last compaction
+	cnv::unsint GetAmountCopies(){return AmountCopies;}
+
+	private:
+	void Clear();
+	void Place();
+	int CopyPayloads(ofstream&);
+};
+#endif
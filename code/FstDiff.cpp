@@ -0,0 +1,240 @@
+/// \file
+/// \brief Fst diff module
+/// \author SpinelDusk
+/// \details Comparison of two FST files by table of contents and data of file-entries
+
+#pragma GCC diagnostic ignored "-Wc++98-compat"					//Disable warning: 'nullptr' is incompatible with C++98
+#pragma GCC diagnostic ignored "-Wdisabled-macro-expansion"		//Disable warning: Disabled expansion of recursive macro
+#pragma GCC diagnostic ignored "-Wlanguage-extension-token"		//Disable warning: Extension used
+
+#pragma package(smart_init)//Ensures that packaged units are initialized in the order determined by their dependencies
+
+#include "FstDiff.h"
+
+/// \brief Macro makes it easy to write SendAlert function in the code
+#define SendAlert(a,b) SendAlert(__FILE__,__FUNCSIG__,__LINE__,a,3,b)
+
+/// \brief Clearing instance fields (diff instance)
+void FstDiff::Clear()
+{
+	ChangeList.erase(ChangeList.begin(), ChangeList.end());
+	DuplicateReport.erase(DuplicateReport.begin(), DuplicateReport.end());
+	AmountUnchanged = 0;
+	AmountRepacked = 0;
+}
+/// \brief Comparing two archives
+/// \param[in] local_Old Path to the old archive
+/// \param[in] local_New Path to the new archive
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Entries are aligned by path. Sizes and flags are compared first, then stored data,
+/// and only entries with different stored data are decompressed. Entries with repeated path are aligned
+/// by order of occurrence and reported
+int FstDiff::Compare(char* local_Old, char* local_New)
+{
+	//Clearing the instance fields
+	Clear();
+
+	//Loading tables of contents of both archives
+	if(OldArchive.Load(local_Old))
+		return 1;
+	if(NewArchive.Load(local_New))
+		return 1;
+
+	//Index of the old archive by path (all entries with the same path in order of occurrence)
+	std::map<std::string, std::vector<cnv::unsint>> OldIndex;
+	for(cnv::unsint i = 0; i < OldArchive.GetAmountEntries(); i++)
+	{
+		std::vector<cnv::unsint>& Same = OldIndex[GetComparablePath(OldArchive.GetPath(i))];
+		if(!Same.empty())
+			DuplicateReport.push_back("Duplicate : " + OldArchive.GetArchivePath() + "\\" + OldArchive.GetPath(i));
+		Same.push_back(i);
+	}
+
+	//Aligning the new archive to the old one (n-th entry with repeated path is aligned to n-th entry with this path)
+	std::vector<bool> OldMatched(OldArchive.GetAmountEntries(), false);
+	std::vector<Pair> PairList;
+	std::map<std::string, cnv::unsint> NewOccurrence;
+	for(cnv::unsint i = 0; i < NewArchive.GetAmountEntries(); i++)
+	{
+		std::string Key = GetComparablePath(NewArchive.GetPath(i));
+		cnv::unsint Occurrence = NewOccurrence[Key]++;
+		if(Occurrence != 0)
+			DuplicateReport.push_back("Duplicate : " + NewArchive.GetArchivePath() + "\\" + NewArchive.GetPath(i));
+		std::map<std::string, std::vector<cnv::unsint>>::iterator Found = OldIndex.find(Key);
+		if(Found == OldIndex.end() || Occurrence >= Found->second.size())
+		{
+			ChangeList.push_back({DS_ADDED, NewArchive.GetPath(i), 0, NewArchive.GetUncompressSize(i)});
+			continue;
+		}
+		cnv::unsint OldCount = Found->second.at(Occurrence);
+		OldMatched.at(OldCount) = true;
+		if(OldArchive.GetUncompressSize(OldCount) != NewArchive.GetUncompressSize(i))
+		{
+			//Different sizes - no need to read data
+			ChangeList.push_back({DS_MODIFIED, NewArchive.GetPath(i), OldArchive.GetUncompressSize(OldCount), NewArchive.GetUncompressSize(i)});
+			continue;
+		}
+		PairList.push_back({OldCount, i, false, false});
+	}
+
+	//Comparing data of pairs on worker threads (each worker uses its own file streams)
+	cnv::unsint Workers = chf::GetWorkerCount();
+	std::vector<ifstream> OldStreams(Workers);
+	std::vector<ifstream> NewStreams(Workers);
+	ErrorBatch Errors;
+	chf::ParallelFor(PairList.size(), [&](cnv::unsint i, cnv::unsint w)
+	{
+		ErrorEntry EntryMark(PairList.at(i).NewIndex);
+		if(ComparePair(PairList.at(i), OldStreams.at(w), NewStreams.at(w)))
+			Errors.AddThreadError();
+	});
+	if(Errors.GetAmount() != 0)
+	{
+		Errors.Publish();
+		return 1;
+	}
+
+	for(cnv::unsint i = 0; i < PairList.size(); i++)
+	{
+		if(PairList.at(i).Modified)
+			ChangeList.push_back({DS_MODIFIED, NewArchive.GetPath(PairList.at(i).NewIndex), OldArchive.GetUncompressSize(PairList.at(i).OldIndex), NewArchive.GetUncompressSize(PairList.at(i).NewIndex)});
+		else
+			AmountUnchanged++;
+		if(PairList.at(i).Repacked)
+			AmountRepacked++;
+	}
+
+	//Entries which are missing in the new archive
+	for(cnv::unsint i = 0; i < OldArchive.GetAmountEntries(); i++)
+	{
+		if(!OldMatched.at(i))
+			ChangeList.push_back({DS_REMOVED, OldArchive.GetPath(i), OldArchive.GetUncompressSize(i), 0});
+	}
+	return 0;
+}
+/// \brief Comparing data of two file-entries with the same path and size
+/// \param[in,out] Item Pair of file-entries (result is saved into Modified field)
+/// \param[in] OldStream File stream for the old archive (opened on first use)
+/// \param[in] NewStream File stream for the new archive (opened on first use)
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstDiff::ComparePair(Pair& Item, ifstream& OldStream, ifstream& NewStream)
+{
+	if(!OldStream.is_open())
+	{
+		OldStream.open(OldArchive.GetArchivePath(), ios::in|ios::binary);
+		if(!OldStream.is_open())
+		{
+			SendAlert(38, OldArchive.GetArchivePath());//Can't open input archive file. File does not exist or is locked. (Or the file path contains Unicode characters.)
+			return 1;
+		}
+	}
+	if(!NewStream.is_open())
+	{
+		NewStream.open(NewArchive.GetArchivePath(), ios::in|ios::binary);
+		if(!NewStream.is_open())
+		{
+			SendAlert(38, NewArchive.GetArchivePath());//Can't open input archive file. File does not exist or is locked. (Or the file path contains Unicode characters.)
+			return 1;
+		}
+	}
+
+	//Same flags and stored size - comparing stored data without decompression (entries compressed with shared dictionary - only when dictionaries match)
+	if(OldArchive.GetCompressFlag(Item.OldIndex) == NewArchive.GetCompressFlag(Item.NewIndex) &&
+		OldArchive.GetCompressSize(Item.OldIndex) == NewArchive.GetCompressSize(Item.NewIndex) &&
+		OldArchive.GetFlags(Item.OldIndex) == NewArchive.GetFlags(Item.NewIndex) &&
+		(!(OldArchive.GetFlags(Item.OldIndex) & EF_DICTIONARY) || OldArchive.GetDictionaryData() == NewArchive.GetDictionaryData()))
+	{
+		bool Equal = false;
+		if(CompareStored(Item, OldStream, NewStream, Equal))
+			return 1;
+		if(Equal)
+		{
+			Item.Modified = false;
+			return 0;
+		}
+	}
+
+	//Stored data differs - comparing uncompressed content (worker waits while other workers hold the memory budget)
+	chf::MemoryLease Lease(OldArchive.GetUncompressSize(Item.OldIndex) + OldArchive.GetCompressSize(Item.OldIndex) +
+		NewArchive.GetUncompressSize(Item.NewIndex) + NewArchive.GetCompressSize(Item.NewIndex));
+	std::vector<cnv::byte> OldData;
+	std::vector<cnv::byte> NewData;
+	if(OldArchive.DecodeEntry(OldStream, Item.OldIndex, OldData))
+		return 1;
+	if(NewArchive.DecodeEntry(NewStream, Item.NewIndex, NewData))
+		return 1;
+	Item.Modified = (OldData != NewData);
+	Item.Repacked = !Item.Modified;
+	return 0;
+}
+/// \brief Comparing stored data of two file-entries of the same stored size
+/// \param[in] Item Pair of file-entries
+/// \param[in] OldStream File stream for the old archive
+/// \param[in] NewStream File stream for the new archive
+/// \param[out] Equal True - stored data is the same
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Data is compared by blocks, so memory consumption doesn't depend on the size of entry. Comparison
+/// stops at the first different block
+int FstDiff::CompareStored(Pair& Item, ifstream& OldStream, ifstream& NewStream, bool& Equal)
+{
+	Equal = false;
+	cnv::qword Size = OldArchive.GetCompressSize(Item.OldIndex);
+
+	//Checking that data of both file-entries lies inside the archives
+	if(OldArchive.GetDataOffset(Item.OldIndex) + Size > OldArchive.GetFileSize())
+	{
+		SendAlert(36, OldArchive.GetPath(Item.OldIndex));//Data of file-entry lies outside the archive file.
+		return 1;
+	}
+	if(NewArchive.GetDataOffset(Item.NewIndex) + Size > NewArchive.GetFileSize())
+	{
+		SendAlert(36, NewArchive.GetPath(Item.NewIndex));//Data of file-entry lies outside the archive file.
+		return 1;
+	}
+
+	const cnv::dword BlockSize = 1024*64;//64 KB
+	std::vector<char> OldBlock(BlockSize);
+	std::vector<char> NewBlock(BlockSize);
+	OldStream.seekg(OldArchive.GetDataOffset(Item.OldIndex), std::ios_base::beg);
+	NewStream.seekg(NewArchive.GetDataOffset(Item.NewIndex), std::ios_base::beg);
+	for(cnv::qword Left = Size; Left != 0; )
+	{
+		cnv::dword Part = (Left > BlockSize) ? BlockSize : static_cast<cnv::dword>(Left);
+		if(StreamRead(OldStream, OldBlock.data(), static_cast<int>(Part)) || StreamRead(NewStream, NewBlock.data(), static_cast<int>(Part)))
+			return 1;
+		if(memcmp(OldBlock.data(), NewBlock.data(), Part) != 0)
+			return 0;
+		Left -= Part;
+	}
+	Equal = true;
+	return 0;
+}
+/// \brief Count changes of the specified state
+/// \param[in] State State of file-entry (DiffState)
+/// \return Amount of changes
+cnv::dword FstDiff::CountState(char State)
+{
+	cnv::dword local_Output = 0;
+	for(cnv::unsint i = 0; i < ChangeList.size(); i++)
+	{
+		if(ChangeList.at(i).State == State)
+			local_Output++;
+	}
+	return local_Output;
+}
+
+
+/// \brief Get path of file-entry in form suitable for comparison (case and separators are ignored)
+/// \param[in] local_Input Path of file-entry
+/// \return Comparable path
+std::string GetComparablePath(std::string local_Input)
+{
+	for(cnv::unsint i = 0; i < local_Input.size(); i++)
+	{
+		if(local_Input.at(i) == '/')
+			local_Input.at(i) = '\\';
+		else
+			local_Input.at(i) = static_cast<char>(tolower(local_Input.at(i)));
+	}
+	return local_Input;
+}
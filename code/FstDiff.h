@@ -0,0 +1,111 @@
+/// \file
+/// \brief Fst diff module (Header)
+/// \author SpinelDusk
+
+#pragma GCC diagnostic ignored "-Wpadded"						//Disable warning: Padding class -- with -- byte to align --
+
+#pragma once//This header guard directive designed to cause the current source file to be included only once in a single compilation
+#ifndef FstDiffH
+#define FstDiffH
+
+#include <map>
+#include <vector>
+#include <fstream>
+#pragma hdrstop//This directive terminates the list of header files eligible for precompilation (Using ONLY for <standard> headers, no "custom")
+
+#include "FstFile.h"
+
+/// \brief Enumeration of file-entry states when comparing two archives
+enum DiffState
+{
+	DS_ADDED = 'A',		///< Entry exists only in the new archive
+	DS_REMOVED = 'R',	///< Entry exists only in the old archive
+	DS_MODIFIED = 'M'	///< Entry exists in both archives, content differs
+};
+
+/// \brief The class contains data and functions necessary for comparing two FST files
+class FstDiff
+{
+	private:
+	/// \brief Single difference between archives
+	struct Change
+	{
+		/// \brief State of file-entry (DiffState)
+		char State;
+		/// \brief Path to file-entry in the archive
+		std::string Path;
+		/// \brief Uncompressed size of file-entry in the old archive (0 - if added)
+		cnv::qword OldSize;
+		/// \brief Uncompressed size of file-entry in the new archive (0 - if removed)
+		cnv::qword NewSize;
+	};
+	/// \brief Pair of file-entries with the same path, which requires data comparison
+	struct Pair
+	{
+		/// \brief Ordinal number of file-entry in the old archive
+		cnv::unsint OldIndex;
+		/// \brief Ordinal number of file-entry in the new archive
+		cnv::unsint NewIndex;
+		/// \brief Result of comparison: true - content differs
+		bool Modified;
+		/// \brief Result of comparison: true - content is the same, but stored data differs
+		bool Repacked;
+	};
+	/// \brief List of differences
+	std::vector<Change> ChangeList;
+	/// \brief Paths repeated in one of the archives (entries with repeated path are aligned by order of occurrence)
+	std::vector<std::string> DuplicateReport;
+	/// \brief Amount of entries with the same content
+	cnv::dword AmountUnchanged;
+	/// \brief Amount of entries with the same content, but different stored data (compressed in other way)
+	cnv::dword AmountRepacked;
+	/// \brief Old archive
+	FstUnpack OldArchive;
+	/// \brief New archive
+	FstUnpack NewArchive;
+
+	public:
+	FstDiff()
+	{
+
+	}
+	~FstDiff()
+	{
+
+	}
+
+	int Compare(char*, char*);
+
+	/// \brief Get old archive path
+	std::string GetOldArchivePath(){return OldArchive.GetArchivePath();}
+	/// \brief Get new archive path
+	std::string GetNewArchivePath(){return NewArchive.GetArchivePath();}
+	/// \brief Get amount of differences
+	cnv::dword GetAmountChanges(){return ChangeList.size();}
+	/// \brief Get amount of entries with the same content
+	cnv::dword GetAmountUnchanged(){return AmountUnchanged;}
+	/// \brief Get amount of entries with the same content, but different stored data
+	cnv::dword GetAmountRepacked(){return AmountRepacked;}
+	/// \brief Get state of difference (DiffState)
+	char GetState(cnv::unsint i){return ChangeList.at(i).State;}
+	/// \brief Get path of file-entry for difference
+	std::string GetPath(cnv::unsint i){return ChangeList.at(i).Path;}
+	/// \brief Get uncompressed size of file-entry in the old archive
+	cnv::qword GetOldSize(cnv::unsint i){return ChangeList.at(i).OldSize;}
+	/// \brief Get uncompressed size of file-entry in the new archive
+	cnv::qword GetNewSize(cnv::unsint i){return ChangeList.at(i).NewSize;}
+	/// \brief Count changes of the specified state
+	cnv::dword CountState(char);
+	/// \brief Get amount of repeated paths
+	cnv::dword GetAmountReport(){return DuplicateReport.size();}
+	/// \brief Get description of repeated path
+	std::string GetReportLine(cnv::unsint i){return DuplicateReport.at(i);}
+
+	private:
+	void Clear();
+	int ComparePair(Pair&, ifstream&, ifstream&);
+	int CompareStored(Pair&, ifstream&, ifstream&, bool&);
+};
+
+std::string GetComparablePath(std::string);
+#endif
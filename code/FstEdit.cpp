@@ -0,0 +1,402 @@
+/// \file
+/// \brief Fst edit module
+/// \author SpinelDusk
+/// \details Replacing, deleting and renaming single file-entry of FST file in place with write-ahead journal of header
+
+#pragma GCC diagnostic ignored "-Wc++98-compat"					//Disable warning: 'nullptr' is incompatible with C++98
+#pragma GCC diagnostic ignored "-Wdisabled-macro-expansion"		//Disable warning: Disabled expansion of recursive macro
+#pragma GCC diagnostic ignored "-Wlanguage-extension-token"		//Disable warning: Extension used
+
+#pragma package(smart_init)//Ensures that packaged units are initialized in the order determined by their dependencies
+
+#include "FstEdit.h"
+
+/// \brief Macro makes it easy to write SendAlert function in the code
+#define SendAlert(a,b) SendAlert(__FILE__,__FUNCSIG__,__LINE__,a,3,b)
+
+/// \brief Signature of edit journal
+const char EditSignature[4] = {'F', 'S', 'T', 'E'};
+/// \brief Version of edit journal format (2 - hash of the part before the edit is kept)
+const cnv::dword EditVersion = 2;
+/// \brief Size of fields of edit journal before the part of header
+const cnv::dword EditHeadSize = 48;
+
+/// \brief Clearing instance fields (edit instance)
+void FstEdit::Clear()
+{
+	ArchivePath.erase(ArchivePath.begin(), ArchivePath.end());
+	Entry = 0;
+	EntryPath.erase(EntryPath.begin(), EntryPath.end());
+	NewPath.erase(NewPath.begin(), NewPath.end());
+	OldSize = 0;
+	NewSize = 0;
+	AppendedSize = 0;
+	WrittenSize = 0;
+	Recovered = false;
+}
+/// \brief Replacing data of file-entry by contents of file
+/// \param[in] local_Input Path to the archive
+/// \param[in] local_Entry Path of file-entry in the archive (or its ordinal number)
+/// \param[in] local_File Path to file with new data
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details New data is appended at the end of the archive and made durable before the record of table of contents is
+/// changed, so the archive never refers to data which is not written
+int FstEdit::Replace(char* local_Input, std::string local_Entry, char* local_File)
+{
+	if(Open(local_Input, local_Entry))
+		return 1;
+
+	cnv::qword Offset = Archive.GetFileSize();
+	cnv::qword CompressSize = 0;
+	if(AppendData(local_File, CompressSize))
+		return 1;
+	Archive.SetEntry(Entry, Offset, CompressSize, NewSize, Archive.GetFlags(Entry) & ~static_cast<cnv::dword>(EF_DICTIONARY));
+
+	std::ostringstream Record;
+	Archive.WriteRecord(Record, Entry);
+	return Commit(Archive.GetRecordOffset(Entry), Record.str(), Offset + CompressSize);
+}
+/// \brief Deleting file-entry from table of contents
+/// \param[in] local_Input Path to the archive
+/// \param[in] local_Entry Path of file-entry in the archive (or its ordinal number)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Records after the deleted one are moved, so the header is rewritten from its beginning. Header becomes
+/// shorter, data of the file-entry and the freed end of header stay in the archive as unreferenced space
+int FstEdit::Remove(char* local_Input, std::string local_Entry)
+{
+	if(Open(local_Input, local_Entry))
+		return 1;
+
+	Archive.RemoveEntry(Entry);
+	std::vector<cnv::qword> Offsets(Archive.GetAmountEntries());
+	for(cnv::unsint i = 0; i < Offsets.size(); i++)
+		Offsets.at(i) = Archive.GetDataOffset(i);
+	std::ostringstream Head;
+	if(Archive.WriteHead(Head, Offsets, Archive.GetDictionaryOffset()))
+		return 1;
+	return Commit(0, Head.str(), Archive.GetFileSize());
+}
+/// \brief Changing path of file-entry
+/// \param[in] local_Input Path to the archive
+/// \param[in] local_Entry Path of file-entry in the archive (or its ordinal number)
+/// \param[in] local_Path New path of file-entry
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstEdit::Rename(char* local_Input, std::string local_Entry, std::string local_Path)
+{
+	if(Open(local_Input, local_Entry))
+		return 1;
+
+	//Path field of record holds 250 characters with terminating zero, paths in the archive must be unique
+	NewPath = local_Path;
+	bool Valid = !NewPath.empty() && NewPath.size() < 250;
+	std::string Key = GetComparablePath(NewPath);
+	for(cnv::unsint i = 0; Valid && i < Archive.GetAmountEntries(); i++)
+	{
+		if(i != Entry && GetComparablePath(Archive.GetPath(i)) == Key)
+			Valid = false;
+	}
+	if(!Valid)
+	{
+		SendAlert(66, NewPath);//New path of file-entry is empty, longer than 249 characters or already exists in the archive.
+		return 1;
+	}
+	Archive.SetPath(Entry, NewPath);
+
+	std::ostringstream Record;
+	Archive.WriteRecord(Record, Entry);
+	return Commit(Archive.GetRecordOffset(Entry), Record.str(), Archive.GetFileSize());
+}
+/// \brief Loading the archive and finding edited file-entry
+/// \param[in] local_Input Path to the archive
+/// \param[in] local_Entry Path of file-entry in the archive (or its ordinal number)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Interrupted edit of the archive is completed first
+int FstEdit::Open(char* local_Input, std::string local_Entry)
+{
+	//Clearing the instance fields
+	Clear();
+	ArchivePath = local_Input;
+
+	if(Recover() || Archive.Load(local_Input) || FindEntry(local_Entry))
+		return 1;
+	EntryPath = Archive.GetPath(Entry);
+	OldSize = Archive.GetUncompressSize(Entry);
+	return 0;
+}
+/// \brief Finding file-entry by path (case and kind of slash are not important) or by ordinal number
+/// \param[in] local_Input Path of file-entry or its ordinal number
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstEdit::FindEntry(std::string local_Input)
+{
+	std::string Key = GetComparablePath(local_Input);
+	for(cnv::unsint i = 0; i < Archive.GetAmountEntries(); i++)
+	{
+		if(GetComparablePath(Archive.GetPath(i)) == Key)
+		{
+			Entry = i;
+			return 0;
+		}
+	}
+	if(!local_Input.empty() && local_Input.find_first_not_of("0123456789") == std::string::npos)
+	{
+		cnv::qword Number = strtoull(local_Input.data(), nullptr, 10);
+		if(Number < Archive.GetAmountEntries())
+		{
+			Entry = static_cast<cnv::unsint>(Number);
+			return 0;
+		}
+	}
+	SendAlert(65, local_Input);//File-entry is not found in the archive.
+	return 1;
+}
+/// \brief Completing interrupted edit of the archive
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Journal is written to the archive again only if it belongs to the archive: size of the archive is equal to
+/// the expected one and the part of header still holds bytes from before the edit (bytes equal to the part mean that
+/// the archive was written, only removal of the journal is left). Otherwise the archive was replaced or changed after
+/// the journal was written (or the part was written only partly), it is refused and the journal is kept. Incomplete
+/// journal means that the edit was interrupted before the archive was touched, so it is discarded
+int FstEdit::Recover()
+{
+	std::string JournalPath = GetEditJournalPath(ArchivePath);
+	ifstream Journal(JournalPath, ios::in|ios::binary);
+	if(!Journal.is_open())
+		return 0;
+
+	char Signature[4];
+	cnv::dword Version = 0;
+	cnv::qword ExpectedSize = 0;
+	cnv::qword Offset = 0;
+	cnv::qword Size = 0;
+	cnv::qword OldHash = 0;
+	cnv::qword Hash = 0;
+	std::string Region;
+	cnv::qword JournalSize = chf::GetFileSize(Journal);
+	bool Valid = (StreamRead(Journal, Signature, 4) == 0 && std::equal(Signature, Signature + 4, EditSignature) &&
+		DwordRead(Journal, Version) == 0 && Version == EditVersion && QwordRead(Journal, ExpectedSize) == 0 &&
+		QwordRead(Journal, Offset) == 0 && QwordRead(Journal, Size) == 0 && QwordRead(Journal, OldHash) == 0 &&
+		QwordRead(Journal, Hash) == 0 && JournalSize == EditHeadSize + Size && Size <= INT_MAX);
+	if(Valid)
+	{
+		Region.resize(Size);
+		Valid = (StreamRead(Journal, &Region[0], Size) == 0 &&
+			chf::HashData(reinterpret_cast<const cnv::byte*>(Region.data()), Region.size()) == Hash);
+	}
+	Journal.close();
+	ClearError();//Errors of reading incomplete journal are expected
+
+	if(Valid)
+	{
+		FILE* Target = fopen(ArchivePath.data(), "r+b");
+		if(Target == nullptr)
+		{
+			SendAlert(69, ArchivePath);//Can't write the archive file. File is read-only or locked, or disk is full.
+			return 1;
+		}
+
+		//Journal belongs to the archive only while the archive is in state between the edit and its completion
+		cnv::qword FileSize = 0;
+		cnv::qword Current = 0;
+		if(!chf::GetFileStat(ArchivePath, FileSize) || ReadRegion(Target, Offset, Size, Current))
+		{
+			fclose(Target);
+			return 1;
+		}
+		if(FileSize != ExpectedSize || (Current != OldHash && Current != Hash))
+		{
+			fclose(Target);
+			SendAlert(73, JournalPath);//Edit journal doesn't match the archive (size or header differs). Remove journal <archive>.edit if the archive was replaced.
+			return 1;
+		}
+		int Result = (Current == Hash) ? 0 : WriteRegion(Target, Offset, Region.data(), Region.size());
+		fclose(Target);
+		if(Result)
+			return 1;
+		Recovered = true;
+	}
+	return ClearEditJournal(ArchivePath);
+}
+/// \brief Appending contents of file to the end of the archive
+/// \param[in] local_Input Path to the file
+/// \param[out] CompressSize Size of appended data (equal to uncompressed size - data is stored)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Data is compressed as by packing, unless the replaced file-entry was stored: compressed data which is not
+/// smaller than the file is stored, files larger than 50 MB are always stored and copied by blocks. Shared dictionary
+/// is not used. Appended data is flushed to disk before return
+int FstEdit::AppendData(char* local_Input, cnv::qword& CompressSize)
+{
+	ifstream AddedFile(local_Input, ios::in|ios::binary);
+	if(!AddedFile.is_open())
+	{
+		SendAlert(9, local_Input);//Can't open file.
+		return 1;
+	}
+	NewSize = chf::GetFileSize(AddedFile);
+	CompressSize = NewSize;
+	if(Archive.GetFormat() == AF_FST && NewSize > 0xFFFFFFFFULL)
+	{
+		SendAlert(45, local_Input);//File limit exceeded. Files larger than 4 GB can't be stored in the archive.
+		return 1;
+	}
+
+	const cnv::dword SizeLimit = 1024*1024*50;//50 MB
+	std::vector<cnv::byte> CopyBuffer;
+	std::vector<cnv::byte> CompressedBuffer;
+	chf::MemoryLease Lease;
+	if(NewSize != 0 && NewSize <= SizeLimit && Archive.GetCompressFlag(Entry) != CF_UNCOMPRESS)
+	{
+		Lease.Acquire(NewSize * 2 + NewSize / 2 + 16);
+		CopyBuffer.resize(NewSize);
+		if(StreamRead(AddedFile, reinterpret_cast<char*>(CopyBuffer.data()), NewSize))
+			return 1;
+
+		//LZ output can be larger than input (up to 12 bits per byte)
+		CompressedBuffer.resize(NewSize + NewSize / 2 + 16);
+		cnv::dword CompressedSize = static_cast<cnv::dword>(SerialCompress(CompressedBuffer.data(), CopyBuffer.data(), static_cast<unsigned long>(NewSize)));
+		if(CompressedSize < NewSize)
+			CompressSize = CompressedSize;
+	}
+	if(Archive.GetFormat() == AF_FST && Archive.GetFileSize() + CompressSize > 0xFFFFFFFFULL)
+	{
+		SendAlert(51, local_Input);//Archive size exceeds 4 GB. Classic archive format can't address it (use --fst64 option).
+		return 1;
+	}
+
+	FILE* Target = fopen(ArchivePath.data(), "ab");
+	if(Target == nullptr)
+	{
+		SendAlert(69, ArchivePath);//Can't write the archive file. File is read-only or locked, or disk is full.
+		return 1;
+	}
+	bool Written = true;
+	if(CompressSize != NewSize)
+	{
+		Written = (fwrite(CompressedBuffer.data(), 1, CompressSize, Target) == CompressSize);
+	}
+	else if(!CopyBuffer.empty())
+	{
+		Written = (fwrite(CopyBuffer.data(), 1, CompressSize, Target) == CompressSize);
+	}
+	else
+	{
+		const cnv::dword BlockSize = 1024*64;//64 KB
+		std::vector<char> Block(BlockSize);
+		for(cnv::qword Left = NewSize; Written && Left != 0; )
+		{
+			cnv::dword Part = (Left > BlockSize) ? BlockSize : static_cast<cnv::dword>(Left);
+			if(StreamRead(AddedFile, Block.data(), static_cast<int>(Part)))
+			{
+				fclose(Target);
+				return 1;
+			}
+			Written = (fwrite(Block.data(), 1, Part, Target) == Part);
+			Left -= Part;
+		}
+	}
+	Written = Written && fflush(Target) == 0 && _commit(_fileno(Target)) == 0;
+	fclose(Target);
+	if(!Written)
+	{
+		SendAlert(69, ArchivePath);//Can't write the archive file. File is read-only or locked, or disk is full.
+		return 1;
+	}
+	AppendedSize = CompressSize;
+	return 0;
+}
+/// \brief Writing changed part of header through the journal
+/// \param[in] Offset Offset of the part in the archive
+/// \param[in] Region Bytes of the part
+/// \param[in] ExpectedSize Size of the archive which the header refers to (appended data included)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Journal (signature, version, expected size, offset and size of the part, hash of bytes of the archive at
+/// the part before the edit, hash of the part, then the part itself) is flushed to disk before the archive is touched,
+/// and removed after the part is flushed to the archive
+int FstEdit::Commit(cnv::qword Offset, const std::string& Region, cnv::qword ExpectedSize)
+{
+	EVENT_SCOPE(Event, "Write table of contents", evt::NoArg);
+
+	FILE* Target = fopen(ArchivePath.data(), "r+b");
+	if(Target == nullptr)
+	{
+		SendAlert(69, ArchivePath);//Can't write the archive file. File is read-only or locked, or disk is full.
+		return 1;
+	}
+
+	//Write-ahead journal
+	cnv::qword OldHash = 0;
+	if(ReadRegion(Target, Offset, Region.size(), OldHash))
+	{
+		fclose(Target);
+		return 1;
+	}
+	std::string JournalPath = GetEditJournalPath(ArchivePath);
+	std::vector<cnv::byte> Head(EditSignature, EditSignature + 4);
+	chf::PutDword(Head, EditVersion);
+	chf::PutQword(Head, ExpectedSize);
+	chf::PutQword(Head, Offset);
+	chf::PutQword(Head, Region.size());
+	chf::PutQword(Head, OldHash);
+	chf::PutQword(Head, chf::HashData(reinterpret_cast<const cnv::byte*>(Region.data()), Region.size()));
+	FILE* Journal = fopen(JournalPath.data(), "wb");
+	bool Written = (Journal != nullptr && fwrite(Head.data(), 1, Head.size(), Journal) == Head.size() &&
+		fwrite(Region.data(), 1, Region.size(), Journal) == Region.size() && fflush(Journal) == 0 && _commit(_fileno(Journal)) == 0);
+	if(Journal != nullptr)
+		fclose(Journal);
+	if(!Written)
+	{
+		fclose(Target);
+		SendAlert(67, JournalPath);//Can't write edit journal file. File is locked or disk is full.
+		ClearEditJournal(ArchivePath);
+		return 1;
+	}
+
+	//The archive itself (journal is kept if writing fails, the next edit completes it)
+	int Result = WriteRegion(Target, Offset, Region.data(), Region.size());
+	fclose(Target);
+	if(Result || ClearEditJournal(ArchivePath))
+		return 1;
+	WrittenSize = Region.size();
+	return 0;
+}
+/// \brief Hashing part of the archive
+/// \param[in] Target File of the archive opened for update
+/// \param[in] Offset Offset of the part in the archive
+/// \param[in] Size Size of the part (bytes past the end of the archive are not hashed)
+/// \param[out] Hash Hash of bytes of the part
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstEdit::ReadRegion(FILE* Target, cnv::qword Offset, cnv::qword Size, cnv::qword& Hash)
+{
+	//Header lies at beginning of the archive, so its offsets fit into position of stdio
+	if(Offset > LONG_MAX || fseek(Target, static_cast<long>(Offset), SEEK_SET) != 0)
+	{
+		SendAlert(13, ArchivePath);//Invalid position indicator value was received in the archive file.
+		return 1;
+	}
+	std::vector<cnv::byte> Data(Size);
+	size_t Read = fread(Data.data(), 1, Data.size(), Target);
+	if(ferror(Target))
+	{
+		SendAlert(28, ArchivePath);//ReadStream - Read error on input operation.
+		return 1;
+	}
+	Hash = chf::HashData(Data.data(), Read);
+	return 0;
+}
+/// \brief Writing part of header to the archive and flushing it to disk
+/// \param[in] Target File of the archive opened for update
+/// \param[in] Offset Offset of the part in the archive
+/// \param[in] Data Bytes of the part
+/// \param[in] Size Size of the part
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstEdit::WriteRegion(FILE* Target, cnv::qword Offset, const char* Data, cnv::qword Size)
+{
+	//Header lies at beginning of the archive, so its offsets fit into position of stdio
+	bool Written = (Offset <= LONG_MAX && fseek(Target, static_cast<long>(Offset), SEEK_SET) == 0 &&
+		fwrite(Data, 1, Size, Target) == Size && fflush(Target) == 0 && _commit(_fileno(Target)) == 0);
+	if(!Written)
+	{
+		SendAlert(69, ArchivePath);//Can't write the archive file. File is read-only or locked, or disk is full.
+		return 1;
+	}
+	return 0;
+}
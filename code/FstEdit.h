@@ -0,0 +1,95 @@
+/// \file
+/// \brief Fst edit module (Header)
+/// \author SpinelDusk
+
+#pragma GCC diagnostic ignored "-Wpadded"						//Disable warning: Padding class -- with -- byte to align --
+
+#pragma once//This header guard directive designed to cause the current source file to be included only once in a single compilation
+#ifndef FstEditH
+#define FstEditH
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <climits>
+#pragma hdrstop//This directive terminates the list of header files eligible for precompilation (Using ONLY for <standard> headers, no "custom")
+
+#include "FstFile.h"
+#include "FstDiff.h"
+
+/// \brief The class contains data and functions necessary for changing single file-entry of FST file in place
+/// \details Data of replaced file-entry is appended at the end of the archive, only its record of table of contents is
+/// rewritten; deletion and renaming change header only. Old data stays in the archive as unreferenced space (see
+/// FstCompact). Changed bytes of header are written to journal beside the archive before the archive itself, so
+/// interrupted edit is completed by the next edit (and reading modes refuse the archive until then)
+class FstEdit
+{
+	private:
+	/// \brief Edited archive
+	FstUnpack Archive;
+	/// \brief Path of the archive
+	std::string ArchivePath;
+	/// \brief Ordinal number of edited file-entry
+	cnv::unsint Entry;
+	/// \brief Path of edited file-entry (before the edit)
+	std::string EntryPath;
+	/// \brief New path of file-entry (renaming only)
+	std::string NewPath;
+	/// \brief Uncompressed size of file-entry before the edit
+	cnv::qword OldSize;
+	/// \brief Uncompressed size of file-entry after replacement
+	cnv::qword NewSize;
+	/// \brief Size of data appended to the archive
+	cnv::qword AppendedSize;
+	/// \brief Size of header part written to the archive
+	cnv::qword WrittenSize;
+	/// \brief Flag of completion of interrupted edit found in journal
+	bool Recovered;
+
+	public:
+	FstEdit()
+	{
+		Clear();
+	}
+	~FstEdit()
+	{
+
+	}
+
+	int Replace(char*, std::string, char*);
+	int Remove(char*, std::string);
+	int Rename(char*, std::string, std::string);
+
+	/// \brief Get archive path
+	std::string GetArchivePath(){return ArchivePath;}
+	/// \brief Get amount of table of contents entries (after the edit)
+	cnv::dword GetAmountEntries(){return Archive.GetAmountEntries();}
+	/// \brief Get ordinal number of edited file-entry
+	cnv::unsint GetEntry(){return Entry;}
+	/// \brief Get path of edited file-entry (before the edit)
+	std::string GetEntryPath(){return EntryPath;}
+	/// \brief Get new path of file-entry (renaming only)
+	std::string GetNewPath(){return NewPath;}
+	/// \brief Get uncompressed size of file-entry before the edit
+	cnv::qword GetOldSize(){return OldSize;}
+	/// \brief Get uncompressed size of file-entry after replacement
+	cnv::qword GetNewSize(){return NewSize;}
+	/// \brief Get size of data appended to the archive
+	cnv::qword GetAppendedSize(){return AppendedSize;}
+	/// \brief Get size of header part written to the archive
+	cnv::qword GetWrittenSize(){return WrittenSize;}
+	/// \brief Get flag of completion of interrupted edit found in journal
+	bool IsRecovered(){return Recovered;}
+
+	private:
+	void Clear();
+	int Open(char*, std::string);
+	int FindEntry(std::string);
+	int Recover();
+	int AppendData(char*, cnv::qword&);
+	int Commit(cnv::qword, const std::string&, cnv::qword);
+	int ReadRegion(FILE*, cnv::qword, cnv::qword, cnv::qword&);
+	int WriteRegion(FILE*, cnv::qword, const char*, cnv::qword);
+};
+#endif
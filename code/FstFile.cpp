@@ -10,16 +10,73 @@
 #pragma package(smart_init)//Ensures that packaged units are initialized in the order determined by their dependencies
 
 #include "FstFile.h"
+#include "FstDiff.h"
 
 extern ErrorData LastError;///< Defined in ErrorDescription.cpp
 /// \brief Macro makes it easy to write SendAlert function in the code
 #define SendAlert(a,b) SendAlert(__FILE__,__FUNCSIG__,__LINE__,a,3,b)
 
+/// \brief Data offset of marker entry of extended archive (lies outside any archive of classic format)
+const cnv::dword Fst64MarkerOffset = 0xFFFFFFFF;
+/// \brief Amount of entries in marker entry (single record, so readers of classic format don't allocate large table)
+const cnv::dword Fst64MarkerAmount = 1;
+/// \brief Path of marker entry of extended archive (shown by readers of classic format; characters '<' and '>' aren't
+/// allowed in file names, so their unpacking fails on creating the output file, before data is read)
+const char Fst64MarkerPath[] = "<FST64 extended archive. Use FstFile 1.1 or later to read it>";
+/// \brief Signature of extended archive header
+const char Fst64Signature[4] = {'F', 'S', '6', '4'};
+/// \brief Version of extended archive format
+const cnv::dword Fst64Version = 1;
+/// \brief Size of extended archive header before table of contents (entries amount, marker entry, signature, version, entries amount)
+const cnv::dword Fst64HeadSize = 4 + 262 + 4 + 4 + 8;
+/// \brief Size of table of contents record of extended archive (offset, sizes, reserved flags, path)
+const cnv::dword Fst64RecordSize = 8 + 8 + 8 + 4 + 250;
+/// \brief Version of extended archive format with shared dictionary
+const cnv::dword Fst64DictionaryVersion = 2;
+/// \brief Size of extended archive header fields which follow entries amount in version with shared dictionary (dictionary offset and size)
+const cnv::dword Fst64DictionaryFields = 8 + 4;
+/// \brief Limit of size of file-entry compressed with shared dictionary
+const cnv::dword DictionaryEntryLimit = 1024*16;//16 KB
+/// \brief Limit of size of shared dictionary
+const cnv::dword DictionaryLimit = 1024*16;//16 KB
+/// \brief Limit of data taken into shared dictionary from single file-entry
+const cnv::dword DictionarySampleLimit = 1024;//1 KB
+/// \brief Signature of unpack journal (first word of its first line)
+const char JournalSignature[] = "FSTJ";
+/// \brief Amount of journal records between watermarks (each watermark flushes the journal to disk)
+const cnv::unsint JournalSyncInterval = 64;
+/// \brief Value of journal map for file-entries without record
+const cnv::qword JournalNoRecord = ~0ULL;
+/// \brief Space after uncompressed data in output buffer of library LZ-decompression function (it doesn't know size of the buffer)
+const cnv::dword LibraryOutputSlack = 16;
+/// \brief Maximum size of read window of unpacking (data of several file-entries read by single request)
+const cnv::dword ReadWindowSize = 1024*1024*4;//4 MB
+/// \brief Maximum compressed size of file-entry read through the window (larger file-entries are read directly)
+const cnv::dword ReadWindowEntryLimit = 1024*1024;//1 MB
+/// \brief Maximum gap between data of file-entries in the same read window
+const cnv::dword ReadWindowGap = 1024*64;//64 KB
+/// \brief Size of the first read of compressed data when reading range of file-entry (each next read is twice larger)
+const cnv::dword RangeReadStart = 1024*4;//4 KB
+/// \brief Size of beginning of file-entry decoded to check that it is an archive (header, first record and signature of extended archive)
+const cnv::dword NestedProbeSize = 4 + 262 + 4;
+/// \brief Maximum nesting level of traversed archives (archives nested deeper are handled as usual files)
+const cnv::dword NestedDepthLimit = 8;
+/// \brief Maximum total size of files compressed by dry run of packing (compressed size of larger inputs is estimated by sample)
+const cnv::qword DrySampleLimit = 1024*1024*256;//256 MB
+/// \brief Maximum size of data compressed by directory packing while the walk is running (it is written after the walk)
+const cnv::qword PrepareAheadLimit = 1024*1024*64;//64 MB
+
 /// \brief Clearing instance fields (pack instance)
 void FstPack::Clear()
 {
 	AmountEntries = 0;
 	FileSize = 0;
+	Padding = 0;
+	AmountTraced = 0;
+	ProjectedSize = 0;
+	AmountSampled = 0;
+	EstimatedTime = 0;
+	DryRunTime = 0;
 	ArchivePath.erase(ArchivePath.begin(), ArchivePath.end());
 	ListPath.erase(ListPath.begin(), ListPath.end());
 	if(OpenList.is_open())
@@ -27,6 +84,11 @@ void FstPack::Clear()
 	if(OpenReceiver.is_open())
 		OpenReceiver.close();
 	TOCList.erase(TOCList.begin(), TOCList.end());
+	ScanReport.erase(ScanReport.begin(), ScanReport.end());
+	RuleList.erase(RuleList.begin(), RuleList.end());
+	EmitList = false;
+	RootPath.erase(RootPath.begin(), RootPath.end());
+	SharedDictionary = lzc::Dictionary();
 }
 /// \brief Fst-file packing control function
 /// \param[in] local_Input Path to the list of files to be packed
@@ -65,6 +127,32 @@ int FstPack::Pack(char* local_Input, char* local_Output)
 		return 1;
 	}
 
+	//Shared dictionary from small file-entries (if dictionary mode is set)
+	std::vector<Entry*> Candidates;
+	for(cnv::unsint i = 0; i < AmountEntries; i++)
+	{
+		if(TOCList.at(i).CompressFlag == CF_COMPRESS && TOCList.at(i).UncompressSize <= DictionaryEntryLimit)
+			Candidates.push_back(&TOCList.at(i));
+	}
+	if(BuildDictionary(Candidates))
+	{
+		OpenList.close();
+		return 1;
+	}
+
+	//Dry run: sizes and time of packing are estimated, the archive is not created
+	if(DryRun)
+	{
+		OpenList.close();
+		ArchivePath = local_Output;
+		return EstimatePack();
+	}
+	if(ClearEditJournal(local_Output))
+	{
+		OpenList.close();
+		return 1;
+	}
+
 	//Create an output file, the future fst-archive
 	OpenReceiver.open(local_Output, ios::out|ios::binary);
 	if(!OpenReceiver.is_open())
@@ -127,43 +215,27 @@ int FstPack::ReadOpenList(ifstream& List)
 		}
 
 		//Instruction processing
-		if(TempPath.at(1) == 0x20 && TempPath.size() > 2)
+		if(TempPath.size() > 2 && TempPath.at(1) == 0x20)
 		{
 			TOCList.push_back(Entry());												//Add new cell into TOCList vector
 			PackCommand = static_cast<char>(tolower(TempPath.at(0)));				//Get command symbol
 			TempPath.erase(0, 2);													//Erase 2 first symbols (command symbol + single space)
 			TOCList.at(AmountEntries).RealPath = ActiveDirectory + TempPath;		//Get full path to the file on the hard drive
-			ifstream TryToOpen(TOCList.at(AmountEntries).RealPath);					//Create stream to open the file from the list
-			if(TryToOpen)
+			switch(PackCommand)
 			{
-				TryToOpen.close();
-				TOCList.at(AmountEntries).UncompressSize = chf::GetFileSize(TOCList.at(AmountEntries).RealPath);
-				if(TOCList.at(AmountEntries).UncompressSize == 0)
-				{
-					SendAlert(4, TOCList.at(AmountEntries).RealPath);//The file is empty.
-					return 1;
-				}
-				switch(PackCommand)
-				{
-					case 'c':		//Add as compressed file
-						TOCList.at(AmountEntries).CompressFlag = CF_COMPRESS;
-						break;
+				case 'c':		//Add as compressed file
+					TOCList.at(AmountEntries).CompressFlag = CF_COMPRESS;
+					break;
 
-					case 'u':		//Add as uncompressed file
-						TOCList.at(AmountEntries).CompressFlag = CF_UNCOMPRESS;
-						break;
+				case 'u':		//Add as uncompressed file
+					TOCList.at(AmountEntries).CompressFlag = CF_UNCOMPRESS;
+					break;
 
-					default:		//Unknown command
-						SendAlert(5, ListPath);//Instruction read error. Unknown command. Check if the command is entered correctly.
-						return 1;
-				}
-				TOCList.at(AmountEntries).Path = TempPath;
+				default:		//Unknown command
+					SendAlert(5, ListPath);//Instruction read error. Unknown command. Check if the command is entered correctly.
+					return 1;
 			}
-			else
-			{
-				SendAlert(6, ListPath);//Instruction read error. Packing file not found.
-				return 1;
-            }
+			TOCList.at(AmountEntries).Path = TempPath;
 		}
 		else
 		{
@@ -178,15 +250,633 @@ int FstPack::ReadOpenList(ifstream& List)
 		SendAlert(8, ListPath);//No entries were received.
 		return 1;
 	}
+
+	//Getting sizes of all files from the list
+	return ScanFiles();
+}
+/// \brief Getting sizes of files from the list-file
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Each file is checked with single metadata request on worker threads.
+/// All missing, empty and too large files are collected into ScanReport, instead of stopping on the first one
+int FstPack::ScanFiles()
+{
+	EVENT_SCOPE(Event, "Scan files", evt::NoArg);
+
+	//Result of check for each file: 0 - no errors, otherwise - index of error
+	std::vector<cnv::unsint> Result(AmountEntries, 0);
+	chf::ParallelFor(AmountEntries, [this, &Result](cnv::unsint i, cnv::unsint)
+	{
+		cnv::qword Size = 0;
+		if(!chf::GetFileStat(TOCList.at(i).RealPath, Size))
+			Result.at(i) = 6;//Instruction read error. Packing file not found.
+		else if(Size == 0)
+			Result.at(i) = 4;//The file is empty.
+		else if(Format == AF_FST && Size > 0xFFFFFFFFULL)
+			Result.at(i) = 45;//File limit exceeded. Files larger than 4 GB can't be stored in the archive.
+		else
+			TOCList.at(i).UncompressSize = Size;
+	});
+
+	//Forming the report
+	cnv::unsint FirstError = 0;
+	for(cnv::unsint i = 0; i < AmountEntries; i++)
+	{
+		if(Result.at(i) == 0)
+			continue;
+		if(FirstError == 0)
+			FirstError = i + 1;
+		switch(Result.at(i))
+		{
+			case 6:
+				ScanReport.push_back("Not found : " + TOCList.at(i).RealPath);
+			break;
+			case 4:
+				ScanReport.push_back("Empty     : " + TOCList.at(i).RealPath);
+			break;
+			default:
+				ScanReport.push_back("Too large : " + TOCList.at(i).RealPath);
+			break;
+		}
+	}
+	if(FirstError != 0)
+	{
+		cnv::unsint Count = FirstError - 1;
+		std::string Additional = TOCList.at(Count).RealPath;
+		if(ScanReport.size() > 1)
+			Additional += " (and " + INTtoSTRING(static_cast<int>(ScanReport.size() - 1)) + " more)";
+		switch(Result.at(Count))
+		{
+			case 6:
+				SendAlert(6, Additional);//Instruction read error. Packing file not found.
+			break;
+			case 4:
+				SendAlert(4, Additional);//The file is empty.
+			break;
+			default:
+				SendAlert(45, Additional);//File limit exceeded. Files larger than 4 GB can't be stored in the archive.
+			break;
+		}
+		return 1;
+	}
+	return 0;
+}
+/// \brief State of directory walk shared by worker threads
+struct FstPack::WalkState
+{
+	/// \brief Mutex for all fields of the state
+	std::mutex Lock;
+	/// \brief Signal about new work or end of work
+	std::condition_variable Signal;
+	/// \brief Directories waiting for walk (paths relative to root, with trailing separator)
+	std::deque<std::string> Directories;
+	/// \brief Found entries
+	std::vector<Entry> Found;
+	/// \brief Data of found entries compressed while the walk is running (parallel to Found, empty - not compressed)
+	std::vector<std::vector<cnv::byte>> Prepared;
+	/// \brief Amount of found entries taken for compression while the walk is running
+	cnv::unsint NextPrepare;
+	/// \brief Size of data held in Prepared and reserved by compressing workers
+	cnv::qword PreparedSize;
+	/// \brief Flag of compression while the walk is running (off with memory budget)
+	bool PrepareAhead;
+	/// \brief Part of memory budget held by data in Prepared (counted only, the budget is not set)
+	chf::MemoryLease PreparedLease;
+	/// \brief Amount of workers busy with walking of directory
+	cnv::unsint Active;
+	/// \brief Flag of error in one of workers
+	bool Failed;
+	/// \brief Paths which must not be packed (the archive itself, list-file), in comparable form
+	std::vector<std::string> Skip;
+	/// \brief Errors of workers
+	ErrorBatch Errors;
+};
+/// \brief Packing directory tree into a new archive without list-file
+/// \param[in] local_Input Path to the root directory
+/// \param[in] local_Output Path to the created archive
+/// \param[in] local_Rules Path to the rules file (nullptr - pack everything compressed)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Directories are walked on worker threads. Workers which find no directory to walk compress files found
+/// so far (up to PrepareAheadLimit of data), so compression overlaps the walk. The archive header size depends on
+/// amount of entries, so data is written only when all files are found: entries are sorted by path (so the result
+/// doesn't depend on the walk order), the rest of them is compressed on worker threads, and all data is written
+/// straight into the archive in placement order. Entries which may get the shared dictionary are compressed after the
+/// walk, as the dictionary is built from all found files. With memory budget everything is compressed after the walk,
+/// since data compressed ahead would hold the budget needed by entries written before it
+int FstPack::PackDirectory(char* local_Input, char* local_Output, char* local_Rules)
+{
+	//Clearing the instance fields
+	Clear();
+
+	//Reading rules
+	if(local_Rules != nullptr && ReadRules(local_Rules))
+		return 1;
+
+	//Root directory without trailing separator
+	RootPath = local_Input;
+	while(RootPath.size() > 1 && (RootPath.back() == '\\' || RootPath.back() == '/'))
+		RootPath.pop_back();
+	if(!chf::IsDirectoryExists(RootPath))
+	{
+		SendAlert(19, RootPath);//Directory does not exist.
+		return 1;
+	}
+
+	//List-file is created in the root directory, so paths in it are relative to the root (as ReadOpenList expects)
+	std::string OutputPath = local_Output;
+	chf::PathPart NameOfOutput = chf::GetNamePart(OutputPath);
+	if(EmitList)
+		ListPath = RootPath + "\\" + std::string(NameOfOutput.Data, NameOfOutput.Size) + ".list";
+
+	WalkState State;
+	State.NextPrepare = 0;
+	State.PreparedSize = 0;
+	State.PrepareAhead = (chf::GetMemoryLimit() == 0);
+	State.Active = 0;
+	State.Failed = false;
+	State.Directories.push_back("");
+	State.Skip.push_back(GetComparablePath(local_Output));
+	State.Skip.push_back(GetComparablePath(ListPath));
+
+	//Walking on worker threads
+	cnv::unsint Workers = chf::GetWorkerCount();
+	std::vector<std::thread> Pool;
+	for(cnv::unsint w = 0; w < Workers; w++)
+	{
+		Pool.push_back(std::thread([this, &State]()
+		{
+			std::unique_lock<std::mutex> Lock(State.Lock);
+			for(;;)
+			{
+				//Compression of found files is useful only while the walk is running
+				auto CanPrepare = [&State]()
+				{
+					return State.PrepareAhead && State.Active != 0 && State.NextPrepare < State.Found.size() &&
+						State.PreparedSize < PrepareAheadLimit;
+				};
+				State.Signal.wait(Lock, [&State, &CanPrepare]()
+				{
+					return State.Failed || !State.Directories.empty() || State.Active == 0 || CanPrepare();
+				});
+				if(State.Failed)
+					return;
+				if(State.Directories.empty() && CanPrepare())
+				{
+					PrepareAhead(State, Lock);
+					continue;
+				}
+				if(State.Directories.empty())
+				{
+					//Nothing to do and nobody can add new work
+					State.Signal.notify_all();
+					return;
+				}
+				std::string Directory = State.Directories.front();
+				State.Directories.pop_front();
+				State.Active++;
+				Lock.unlock();
+				ClearThreadError();
+				int Result = WalkDirectory(Directory, State);
+				Lock.lock();
+				State.Active--;
+				if(Result)
+				{
+					State.Failed = true;
+					State.Errors.AddThreadError();
+				}
+				State.Signal.notify_all();
+			}
+		}));
+	}
+	for(cnv::unsint w = 0; w < Workers; w++)
+	{
+		Pool.at(w).join();
+	}
+	if(State.Failed)
+	{
+		State.Errors.Publish();
+		return 1;
+	}
+
+	//Entries in order of paths (data compressed during the walk follows its entry)
+	std::vector<cnv::unsint> Order(State.Found.size());
+	for(cnv::unsint i = 0; i < Order.size(); i++)
+		Order.at(i) = i;
+	std::sort(Order.begin(), Order.end(), [&State](cnv::unsint a, cnv::unsint b)
+	{
+		return State.Found.at(a).Path < State.Found.at(b).Path;
+	});
+	std::vector<std::vector<cnv::byte>> Prepared(Order.size());
+	TOCList.reserve(Order.size());
+	for(cnv::unsint i = 0; i < Order.size(); i++)
+	{
+		TOCList.push_back(std::move(State.Found.at(Order.at(i))));
+		if(Order.at(i) < State.Prepared.size())
+			Prepared.at(i).swap(State.Prepared.at(Order.at(i)));
+	}
+	AmountEntries = TOCList.size();
+	if(AmountEntries == 0)
+	{
+		SendAlert(8, RootPath);//No entries were received.
+		return 1;
+	}
+
+	//Shared dictionary from small file-entries (if dictionary mode is set)
+	std::vector<Entry*> Candidates;
+	for(cnv::unsint i = 0; i < AmountEntries; i++)
+	{
+		if(TOCList.at(i).CompressFlag == CF_COMPRESS && TOCList.at(i).UncompressSize <= DictionaryEntryLimit)
+			Candidates.push_back(&TOCList.at(i));
+	}
+	if(BuildDictionary(Candidates) || ClearEditJournal(local_Output))
+		return 1;
+
+	//Create an output file, the future fst-archive
+	OpenReceiver.open(local_Output, ios::out|ios::binary);
+	if(!OpenReceiver.is_open())
+	{
+		SendAlert(3, local_Output);//Can't open output file.
+		return 1;
+	}
+	ArchivePath = local_Output;
+
+	//Putting data and head data to new archive
+	if(FillParallel(Prepared))
+	{
+		OpenReceiver.close();
+		remove(local_Output);
+		return 1;
+	}
+	FillHead();
+	OpenReceiver.close();
+
+	//List-file for reproducing the archive with Pack mode
+	if(EmitList && WriteListFile())
+		return 1;
+	return 0;
+}
+/// \brief Reading rules for directory packing
+/// \param[in] local_Input Path to the rules file
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Each line is a rule: "+ pattern" - include, "- pattern" - exclude, "c pattern" - compress,
+/// "u pattern" - store uncompressed. Single "l" creates list-file. Empty lines and lines starting with '#' are ignored
+int FstPack::ReadRules(char* local_Input)
+{
+	ifstream RulesFile(local_Input, ios::in);
+	if(!RulesFile.is_open())
+	{
+		SendAlert(46, local_Input);//Can't open rules file.
+		return 1;
+	}
+	std::string Line;
+	while(getline(RulesFile, Line))
+	{
+		if(Line.size() == 0 || Line.at(0) == '#')
+			continue;
+		char Kind = static_cast<char>(tolower(Line.at(0)));
+		if(Kind == 'l' && Line.size() == 1)
+		{
+			EmitList = true;
+			continue;
+		}
+		if(Line.size() < 3 || Line.at(1) != 0x20 || (Kind != '+' && Kind != '-' && Kind != 'c' && Kind != 'u'))
+		{
+			SendAlert(47, Line);//Rules read error. Incorrect rule.
+			return 1;
+		}
+		RuleList.push_back({Kind, Line.substr(2)});
+	}
+	return 0;
+}
+/// \brief Applying rules to the path of file-entry
+/// \param[in] local_Input Path of file-entry (relative to the root directory)
+/// \param[out] Flag Compression flag for the file-entry
+/// \return True - if file-entry is included into the archive, False - otherwise
+bool FstPack::ApplyRules(std::string local_Input, cnv::dword& Flag)
+{
+	//Without include rules everything is included
+	bool Included = true;
+	for(cnv::unsint i = 0; i < RuleList.size(); i++)
+	{
+		if(RuleList.at(i).Kind == '+')
+		{
+			Included = false;
+			break;
+		}
+	}
+	Flag = CF_COMPRESS;
+	for(cnv::unsint i = 0; i < RuleList.size(); i++)
+	{
+		if(!chf::MatchPattern(local_Input, RuleList.at(i).Pattern))
+			continue;
+		switch(RuleList.at(i).Kind)
+		{
+			case '+':
+				Included = true;
+			break;
+			case '-':
+				Included = false;
+			break;
+			case 'c':
+				Flag = CF_COMPRESS;
+			break;
+			case 'u':
+				Flag = CF_UNCOMPRESS;
+			break;
+		}
+	}
+	return Included;
+}
+/// \brief Walking single directory (subdirectories are added to the state for other workers)
+/// \param[in] local_Input Path of directory relative to the root (empty or with trailing separator)
+/// \param[in,out] State State of directory walk
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Directory links (junctions and symbolic links) are not followed, so the walk can't loop,
+/// they are listed in ScanReport
+int FstPack::WalkDirectory(std::string local_Input, WalkState& State)
+{
+	EVENT_SCOPE(Event, "Walk directory", evt::NoArg);
+	WIN32_FIND_DATAA Data;
+	std::string Mask = RootPath + "\\" + local_Input + "*";
+	HANDLE Search = FindFirstFileA(Mask.data(), &Data);
+	if(Search == INVALID_HANDLE_VALUE)
+	{
+		SendAlert(70, RootPath + "\\" + local_Input);//Can't read directory. Directory is locked or was removed while packing.
+		return 1;
+	}
+	do
+	{
+		std::string Name = Data.cFileName;
+		if(Name == "." || Name == "..")
+			continue;
+		std::string Path = local_Input + Name;
+		if(Data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			std::lock_guard<std::mutex> Lock(State.Lock);
+			if(Data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+			{
+				ScanReport.push_back("Link      : " + RootPath + "\\" + Path);
+				continue;
+			}
+			State.Directories.push_back(Path + "\\");
+			State.Signal.notify_one();
+			continue;
+		}
+
+		Entry Item = Entry();
+		Item.Path = Path;
+		Item.RealPath = RootPath + "\\" + Path;
+		if(std::find(State.Skip.begin(), State.Skip.end(), GetComparablePath(Item.RealPath)) != State.Skip.end())
+			continue;
+		if(!ApplyRules(Path, Item.CompressFlag))
+			continue;
+		cnv::qword Size = (static_cast<cnv::qword>(Data.nFileSizeHigh) << 32) | Data.nFileSizeLow;
+
+		std::lock_guard<std::mutex> Lock(State.Lock);
+		if(Size == 0)
+		{
+			ScanReport.push_back("Empty     : " + Item.RealPath);
+			continue;
+		}
+		if((Format == AF_FST && Size > 0xFFFFFFFFULL) || Path.size() > 249)
+		{
+			FindClose(Search);
+			SendAlert((Path.size() > 249) ? 48 : 45, Item.RealPath);//Path of file-entry is longer than 249 characters. / File limit exceeded.
+			return 1;
+		}
+		Item.UncompressSize = Size;
+		State.Found.push_back(Item);
+		State.Signal.notify_one();
+	}
+	while(FindNextFileA(Search, &Data));
+	FindClose(Search);
+	return 0;
+}
+/// \brief Compressing single found file while the walk is running (directory packing)
+/// \param[in,out] State State of directory walk (the file is taken from it, its data is put to it)
+/// \param[in,out] Lock Lock of the state (held on entry and on return)
+/// \details Files which are stored, larger than 50 MB or may get the shared dictionary are left for FillParallel.
+/// Errors aren't reported here: the file is left for FillParallel, which reports them
+void FstPack::PrepareAhead(WalkState& State, std::unique_lock<std::mutex>& Lock)
+{
+	const cnv::dword SizeLimit = 1024*1024*50;//50 MB
+	cnv::unsint Count = State.NextPrepare++;
+	Entry Item = State.Found.at(Count);
+	bool DictionaryCandidate = DictionaryMode && Format == AF_FST64 && Item.UncompressSize <= DictionaryEntryLimit;
+	if(Item.CompressFlag != CF_COMPRESS || Item.UncompressSize > SizeLimit || DictionaryCandidate)
+		return;
+	cnv::qword Reserved = Item.UncompressSize + Item.UncompressSize / 2 + 16;
+	State.PreparedSize += Reserved;
+	Lock.unlock();
+
+	ErrorCheckpoint Checkpoint;
+	ifstream AddedFile;
+	std::vector<cnv::byte> Data;
+	int Result = PrepareEntry(Item, AddedFile, Data);
+	AddedFile.close();
+	if(Result)
+		Checkpoint.Rollback();
+
+	Lock.lock();
+	State.PreparedSize -= Reserved;
+	if(Result == 0)
+	{
+		State.PreparedSize += Data.size();
+		State.PreparedLease.Acquire(State.PreparedSize);
+		State.Found.at(Count) = Item;
+		if(State.Prepared.size() <= Count)
+			State.Prepared.resize(Count + 1);
+		State.Prepared.at(Count).swap(Data);
+	}
+	State.Signal.notify_all();
+}
+/// \brief Putting data of file-entries to new archive, preparing it on worker threads
+/// \param[in,out] Prepared Data of file-entries compressed during the walk (empty - file-entry is compressed here)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Workers read and compress file-entries taken in placement order, and each of them writes its
+/// file-entry when all previous ones are written. Memory for compression is leased in placement order too,
+/// so the file-entry written next never waits for leases of file-entries after it. Each worker holds
+/// single prepared file-entry, so amount of prepared data is limited by amount of workers and by the budget
+int FstPack::FillParallel(std::vector<std::vector<cnv::byte>>& Prepared)
+{
+	//Order of data placement (table of contents order is not changed)
+	std::vector<cnv::unsint> Placement;
+	if(BuildPlacement(Placement))
+		return 1;
+
+	OpenReceiver.seekp(GetHeadSize(), std::ios_base::beg);
+	OpenReceiver.write(reinterpret_cast<const char*>(SharedDictionary.Data.data()), SharedDictionary.Data.size());
+
+	const cnv::dword SizeLimit = 1024*1024*50;//50 MB
+	std::mutex Lock;
+	std::condition_variable Signal;
+	cnv::unsint NextLease = 0;
+	cnv::unsint NextWrite = 0;
+	ErrorBatch Errors;
+	chf::ParallelFor(AmountEntries, [&](cnv::unsint j, cnv::unsint)
+	{
+		cnv::unsint i = Placement.at(j);
+		Entry& Item = TOCList.at(i);
+		ErrorEntry EntryMark(i);
+		if(Item.UncompressSize > SizeLimit)
+			Item.CompressFlag = CF_UNCOMPRESS;
+
+		//Worker waits here while other workers hold the memory budget
+		chf::MemoryLease Lease;
+		std::unique_lock<std::mutex> Turn(Lock);
+		Signal.wait(Turn, [&]()
+		{
+			return Errors.GetAmount() != 0 || j == NextLease;
+		});
+		if(Errors.GetAmount() != 0)
+			return;
+		Turn.unlock();
+		bool Ready = !Prepared.at(i).empty();
+		if(Item.CompressFlag == CF_COMPRESS && !Ready)
+			Lease.Acquire(Item.UncompressSize * 2 + Item.UncompressSize / 2 + 16);
+		Turn.lock();
+		NextLease++;
+		Signal.notify_all();
+		Turn.unlock();
+
+		//Data compressed during the walk is only written
+		ifstream AddedFile;
+		std::vector<cnv::byte> Data;
+		int Result = 0;
+		if(Ready)
+			Data.swap(Prepared.at(i));
+		else
+			Result = PrepareEntry(Item, AddedFile, Data);
+
+		Turn.lock();
+		Signal.wait(Turn, [&]()
+		{
+			return Errors.GetAmount() != 0 || j == NextWrite;
+		});
+		if(Errors.GetAmount() != 0)
+			return;
+		if(Result == 0)
+			Result = WriteEntry(Item, AddedFile, Data);
+		if(Result)
+			Errors.AddThreadError();
+		NextWrite++;
+		Signal.notify_all();
+	});
+	if(Errors.GetAmount() != 0)
+	{
+		Errors.Publish();
+		return 1;
+	}
+	return 0;
+}
+/// \brief Reading and compressing data of single file-entry (directory packing)
+/// \param[in,out] Item File-entry (sizes and flags are updated)
+/// \param[out] AddedFile Opened file of the file-entry
+/// \param[out] Prepared Data to be written (empty - data is copied from the file when it is written)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Compressed data which is not smaller than the source is stored uncompressed
+/// (readers treat entries with equal sizes as uncompressed). Files larger than 50 MB are always stored
+/// and copied by blocks, as in Pack mode the compressor works with whole file in memory
+int FstPack::PrepareEntry(Entry& Item, ifstream& AddedFile, std::vector<cnv::byte>& Prepared)
+{
+	AddedFile.open(Item.RealPath.data(), ios::in|ios::binary);
+	if(!AddedFile.is_open())
+	{
+		SendAlert(9, Item.RealPath);//Can't open file.
+		return 1;
+	}
+	Item.CompressSize = Item.UncompressSize;
+	if(Item.CompressFlag != CF_COMPRESS)
+		return 0;
+
+	EVENT_SCOPE(ReadEvent, "Read", evt::NoArg);
+	std::vector<cnv::byte> CopyBuffer(Item.UncompressSize);
+	if(StreamRead(AddedFile, reinterpret_cast<char*>(CopyBuffer.data()), Item.UncompressSize))
+		return 1;
+	EVENT_END(ReadEvent);
+
+	EVENT_SCOPE(CompressEvent, "Compress", evt::NoArg);
+	//LZ output can be larger than input (up to 12 bits per byte)
+	Prepared.resize(Item.UncompressSize + Item.UncompressSize / 2 + 16);
+	cnv::dword CompressedSize = static_cast<cnv::dword>(SerialCompress(Prepared.data(), CopyBuffer.data(), static_cast<unsigned long>(Item.UncompressSize)));
+	if(CompressedSize < Item.UncompressSize)
+		Item.CompressSize = CompressedSize;
+	std::vector<cnv::byte> DictionaryBuffer;
+	if(CompressWithDictionary(Item, CopyBuffer.data(), DictionaryBuffer))
+		Prepared.swap(DictionaryBuffer);
+	if(Item.CompressSize == Item.UncompressSize)
+	{
+		Item.CompressFlag = CF_UNCOMPRESS;
+		Prepared.swap(CopyBuffer);
+	}
+	Prepared.resize(Item.CompressSize);
+	return 0;
+}
+/// \brief Writing prepared data of single file-entry to new archive (directory packing)
+/// \param[in,out] Item File-entry (offset is updated)
+/// \param[in] AddedFile Opened file of the file-entry
+/// \param[in] Prepared Prepared data (empty - data is copied from the file)
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstPack::WriteEntry(Entry& Item, ifstream& AddedFile, const std::vector<cnv::byte>& Prepared)
+{
+	if(AlignOutput(Item.CompressFlag))
+		return 1;
+	std::streamoff FtellRespond = OpenReceiver.tellp();
+	if(FtellRespond == -1)
+	{
+		SendAlert(11, ArchivePath);//Invalid position indicator value was received in the archive file.
+		return 1;
+	}
+	Item.DataOffset = static_cast<cnv::qword>(FtellRespond);
+	if(CheckLimit(Item.DataOffset + Item.CompressSize, Item.RealPath))
+		return 1;
+	EVENT_SCOPE(Event, "Write", evt::NoArg);
+	if(Prepared.empty())
+	{
+		if(StreamCopy(AddedFile, OpenReceiver, Item.UncompressSize))
+			return 1;
+	}
+	else
+		OpenReceiver.write(reinterpret_cast<const char*>(Prepared.data()), Prepared.size());
+	if(!OpenReceiver.good())
+	{
+		SendAlert(69, ArchivePath);//Can't write the archive file. File is read-only or locked, or disk is full.
+		return 1;
+	}
+	return 0;
+}
+/// \brief Creating list-file which reproduces the packed archive with Pack mode
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstPack::WriteListFile()
+{
+	ofstream ListFile(ListPath, ios::out);
+	if(!ListFile.is_open())
+	{
+		SendAlert(24, ListPath);//Attempt to create list failed. File does not exist or is locked. (Or the file path contains Unicode characters.)
+		return 1;
+	}
+	for(cnv::unsint i = 0; i < AmountEntries; i++)
+	{
+		if(i != 0)
+			ListFile << std::endl;
+		ListFile << ((TOCList.at(i).CompressFlag == CF_COMPRESS) ? "c " : "u ") << TOCList.at(i).Path;
+	}
+	ListFile.close();
 	return 0;
 }
 /// \brief Putting packed data to new archive
 /// \return Error code: 0 - no errors, 1 - operation error
 int FstPack::FillData()
 {
-	OpenReceiver.seekp((AmountEntries * 4 * 262) + 4, std::ios_base::beg);
-	for(cnv::unsint i = 0; i < AmountEntries; i++)
+	//Order of data placement (table of contents order is not changed)
+	std::vector<cnv::unsint> Placement;
+	if(BuildPlacement(Placement))
+		return 1;
+
+	OpenReceiver.seekp(GetHeadSize(), std::ios_base::beg);
+	OpenReceiver.write(reinterpret_cast<const char*>(SharedDictionary.Data.data()), SharedDictionary.Data.size());
+	for(cnv::unsint j = 0; j < AmountEntries; j++)
 	{
+		cnv::unsint i = Placement.at(j);
 		switch(TOCList.at(i).CompressFlag)
 		{
 			case CF_COMPRESS:	//Add as compressed file
@@ -205,9 +895,10 @@ int FstPack::FillData()
 /// \brief Appending compressed file-entry to new archive
 /// \param[in] Count Ordinal number of the file being packed
 /// \return Error code: 0 - no errors, 1 - operation error
-/// \bug Strange allocation bug. Currently fixed by fixing the allocation limit. But no guarantees.
+/// \details Buffers are allocated by size of the file and leased from the memory budget
 int FstPack::AddCompressedFile(cnv::unsint Count)
 {
+	ErrorEntry EntryMark(Count);
 	ifstream AddedFile;
 
 	//Opening the file for packing into archive
@@ -224,29 +915,40 @@ int FstPack::AddCompressedFile(cnv::unsint Count)
 	{
 		SendAlert(10, TOCList.at(Count).RealPath.data());//File limit exceeded. Files no larger than 50 MB are allowed.
 		return 1;
-		//This is a very strange memory allocation bug.
-		//Some specific numbers lead to critical error - Access violation.
-		//Now memory is allocated fixedly - only 50 MB.
-		//Alas, files over this limit cannot be packed yet.
-		//Perhaps cause of the error is in the type of the variable.
 	}
 
-	std::vector<cnv::byte> CopyBuffer(SizeLimit);//std::vector<cnv::byte> CopyBuffer(TOCList.at(Count).UncompressSize);
+	//LZ output can be larger than input (up to 12 bits per byte), so compressed buffer is larger than the file
+	cnv::qword CompressedBound = TOCList.at(Count).UncompressSize + TOCList.at(Count).UncompressSize / 2 + 16;
+	chf::MemoryLease Lease(TOCList.at(Count).UncompressSize + CompressedBound);
+	std::vector<cnv::byte> CopyBuffer(TOCList.at(Count).UncompressSize);
 
 	//Reading content from the file being packed into CopyBuffer
-	StreamRead(AddedFile, reinterpret_cast<char*>(CopyBuffer.data()), static_cast<int>(TOCList.at(Count).UncompressSize));
+	EVENT_SCOPE(ReadEvent, "Read", Count);
+	StreamRead(AddedFile, reinterpret_cast<char*>(CopyBuffer.data()), TOCList.at(Count).UncompressSize);
 	AddedFile.close();
+	EVENT_END(ReadEvent);
 
 	//Getting compressed data
-	//Since almost all data is text, we don't need to worry about data growth instead of compression, but it's technically possible
-	std::vector<cnv::byte> CompressedBuffer(SizeLimit);//std::vector<cnv::byte> CompressedBuffer(TOCList.at(Count).UncompressSize);
-	TOCList.at(Count).CompressSize = static_cast<cnv::dword>(LZCompress(CompressedBuffer.data(), CopyBuffer.data(), TOCList.at(Count).UncompressSize));
+	EVENT_SCOPE(CompressEvent, "Compress", Count);
+	std::vector<cnv::byte> CompressedBuffer(CompressedBound);
+	TOCList.at(Count).CompressSize = static_cast<cnv::dword>(SerialCompress(CompressedBuffer.data(), CopyBuffer.data(), static_cast<unsigned long>(TOCList.at(Count).UncompressSize)));
+	const cnv::byte* Compressed = CompressedBuffer.data();
+	std::vector<cnv::byte> DictionaryBuffer;
+	if(CompressWithDictionary(TOCList.at(Count), CopyBuffer.data(), DictionaryBuffer))
+		Compressed = DictionaryBuffer.data();
+	EVENT_END(CompressEvent);
+
+	//Padding before data (if alignment is set)
+	if(AlignOutput(CF_COMPRESS))
+		return 1;
 
 	//Saving offset into receive file
 	std::streamoff FtellRespond = OpenReceiver.tellp();
 	if(FtellRespond != -1)
 	{
-		TOCList.at(Count).DataOffset = static_cast<cnv::dword>(FtellRespond);
+		TOCList.at(Count).DataOffset = static_cast<cnv::qword>(FtellRespond);
+		if(CheckLimit(TOCList.at(Count).DataOffset + TOCList.at(Count).CompressSize, TOCList.at(Count).RealPath))
+			return 1;
 	}
 	else
 	{
@@ -255,7 +957,8 @@ int FstPack::AddCompressedFile(cnv::unsint Count)
 	}
 
 	//Writing resulting data for packing into receive file
-	OpenReceiver.write(reinterpret_cast<const char*>(CompressedBuffer.data()), TOCList.at(Count).CompressSize);
+	EVENT_SCOPE(WriteEvent, "Write", Count);
+	OpenReceiver.write(reinterpret_cast<const char*>(Compressed), TOCList.at(Count).CompressSize);
 
 	return 0;
 }
@@ -264,6 +967,7 @@ int FstPack::AddCompressedFile(cnv::unsint Count)
 /// \return Error code: 0 - no errors, 1 - operation error
 int FstPack::AddUncompressedFile(cnv::unsint Count)
 {
+	ErrorEntry EntryMark(Count);
 	ifstream AddedFile;
 
 	//Opening the file for packing into archive
@@ -277,17 +981,17 @@ int FstPack::AddUncompressedFile(cnv::unsint Count)
 	//Save the size of packed file
 	TOCList.at(Count).CompressSize = TOCList.at(Count).UncompressSize;
 
-	std::vector<cnv::byte> CopyBuffer(TOCList.at(Count).UncompressSize);
-
-	//Reading content from the file being packed into CopyBuffer
-	StreamRead(AddedFile, reinterpret_cast<char*>(CopyBuffer.data()), static_cast<int>(TOCList.at(Count).UncompressSize));
-	AddedFile.close();
+	//Padding before data (if alignment is set)
+	if(AlignOutput(CF_UNCOMPRESS))
+		return 1;
 
 	//Saving offset and compression flag into receive file
 	std::streamoff FtellRespond = OpenReceiver.tellp();
 	if(FtellRespond != -1)
 	{
-		TOCList.at(Count).DataOffset = static_cast<cnv::dword>(FtellRespond);
+		TOCList.at(Count).DataOffset = static_cast<cnv::qword>(FtellRespond);
+		if(CheckLimit(TOCList.at(Count).DataOffset + TOCList.at(Count).CompressSize, TOCList.at(Count).RealPath))
+			return 1;
 	}
 	else
 	{
@@ -295,42 +999,336 @@ int FstPack::AddUncompressedFile(cnv::unsint Count)
 		return 1;
 	}
 
-	//Writing resulting data for packing into receive file
-	OpenReceiver.write(reinterpret_cast<const char*>(CopyBuffer.data()), TOCList.at(Count).UncompressSize);
+	//Copying content of the file being packed into receive file by blocks
+	EVENT_SCOPE(CopyEvent, "Copy stored", Count);
+	if(StreamCopy(AddedFile, OpenReceiver, TOCList.at(Count).UncompressSize))
+		return 1;
+	AddedFile.close();
 
 	return 0;
 }
-/// \brief Putting head data to new archive
-void FstPack::FillHead()
+/// \brief Estimating result of packing without writing the archive (dry run)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Files of compressed file-entries are read and compressed on worker threads, compressed data is discarded.
+/// If they are larger than DrySampleLimit in total, only evenly spaced sample of them is compressed, and compressed size
+/// of the rest is estimated by ratio of sampled file-entries with the same extension (or of all sampled file-entries).
+/// Size of the archive is calculated by placing data the same way as packing does (order, alignment, dictionary).
+/// Packing works on single thread, so its time is estimated as sum of measured reading and compression time of
+/// file-entries, with copying of stored data estimated by measured reading speed
+int FstPack::EstimatePack()
 {
-	//Put the write cursor at beginning of the file
-	OpenReceiver.seekp(0, std::ios_base::beg);
-
-	//Write amount of entries to the file
-	for(int j = 0; j < 4; j++)
-	{
-		OpenReceiver << static_cast<cnv::byte>(AmountEntries >> 8 * j);
-	}
+	EVENT_SCOPE(Event, "Estimate pack", evt::NoArg);
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
 
-	//Write all the data for the file header
-	for(cnv::dword i = 0; i < AmountEntries; i++)
+	//Compressed file-entries and their sample
+	const cnv::dword SizeLimit = 1024*1024*50;//50 MB
+	cnv::qword Compressible = 0;
+	cnv::qword Stored = 0;
+	for(cnv::unsint i = 0; i < AmountEntries; i++)
 	{
-		OpenReceiver.seekp((i * 262) + 4, std::ios_base::beg);
-		for(int j = 0; j < 4; j++)
+		Entry& Item = TOCList.at(i);
+		Item.Estimated = false;
+		Item.CompressSize = Item.UncompressSize;
+		if(Item.CompressFlag != CF_COMPRESS)
 		{
-			OpenReceiver << static_cast<cnv::byte>(TOCList.at(i).DataOffset >> 8 * j);
+			Stored += Item.UncompressSize;
+			continue;
 		}
-		for(int j = 0; j < 4; j++)
+		if(Item.UncompressSize > SizeLimit)
 		{
-			OpenReceiver << static_cast<cnv::byte>(TOCList.at(i).CompressSize >> 8 * j);
+			ErrorEntry EntryMark(i);
+			SendAlert(10, Item.RealPath);//File limit exceeded. Files no larger than 50 MB are allowed.
+			return 1;
 		}
-		for(int j = 0; j < 4; j++)
-		{
-			OpenReceiver << static_cast<cnv::byte>(TOCList.at(i).UncompressSize >> 8 * j);
+		Compressible += Item.UncompressSize;
+	}
+	cnv::qword Stride = (Compressible > DrySampleLimit) ? (Compressible + DrySampleLimit - 1) / DrySampleLimit : 1;
+	std::vector<cnv::unsint> Sample;
+	cnv::qword Position = 0;
+	for(cnv::unsint i = 0; i < AmountEntries; i++)
+	{
+		if(TOCList.at(i).CompressFlag != CF_COMPRESS)
+			continue;
+		if(Position++ % Stride == 0)
+			Sample.push_back(i);
+		else
+			TOCList.at(i).Estimated = true;
+	}
+
+	//Compressing the sample on worker threads (output is discarded, time is measured)
+	std::vector<double> ReadTime(Sample.size(), 0);
+	std::vector<double> CompressTime(Sample.size(), 0);
+	ErrorBatch Errors;
+	chf::ParallelFor(Sample.size(), [&](cnv::unsint k, cnv::unsint)
+	{
+		ErrorEntry EntryMark(Sample.at(k));
+		Entry& Item = TOCList.at(Sample.at(k));
+		if(Errors.GetAmount() != 0)
+			return;
+		chf::MemoryLease Lease(Item.UncompressSize * 2 + Item.UncompressSize / 2 + 16);
+		std::chrono::steady_clock::time_point Begin = std::chrono::steady_clock::now();
+		ifstream AddedFile(Item.RealPath.data(), ios::in|ios::binary);
+		if(!AddedFile.is_open())
+		{
+			SendAlert(9, Item.RealPath);//Can't open file.
+			Errors.AddThreadError();
+			return;
+		}
+		std::vector<cnv::byte> CopyBuffer(Item.UncompressSize);
+		if(StreamRead(AddedFile, reinterpret_cast<char*>(CopyBuffer.data()), Item.UncompressSize))
+		{
+			Errors.AddThreadError();
+			return;
+		}
+		AddedFile.close();
+		std::chrono::steady_clock::time_point Read = std::chrono::steady_clock::now();
+
+		//LZ output can be larger than input (up to 12 bits per byte)
+		std::vector<cnv::byte> CompressedBuffer(Item.UncompressSize + Item.UncompressSize / 2 + 16);
+		Item.CompressSize = static_cast<cnv::dword>(SerialCompress(CompressedBuffer.data(), CopyBuffer.data(), static_cast<unsigned long>(Item.UncompressSize)));
+		std::vector<cnv::byte> DictionaryBuffer;
+		CompressWithDictionary(Item, CopyBuffer.data(), DictionaryBuffer);
+		ReadTime.at(k) = std::chrono::duration<double>(Read - Begin).count();
+		CompressTime.at(k) = std::chrono::duration<double>(std::chrono::steady_clock::now() - Read).count();
+	});
+	if(Errors.GetAmount() != 0)
+	{
+		Errors.Publish();
+		return 1;
+	}
+
+	//Ratio of sampled file-entries by extension (uncompressed and compressed sizes)
+	std::map<std::string, std::pair<cnv::qword, cnv::qword>> Ratio;
+	std::pair<cnv::qword, cnv::qword> Total(0, 0);
+	double Reading = 0;
+	double Compressing = 0;
+	for(cnv::unsint k = 0; k < Sample.size(); k++)
+	{
+		const Entry& Item = TOCList.at(Sample.at(k));
+		std::pair<cnv::qword, cnv::qword>& Extension = Ratio[GetExtFromPath(Item.Path)];
+		Extension.first += Item.UncompressSize;
+		Extension.second += Item.CompressSize;
+		Total.first += Item.UncompressSize;
+		Total.second += Item.CompressSize;
+		Reading += ReadTime.at(k);
+		Compressing += CompressTime.at(k);
+	}
+	for(cnv::unsint i = 0; i < AmountEntries; i++)
+	{
+		Entry& Item = TOCList.at(i);
+		if(!Item.Estimated)
+			continue;
+		std::map<std::string, std::pair<cnv::qword, cnv::qword>>::iterator Found = Ratio.find(GetExtFromPath(Item.Path));
+		const std::pair<cnv::qword, cnv::qword>& Basis = (Found != Ratio.end()) ? Found->second : Total;
+		Item.CompressSize = static_cast<cnv::qword>(static_cast<double>(Item.UncompressSize) * Basis.second / Basis.first);
+		if(Item.CompressSize == 0)
+			Item.CompressSize = 1;
+	}
+
+	//Placement of data the same way as packing does it
+	std::vector<cnv::unsint> Placement;
+	if(BuildPlacement(Placement))
+		return 1;
+	cnv::qword Offset = GetHeadSize() + SharedDictionary.Data.size();
+	for(cnv::unsint j = 0; j < AmountEntries; j++)
+	{
+		Entry& Item = TOCList.at(Placement.at(j));
+		cnv::dword Gap = GetAlignGap(Offset, Item.CompressFlag);
+		Padding += Gap;
+		Offset += Gap;
+		Item.DataOffset = Offset;
+		if(CheckLimit(Offset + Item.CompressSize, Item.RealPath))
+			return 1;
+		Offset += Item.CompressSize;
+	}
+	ProjectedSize = Offset;
+
+	//Time of packing: reading and compression of all compressed file-entries, copying of stored ones
+	AmountSampled = Sample.size();
+	EstimatedTime = 0;
+	if(Total.first != 0)
+	{
+		EstimatedTime = (Reading + Compressing) * Compressible / Total.first;
+		if(Reading > 0)
+			EstimatedTime += Stored / (Total.first / Reading);
+	}
+	DryRunTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	return 0;
+}
+/// \brief Putting head data to new archive
+void FstPack::FillHead()
+{
+	EVENT_SCOPE(Event, "Write table of contents", evt::NoArg);
+
+	//Put the write cursor at beginning of the file
+	OpenReceiver.seekp(0, std::ios_base::beg);
+
+	//Dictionary data lies right after the header
+	cnv::dword HeadVersion = SharedDictionary.Data.empty() ? Fst64Version : Fst64DictionaryVersion;
+	PutArchiveHead(OpenReceiver, Format, HeadVersion, AmountEntries, GetHeadSize(), SharedDictionary.Data.size());
+	for(cnv::dword i = 0; i < AmountEntries; i++)
+	{
+		const Entry& Item = TOCList.at(i);
+		PutArchiveRecord(OpenReceiver, Format, Item.DataOffset, Item.CompressSize, Item.UncompressSize, Item.Flags, Item.Path);
+	}
+}
+/// \brief Calculating size of archive header (table of contents included)
+/// \return Size of archive header in bytes
+cnv::qword FstPack::GetHeadSize()
+{
+	if(Format == AF_FST64 && !SharedDictionary.Data.empty())
+		return Fst64HeadSize + Fst64DictionaryFields + static_cast<cnv::qword>(AmountEntries) * Fst64RecordSize;
+	if(Format == AF_FST64)
+		return Fst64HeadSize + static_cast<cnv::qword>(AmountEntries) * Fst64RecordSize;
+	return static_cast<cnv::qword>(AmountEntries) * 262 + 4;
+}
+/// \brief Building order of data placement from the access trace
+/// \param[out] Placement Ordinal numbers of file-entries in order of their data in the archive
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Entries are placed in order of their first access in the trace, so entries read together
+/// lie next to each other. Entries absent in the trace follow in table of contents order.
+/// Trace lines which don't match any entry are ignored
+int FstPack::BuildPlacement(std::vector<cnv::unsint>& Placement)
+{
+	AmountTraced = 0;
+	Placement.clear();
+	Placement.reserve(AmountEntries);
+	std::vector<bool> Placed(AmountEntries, false);
+	if(!TracePath.empty())
+	{
+		ifstream Trace(TracePath, ios::in);
+		if(!Trace.is_open())
+		{
+			SendAlert(54, TracePath);//Can't open access trace file.
+			return 1;
+		}
+		std::map<std::string, cnv::unsint> Index;
+		for(cnv::unsint i = 0; i < AmountEntries; i++)
+		{
+			Index.insert(std::make_pair(GetComparablePath(TOCList.at(i).Path), i));
 		}
-		OpenReceiver << TOCList.at(i).Path;
+		std::string Line;
+		while(getline(Trace, Line))
+		{
+			std::map<std::string, cnv::unsint>::iterator Found = Index.find(GetComparablePath(Line));
+			if(Found == Index.end() || Placed.at(Found->second))
+				continue;
+			Placed.at(Found->second) = true;
+			Placement.push_back(Found->second);
+		}
+		AmountTraced = Placement.size();
 	}
-    return;
+	for(cnv::unsint i = 0; i < AmountEntries; i++)
+	{
+		if(!Placed.at(i))
+			Placement.push_back(i);
+	}
+	return 0;
+}
+/// \brief Calculating size of padding before data of file-entry
+/// \param[in] Position Position of data in the archive without padding
+/// \param[in] Flag Compression flag of the file-entry
+/// \return Size of padding (0 - no alignment for this file-entry)
+cnv::dword FstPack::GetAlignGap(cnv::qword Position, cnv::dword Flag)
+{
+	return ::GetAlignGap(Position, Alignment, AlignStoredOnly, Flag);
+}
+/// \brief Writing zero padding, so data of the next file-entry starts at the alignment boundary
+/// \param[in] Flag Compression flag of the next file-entry
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Readers use offsets from the table of contents, so padding doesn't affect them
+int FstPack::AlignOutput(cnv::dword Flag)
+{
+	if(Alignment < 2 || (AlignStoredOnly && Flag != CF_UNCOMPRESS))
+		return 0;
+	std::streamoff FtellRespond = OpenReceiver.tellp();
+	if(FtellRespond == -1)
+	{
+		SendAlert(11, ArchivePath);//Invalid position indicator value was received in the archive file.
+		return 1;
+	}
+	cnv::dword Gap = GetAlignGap(static_cast<cnv::qword>(FtellRespond), Flag);
+	if(Gap != 0)
+	{
+		std::vector<char> Zero(Gap, 0);
+		OpenReceiver.write(Zero.data(), Gap);
+		Padding += Gap;
+	}
+	return 0;
+}
+/// \brief Checking that data ends inside the address range of the archive format
+/// \param[in] End End position of written data in the archive
+/// \param[in] Add Path of file being packed (for error message)
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstPack::CheckLimit(cnv::qword End, std::string Add)
+{
+	if(Format == AF_FST && End > 0xFFFFFFFFULL)
+	{
+		SendAlert(51, Add);//Archive size exceeds 4 GB. Classic archive format can't address it (use --fst64 option).
+		return 1;
+	}
+	return 0;
+}
+/// \brief Building shared dictionary from sample of small file-entries
+/// \param[in] Candidates File-entries which may be compressed with the dictionary (in stable order)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Beginnings of evenly spaced text entries are concatenated up to the dictionary limit.
+/// Dictionary is built only in dictionary mode for extended archive (classic records have no flags)
+int FstPack::BuildDictionary(std::vector<Entry*>& Candidates)
+{
+	SharedDictionary = lzc::Dictionary();
+	if(!DictionaryMode || Format != AF_FST64 || Candidates.empty())
+		return 0;
+	EVENT_SCOPE(Event, "Build dictionary", evt::NoArg);
+	cnv::unsint Samples = DictionaryLimit / DictionarySampleLimit * 4;
+	cnv::unsint Step = (Candidates.size() + Samples - 1) / Samples;
+	std::vector<cnv::byte> Sample(DictionarySampleLimit);
+	for(cnv::unsint i = 0; i < Candidates.size() && SharedDictionary.Data.size() < DictionaryLimit; i += Step)
+	{
+		ifstream SampleFile(Candidates.at(i)->RealPath.data(), ios::in|ios::binary);
+		if(!SampleFile.is_open())
+		{
+			SendAlert(9, Candidates.at(i)->RealPath);//Can't open file.
+			return 1;
+		}
+		cnv::unsint Size = static_cast<cnv::unsint>(std::min<cnv::qword>(Candidates.at(i)->UncompressSize, DictionarySampleLimit));
+		Size = std::min<cnv::unsint>(Size, DictionaryLimit - SharedDictionary.Data.size());
+		if(StreamRead(SampleFile, reinterpret_cast<char*>(Sample.data()), Size))
+			return 1;
+		if(lzc::IsText(Sample.data(), Size))
+			SharedDictionary.Data.insert(SharedDictionary.Data.end(), Sample.begin(), Sample.begin() + Size);
+	}
+	if(!SharedDictionary.Data.empty())
+		lzc::Prime(SharedDictionary);
+	return 0;
+}
+/// \brief Compressing small text file-entry with shared dictionary
+/// \param[in,out] Item File-entry (compressed size and flags are updated, if result is smaller than current compressed size)
+/// \param[in] local_Input Uncompressed data of file-entry
+/// \param[out] local_Output Compressed data
+/// \return true - file-entry is compressed with the dictionary, false - current compressed data is kept
+bool FstPack::CompressWithDictionary(Entry& Item, const cnv::byte* local_Input, std::vector<cnv::byte>& local_Output)
+{
+	if(SharedDictionary.Data.empty() || Item.UncompressSize > DictionaryEntryLimit || !lzc::IsText(local_Input, Item.UncompressSize))
+		return false;
+	lzc::Compress(local_Input, Item.UncompressSize, local_Output, &SharedDictionary);
+	if(local_Output.size() >= Item.CompressSize)
+		return false;
+	Item.CompressSize = local_Output.size();
+	Item.Flags |= EF_DICTIONARY;
+	return true;
+}
+/// \brief Get amount of file-entries compressed with shared dictionary
+/// \return Amount of file-entries
+cnv::dword FstPack::GetAmountDictionary()
+{
+	cnv::dword local_Output = 0;
+	for(cnv::unsint i = 0; i < TOCList.size(); i++)
+	{
+		if(TOCList.at(i).Flags & EF_DICTIONARY)
+			local_Output++;
+	}
+	return local_Output;
 }
 
 
@@ -339,23 +1337,41 @@ void FstUnpack::Clear()
 {
 	AmountEntries = 0;
 	FileSize = 0;
+	Format = AF_FST;
+	Version = 0;
+	SharedDictionary = lzc::Dictionary();
+	DictionaryOffset = 0;
 	TOCList.erase(TOCList.begin(), TOCList.end());
 
     ReadBuffer.erase(ReadBuffer.begin(), ReadBuffer.end());
 	DecompBuffer.erase(DecompBuffer.begin(), DecompBuffer.end());
-	UncompressedSize = 0;
+	Window.erase(Window.begin(), Window.end());
+	WindowBegin = 0;
 
 	if(OpenArchive.is_open())
 		OpenArchive.close();
 	if(OpenReceiver.is_open())
 		OpenArchive.close();
+	Depth = 0;
+	std::vector<cnv::byte>().swap(Image);
+	ImageLease.Release();
+	ImageBuffer.Assign(nullptr, 0);
+	ImageStream.clear();
+	NestedPath.erase(NestedPath.begin(), NestedPath.end());
+	NestedReport.erase(NestedReport.begin(), NestedReport.end());
 	ArchivePath.erase(ArchivePath.begin(), ArchivePath.end());
+	ExtractPrefix.erase(ExtractPrefix.begin(), ExtractPrefix.end());
+	ExtractFrom = 0;
+	AmountSkipped = 0;
+	ExtractPaths.Created.erase(ExtractPaths.Created.begin(), ExtractPaths.Created.end());
 }
 /// \brief Loading an archive to the program memory
 /// \param[in] local_Input Path to the file to unpack
 /// \return Error code: 0 - no errors, 1 - operation error
 int FstUnpack::Load(char* local_Input)
 {
+	EVENT_SCOPE(Event, "Load table of contents", evt::NoArg);
+
 	//Clearing the instance fields
 	Clear();
 
@@ -368,8 +1384,20 @@ int FstUnpack::Load(char* local_Input)
 		return 1;
 	}
 
-	//Saving path of the archive
+	//Saving path of the archive and output directory of unpacking (built once, not for every file-entry)
 	ArchivePath = local_Input;
+	ExtractPrefix = ArchivePath;
+	ExtractPrefix.append("_unpack\\");
+	ExtractFrom = chf::GetDirectoryPart(ArchivePath).Size;
+
+	//Header may be partly written by interrupted edit, it is completed by the next edit of the archive
+	cnv::qword JournalSize = 0;
+	if(chf::GetFileStat(GetEditJournalPath(ArchivePath), JournalSize))
+	{
+		OpenArchive.close();
+		SendAlert(68, ArchivePath);//Archive has unfinished edit (journal <archive>.edit exists). Repeat any edit of the archive to complete it.
+		return 1;
+	}
 
 	//Get the file size
 	FileSize = chf::GetFileSize(OpenArchive);
@@ -380,211 +1408,903 @@ int FstUnpack::Load(char* local_Input)
 		return 1;
 	}
 
+	int Result = ReadHead();
+	OpenArchive.close();
+	return Result;
+}
+/// \brief Loading an archive stored as file-entry of another archive (nested archive) to the program memory
+/// \param[in] Parent Loaded archive with opened stream
+/// \param[in] Count Ordinal number of file-entry of the parent archive
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details File-entry is decoded into memory and read through memory stream, so nothing is written to disk. Path of
+/// nested archive continues path of the parent one as if file-entry was a directory. Output directory of nested archive
+/// lies beside the file-entry in output directory of the parent archive ("<entry>_unpack\\")
+int FstUnpack::Load(FstUnpack& Parent, cnv::unsint Count)
+{
+	EVENT_SCOPE(Event, "Load nested archive", Count);
+
+	//Clearing the instance fields
+	Clear();
+
+	//Decoding the file-entry into memory (whole nested archive is kept in memory, so it must fit into the memory budget)
+	if(!ImageLease.TryAcquire(Parent.TOCList.at(Count).UncompressSize))
+	{
+		SendAlert(59, Parent.TOCList.at(Count).Path);//Memory limit exceeded. Nested archive doesn't fit into the memory budget.
+		return 1;
+	}
+	if(Parent.DecodeEntry(Parent.Source(), Count, Image))
+	{
+		return 1;
+	}
+	const std::string& EntryPath = Parent.TOCList.at(Count).Path;
+	Depth = Parent.Depth + 1;
+	ArchivePath = Parent.ArchivePath + "\\" + EntryPath;
+	NestedPath = Parent.NestedPath + EntryPath + "\\";
+	ExtractPrefix = Parent.ExtractPrefix + EntryPath + "_unpack\\";
+	ExtractFrom = Parent.ExtractFrom;
+	ResumeMode = Parent.ResumeMode;
+	Incremental = Parent.Incremental;
+
+	FileSize = Image.size();
+	if(FileSize == 0)
+	{
+		SendAlert(15, ArchivePath);//The file is empty.
+		return 1;
+	}
+	ImageBuffer.Assign(Image.data(), Image.size());
+	ImageStream.clear();
+	return ReadHead();
+}
+/// \brief Reading table of contents of the archive from its stream (file stream or stream of nested archive)
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstUnpack::ReadHead()
+{
 	//Get number of entries in the archive
-	if(DwordRead(OpenArchive, AmountEntries))
+	if(DwordRead(Source(), AmountEntries))
 	{
-		OpenArchive.close();
+		return 1;
+	}
+
+	//Table of contents must lie inside the archive (damaged amount of entries doesn't cause huge allocation).
+	//Only marker entry of extended archive may have larger amount (written by earlier builds), it is read as single record
+	bool Oversized = AmountEntries > (FileSize - 4) / 262 || AmountEntries == 0xFFFFFFFF;
+	cnv::dword Amount = Oversized ? 1 : AmountEntries;
+	if(Oversized && FileSize < 4 + 262)
+	{
+		SendAlert(50, ArchivePath);//Table of contents lies outside the archive file. The file is corrupted.
 		return 1;
 	}
 
 	//Resize table of contents array
-	TOCList.resize(AmountEntries);
+	TOCList.resize(Amount);
 
 	//Get table of content data
-   	for(cnv::dword i = 0; i < AmountEntries; i++)
+	for(cnv::dword i = 0; i < Amount; i++)
 	{
-		//Read DataOffset
-		if(DwordRead(OpenArchive, TOCList.at(i).DataOffset))
+		if(ReadEntry(i))
 		{
-			OpenArchive.close();
 			return 1;
 		}
+	}
+
+	//Extended archive starts with marker entry for readers of classic format
+	if(Amount == 1 && TOCList.at(0).DataOffset == Fst64MarkerOffset && ReadExtendedHead())
+	{
+		return 1;
+	}
+	if(Oversized && Format != AF_FST64)
+	{
+		SendAlert(50, ArchivePath);//Table of contents lies outside the archive file. The file is corrupted.
+		return 1;
+	}
+	return 0;
+}
+/// \brief Checking that file-entry is an archive (nested archive)
+/// \param[in] Archive Stream of the archive opened by caller
+/// \param[in] Count Ordinal number of the file-entry
+/// \return True - file-entry is an archive
+/// \details Only beginning of file-entry is decoded (see ClassifyEntry). Damaged file-entry is not taken as archive
+bool FstUnpack::IsArchiveEntry(std::istream& Archive, cnv::unsint Count)
+{
+	if(AmountEntries <= Count || TOCList.at(Count).UncompressSize < 4 + 262)
+		return false;
+	cnv::dword Type = FM_UNKNOWN;
+	ErrorCheckpoint Checkpoint;
+	if(ClassifyEntry(Archive, Count, Type))
+	{
+		Checkpoint.Rollback();
+		return false;
+	}
+	return Type == FM_FST;
+}
+/// \brief Getting type of file-entry from its content
+/// \param[in] Archive Stream of the archive opened by caller (one stream per thread)
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[out] Type Type of file-entry (FileMode): type by signature, FM_FST for archive, FM_NOTYPE for empty file-entry
+/// or FM_UNKNOWN
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Only prefix of NestedProbeSize bytes is decoded, which holds signature of file and header of archive
+int FstUnpack::ClassifyEntry(std::istream& Archive, cnv::unsint Count, cnv::dword& Type)
+{
+	Type = FM_UNKNOWN;
+	std::vector<cnv::byte> Head;
+	if(DecodePrefix(Archive, Count, NestedProbeSize, Head))
+		return 1;
+	if(Head.empty())
+	{
+		Type = FM_NOTYPE;
+		return 0;
+	}
+
+	//Signature is compared by its first bytes, short file-entries are padded with zeros
+	cnv::byte Signature[4] = {0, 0, 0, 0};
+	memcpy(Signature, Head.data(), (Head.size() < 4) ? Head.size() : 4);
+	Type = GetFileTypeFromSignature(Signature);
+	if(Type == FM_UNKNOWN && IsArchiveHead(Head, TOCList.at(Count).UncompressSize))
+		Type = FM_FST;
+	return 0;
+}
+/// \brief Calling function for every nested archive (recursively, in order of the table of contents)
+/// \param[in] Visit Function called for loaded nested archive before archives nested into it
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Only one nested archive of every level is kept in memory at a time. Archives nested deeper than
+/// NestedDepthLimit are not traversed. Nested archive which can't be loaded, or for which Visit returns non-zero result,
+/// is listed in NestedReport with index of its error and skipped together with archives nested into it
+int FstUnpack::ForEachNested(std::function<int(FstUnpack&)> Visit)
+{
+	//Checking for loading the archive into memory
+	if(ArchivePath.empty())
+	{
+		SendAlert(16, nullptr);//Archive not loaded into memory.
+		return 1;
+	}
+	NestedReport.erase(NestedReport.begin(), NestedReport.end());
+	if(Depth >= NestedDepthLimit)
+		return 0;
+	if(OpenSource())
+		return 1;
 
-		//Read CompressSize
-		if(DwordRead(OpenArchive, TOCList.at(i).CompressSize))
+	int Result = 0;
+	for(cnv::dword i = 0; i < AmountEntries && Result == 0; i++)
+	{
+		if(!IsArchiveEntry(Source(), i))
+			continue;
+		FstUnpack Nested;
+		ErrorCheckpoint Checkpoint;
+		const char* Failure = nullptr;
+		if(Nested.Load(*this, i))
+			Failure = (GetThreadError().ErrorIndex == 59) ? "Too large : " : "Damaged   : ";
+		else if(Visit(Nested) != 0)
+			Failure = "Failed    : ";
+		if(Failure != nullptr)
 		{
-			OpenArchive.close();
+			NestedReport.push_back(Failure + ArchivePath + "\\" + TOCList.at(i).Path +
+				" (error " + INTtoSTRING(static_cast<int>(GetThreadError().ErrorIndex)) + ")");
+			Checkpoint.Rollback();
+			continue;
+		}
+		Result = Nested.ForEachNested(Visit);
+		NestedReport.insert(NestedReport.end(), Nested.NestedReport.begin(), Nested.NestedReport.end());
+	}
+	CloseSource();
+	return Result;
+}
+/// \brief Opening stream of the archive
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Archive file is opened, stream of nested archive is moved to the beginning
+int FstUnpack::OpenSource()
+{
+	if(Depth != 0)
+	{
+		ImageStream.clear();
+		ImageStream.seekg(0, std::ios_base::beg);
+		return 0;
+	}
+	OpenArchive.open(ArchivePath, ios::in|ios::binary);
+	if(!OpenArchive.is_open())
+	{
+		SendAlert(18, ArchivePath);//Can't open input archive file. File does not exist or is locked. (Or the file path contains Unicode characters.)
+		return 1;
+	}
+	return 0;
+}
+/// \brief Closing stream of the archive (stream of nested archive stays usable)
+void FstUnpack::CloseSource()
+{
+	if(Depth == 0)
+		OpenArchive.close();
+}
+/// \brief Get path of journal of resumable unpacking (beside the output directory)
+/// \return Path of the journal
+std::string FstUnpack::GetJournalPath()
+{
+	return ExtractPrefix.substr(0, ExtractPrefix.size() - 1) + ".journal";
+}
+/// \brief Reading single record of table of contents (format of record depends on the archive format)
+/// \param[in] Count Ordinal number of the file-entry
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstUnpack::ReadEntry(cnv::unsint Count)
+{
+	if(Format == AF_FST64)
+	{
+		//Read DataOffset, CompressSize, UncompressSize and Flags
+		if(QwordRead(Source(), TOCList.at(Count).DataOffset) ||
+			QwordRead(Source(), TOCList.at(Count).CompressSize) ||
+			QwordRead(Source(), TOCList.at(Count).UncompressSize) ||
+			DwordRead(Source(), TOCList.at(Count).Flags))
 			return 1;
+	}
+	else
+	{
+		//Read DataOffset, CompressSize and UncompressSize
+		cnv::dword Value[3];
+		for(cnv::unsint j = 0; j < 3; j++)
+		{
+			if(DwordRead(Source(), Value[j]))
+				return 1;
 		}
+		TOCList.at(Count).DataOffset = Value[0];
+		TOCList.at(Count).CompressSize = Value[1];
+		TOCList.at(Count).UncompressSize = Value[2];
+		TOCList.at(Count).Flags = 0;
+	}
 
-		//Read UncompressSize
-		if(DwordRead(OpenArchive, TOCList.at(i).UncompressSize))
+	//Read Path
+	TOCList.at(Count).Path.resize(250);
+	if(StreamRead(Source(), &TOCList.at(Count).Path[0], 250))
+		return 1;
+
+	//String optimization
+	for(cnv::unsint j = 0; j < 250; j++)
+	{
+		if(TOCList.at(Count).Path.at(j) == 0)
+		{
+			TOCList.at(Count).Path.resize(j);
+			break;
+		}
+	}
+
+	//Calculate CompressFlag
+	if(TOCList.at(Count).UncompressSize == 0)
+	{
+		TOCList.at(Count).CompressFlag = CF_EMPTY;
+	}
+	else if(TOCList.at(Count).CompressSize == TOCList.at(Count).UncompressSize)
+	{
+		TOCList.at(Count).CompressFlag = CF_UNCOMPRESS;
+	}
+	else
+	{
+		TOCList.at(Count).CompressFlag = CF_COMPRESS;
+	}
+	return 0;
+}
+/// \brief Reading header and table of contents of extended archive (FST64)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Called after marker entry was read. If the signature doesn't follow the marker entry,
+/// the archive is left as archive of classic format
+int FstUnpack::ReadExtendedHead()
+{
+	if(FileSize < Fst64HeadSize)
+		return 0;
+	char Signature[4];
+	if(StreamRead(Source(), Signature, 4))
+		return 1;
+	if(memcmp(Signature, Fst64Signature, 4) != 0)
+		return 0;
+
+	cnv::qword Amount = 0;
+	if(DwordRead(Source(), Version) || QwordRead(Source(), Amount))
+		return 1;
+	if(Version != Fst64Version && Version != Fst64DictionaryVersion)
+	{
+		SendAlert(49, ArchivePath);//Unsupported version of extended archive (FST64).
+		return 1;
+	}
+
+	//Version with shared dictionary has its location in the header
+	cnv::qword DictionaryOffset = 0;
+	cnv::dword DictionarySize = 0;
+	if(Version == Fst64DictionaryVersion && (QwordRead(Source(), DictionaryOffset) || DwordRead(Source(), DictionarySize)))
+		return 1;
+
+	cnv::qword HeadSize = Fst64HeadSize + ((Version == Fst64DictionaryVersion) ? Fst64DictionaryFields : 0);
+	if(FileSize < HeadSize || Amount > (FileSize - HeadSize) / Fst64RecordSize)
+	{
+		SendAlert(50, ArchivePath);//Table of contents lies outside the archive file. The file is corrupted.
+		return 1;
+	}
+	Format = AF_FST64;
+	AmountEntries = static_cast<cnv::dword>(Amount);
+	TOCList.assign(AmountEntries, Entry());
+	for(cnv::dword i = 0; i < AmountEntries; i++)
+	{
+		if(ReadEntry(i))
+			return 1;
+	}
+	return ReadDictionary(DictionaryOffset, DictionarySize);
+}
+/// \brief Reading shared dictionary of extended archive
+/// \param[in] Offset Offset of dictionary data in the archive
+/// \param[in] Size Size of dictionary data (0 - archive without dictionary)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Dictionary is read and primed once, then every file-entry compressed with it is decoded independently
+int FstUnpack::ReadDictionary(cnv::qword Offset, cnv::dword Size)
+{
+	if(Size == 0)
+		return 0;
+	if(Offset > FileSize || Size > FileSize - Offset)
+	{
+		SendAlert(55, ArchivePath);//Shared dictionary lies outside the archive file. The file is corrupted.
+		return 1;
+	}
+	DictionaryOffset = Offset;
+	SharedDictionary.Data.resize(Size);
+	Source().seekg(Offset, std::ios_base::beg);
+	if(StreamRead(Source(), reinterpret_cast<char*>(SharedDictionary.Data.data()), Size))
+		return 1;
+	lzc::Prime(SharedDictionary);
+	return 0;
+}
+/// \brief Extracting a single file from the archive
+/// \param[in] Count Ordinal number of the file being unpacked
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstUnpack::ExtractFromArchive(cnv::unsint Count)
+{
+	ErrorEntry EntryMark(Count);
+
+	//Checking for loading the archive into memory
+	if(ArchivePath.empty())
+	{
+		SendAlert(16, nullptr);//Archive not loaded into memory.
+		return 1;
+	}
+
+	//Checking for compliance with boundaries of the archive table of contents
+	if(AmountEntries <= Count)
+	{
+		SendAlert(17, nullptr);//Violating boundaries of the table of contents (Attempted to read outside the list limits).
+		return 1;
+	}
+
+	//Trying to open the archive
+	if(OpenSource())
+	{
+		return 1;
+	}
+
+	//Access trace (if hook is set)
+	TraceAccess(Count);
+
+	bool Unchanged = false;
+	int Result = ExtractEntry(Count, false, Unchanged);
+	CloseSource();
+	return Result;
+}
+/// \brief Extracting a single file from the opened archive
+/// \param[in] Count Ordinal number of the file being unpacked
+/// \param[in] Compare True - decoded data of compressed file-entry is compared with the existing file first (incremental mode)
+/// \param[out] Unchanged True - the existing file has the same content and was not written
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Data lying in the read window is taken from memory, other data is read from the archive stream. Data decoded
+/// for comparison is written without decoding it again
+int FstUnpack::ExtractEntry(cnv::unsint Count, bool Compare, bool& Unchanged)
+{
+	ErrorEntry EntryMark(Count);
+	const Entry& Item = TOCList.at(Count);
+	Unchanged = false;
+
+	//Formation of path to output file from output directory and path of file-entry (buffers of the arena are reused)
+	const std::string& Receiver = chf::JoinPath(ExtractPaths, {ExtractPrefix.data(), static_cast<cnv::unsint>(ExtractPrefix.size())},
+		{Item.Path.data(), static_cast<cnv::unsint>(Item.Path.size())});
+
+	//Data of file-entry in the read window (if it was filled for this part of the archive), whole nested archive is in memory
+	cnv::byte* Windowed = nullptr;
+	if(Depth != 0 && Item.CompressFlag != CF_EMPTY && Item.DataOffset + Item.CompressSize <= FileSize)
+		Windowed = Image.data() + Item.DataOffset;
+	else if(Item.CompressFlag != CF_EMPTY && Item.DataOffset >= WindowBegin && Item.DataOffset + Item.CompressSize <= WindowBegin + Window.size())
+		Windowed = Window.data() + (Item.DataOffset - WindowBegin);
+
+	//Trying to unpack the file-entry if it is compressed (buffers are kept between entries)
+	bool Reserved = Item.CompressFlag != CF_COMPRESS ||
+		ReserveBuffers((Windowed != nullptr) ? 0 : Item.CompressSize, Item.UncompressSize + LibraryOutputSlack);
+	bool Decoded = false;
+	if(Reserved && Item.CompressFlag == CF_COMPRESS && Compare)
+	{
+		if(DecodeBuffer(Count, Windowed))
+			return 1;
+		Decoded = true;
+
+		//Existing file is compared before it is opened for writing. File which can't be compared is written again
+		ErrorCheckpoint Checkpoint;
+		if(CompareEntry(Count, Receiver, DecompBuffer.data(), Unchanged))
+		{
+			Checkpoint.Rollback();
+			Unchanged = false;
+		}
+		if(Unchanged)
+			return 0;
+	}
+
+	//Creating output directory and directories of file-entry (directories of previous file-entry are skipped)
+	EVENT_SCOPE(DirectoryEvent, "Create directories", Count);
+	if(chf::CreateDirectories(ExtractPaths, ExtractFrom))
+	{
+		SendAlert(19, Receiver);//Directory does not exist.
+		return 1;
+	}
+	EVENT_END(DirectoryEvent);
+
+	//Trying to open output file
+	OpenReceiver.open(Receiver, ios::out|ios::binary);
+	if(!OpenReceiver.is_open())
+	{
+		SendAlert(20, Receiver);//The file can't be opened or does not exist.
+		return 1;
+	}
+
+	if(!Reserved && (Item.Flags & EF_DICTIONARY))
+	{
+		//Buffers don't fit into the memory budget - data is decoded by blocks straight into the output file.
+		//Library decoder needs whole buffers, so entries without dictionary are decoded in memory even over the budget
+		if(StreamEntry(Count, Windowed))
+		{
+			OpenReceiver.close();
+			return 1;
+		}
+	}
+	else if(Item.CompressFlag == CF_COMPRESS)
+	{
+		if(!Decoded && DecodeBuffer(Count, Windowed))
+		{
+			OpenReceiver.close();
+			return 1;
+		}
+		EVENT_SCOPE(WriteEvent, "Write", Count);
+		OpenReceiver.write(reinterpret_cast<const char*>(DecompBuffer.data()), Item.UncompressSize);
+	}
+	else if(Item.CompressFlag == CF_UNCOMPRESS && Windowed != nullptr)
+	{
+		EVENT_SCOPE(WriteEvent, "Write", Count);
+		OpenReceiver.write(reinterpret_cast<const char*>(Windowed), Item.CompressSize);
+	}
+	else if(Item.CompressFlag == CF_UNCOMPRESS)
+	{
+		//Stored data is copied by blocks, so large entries don't need the same amount of memory
+		EVENT_SCOPE(CopyEvent, "Copy stored", Count);
+		Source().seekg(Item.DataOffset, std::ios_base::beg);
+		if(StreamCopy(Source(), OpenReceiver, Item.CompressSize))
+		{
+			OpenReceiver.close();
+			return 1;
+		}
+	}
+
+	//Written size is taken from the stream, so the created file is not opened again
+	std::streamoff Written = OpenReceiver.tellp();
+	OpenReceiver.close();
+
+	if(Written <= 0 && Item.CompressFlag != CF_EMPTY)
+	{
+		SendAlert(22, Receiver);//The created file does not exist or has size of zero.
+		return 1;
+	}
+	return 0;
+}
+/// \brief Decoding compressed file-entry into DecompBuffer
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[in] Windowed Compressed data in memory (nullptr - data is read from the archive stream)
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstUnpack::DecodeBuffer(cnv::unsint Count, cnv::byte* Windowed)
+{
+	DecompBuffer.resize(TOCList.at(Count).UncompressSize + LibraryOutputSlack);
+	if(Windowed == nullptr)
+		return ReadData(Source(), Count, DecompBuffer.data(), DecompBuffer.size(), ReadBuffer);
+	EVENT_SCOPE(DecompressEvent, "Decompress", Count);
+	return Decompress(Count, DecompBuffer.data(), DecompBuffer.size(), Windowed);
+}
+/// \brief Leasing memory budget for buffers of single file-entry
+/// \param[in] ReadSize Size of compressed data to be read into ReadBuffer (0 - data is in memory already)
+/// \param[in] DecompSize Size of uncompressed data in DecompBuffer
+/// \return True - buffers fit into the budget, False - file-entry must be decoded by blocks
+/// \details Buffers keep their capacity between file-entries, so the lease covers the largest of them
+bool FstUnpack::ReserveBuffers(cnv::qword ReadSize, cnv::qword DecompSize)
+{
+	cnv::qword Need = ((ReadBuffer.capacity() > ReadSize) ? ReadBuffer.capacity() : ReadSize) +
+		((DecompBuffer.capacity() > DecompSize) ? DecompBuffer.capacity() : DecompSize);
+	return Need <= BufferLease.GetSize() || BufferLease.TryAcquire(Need);
+}
+/// \brief Decoding compressed file-entry by blocks into the output file
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[in] Windowed Compressed data in memory (nullptr - data is read from the archive stream)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Only one block of compressed and one block of uncompressed data are kept in memory. Used for file-entries
+/// compressed with shared dictionary only, as they are decoded by native codec
+int FstUnpack::StreamEntry(cnv::unsint Count, const cnv::byte* Windowed)
+{
+	const Entry& Item = TOCList.at(Count);
+	if(Windowed == nullptr && Item.DataOffset + Item.CompressSize > FileSize)
+	{
+		SendAlert(36, Item.Path);//Data of file-entry lies outside the archive file.
+		return 1;
+	}
+	const lzc::Dictionary* Dict = nullptr;
+	if(SelectDictionary(Count, Dict))
+		return 1;
+
+	EVENT_SCOPE(Event, "Decompress by blocks", Count);
+	if(Windowed == nullptr)
+		Source().seekg(Item.DataOffset, std::ios_base::beg);
+	cnv::qword Left = Item.CompressSize;
+	bool ReadFailed = false;
+	cnv::qword Decoded = 0;
+	int Result = lzc::DecompressStream([&](cnv::byte* Block, cnv::qword Size) -> cnv::qword
+	{
+		cnv::qword Part = (Left < Size) ? Left : Size;
+		if(Windowed != nullptr)
+			memcpy(Block, Windowed + (Item.CompressSize - Left), Part);
+		else if(Part != 0 && StreamRead(Source(), reinterpret_cast<char*>(Block), static_cast<int>(Part)))
+		{
+			ReadFailed = true;
+			return 0;
+		}
+		Left -= Part;
+		return Part;
+	},
+	[this](const cnv::byte* Block, cnv::qword Size)
+	{
+		OpenReceiver.write(reinterpret_cast<const char*>(Block), Size);
+		return OpenReceiver.good();
+	}, Item.UncompressSize, Decoded, Dict);
+	if(ReadFailed)
+		return 1;
+	if(Result || Decoded != Item.UncompressSize)
+	{
+		SendAlert(37, Item.Path);//The decompressed sizes of file and file-entry do not match.
+		return 1;
+	}
+	return 0;
+}
+/// \brief Unpacking entire contents of the archive
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Archive is opened once and file-entries are extracted in order of their data in the archive (not in order
+/// of the table of contents), so the archive is read forward. Data of neighbouring small file-entries is read into the
+/// read window by single large read
+int FstUnpack::UnpackEntireArchive()
+{
+	AmountSkipped = 0;
+
+	//Checking for loading the archive into memory
+	if(ArchivePath.empty())
+	{
+		SendAlert(16, nullptr);//Archive not loaded into memory.
+		return 1;
+	}
+	if(OpenSource())
+	{
+		return 1;
+	}
+
+	//Resumable unpacking: file-entries recorded in the journal are skipped if their files are complete
+	std::vector<cnv::qword> Recorded;
+	if(ResumeMode && OpenJournal(Recorded))
+	{
+		CloseSource();
+		return 1;
+	}
+
+	//Schedule of extraction: file-entries to be written, ordered by offset of data
+	std::vector<cnv::unsint> Order;
+	Order.reserve(AmountEntries);
+	std::vector<bool> Compare(AmountEntries, false);
+	for(cnv::dword i = 0; i < AmountEntries; i++)
+	{
+		bool CompareFirst = false;
+		if((ResumeMode || Incremental != IM_NONE) && IsUnpacked(i, ResumeMode ? Recorded.at(i) : JournalNoRecord, CompareFirst))
+		{
+			AmountSkipped++;
+			continue;
+		}
+		Compare[i] = CompareFirst;
+		Order.push_back(i);
+	}
+
+	//Access trace (if hook is set) keeps order of requests (table of contents order), not order of reading
+	for(cnv::unsint k = 0; k < Order.size(); k++)
+	{
+		TraceAccess(Order.at(k));
+	}
+	std::stable_sort(Order.begin(), Order.end(), [this](cnv::unsint First, cnv::unsint Second)
+	{
+		return TOCList.at(First).DataOffset < TOCList.at(Second).DataOffset;
+	});
+
+	int Result = 0;
+	for(cnv::unsint k = 0; k < Order.size() && Result == 0; k++)
+	{
+		cnv::unsint i = Order.at(k);
+		Result = FillWindow(Order, k);
+		bool Unchanged = false;
+		if(Result == 0)
+			Result = ExtractEntry(i, Compare[i], Unchanged);
+		if(Result == 0 && Unchanged)
+			AmountSkipped++;
+		if(Result == 0 && ResumeMode)
+			Result = WriteJournal(i, TOCList.at(i).UncompressSize);
+	}
+	std::vector<cnv::byte>().swap(Window);
+	WindowLease.Release();
+	WindowBegin = 0;
+	CloseSource();
+
+	//Journal of completed unpacking is not needed anymore
+	CloseJournal(Result == 0);
+	return Result;
+}
+/// \brief Filling the read window with data of the next file-entries of the schedule (if needed)
+/// \param[in] Order Schedule of extraction (ordinal numbers of file-entries ordered by offset of data)
+/// \param[in] Position Position of the next file-entry in the schedule
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Window starts at data of the next file-entry and takes following file-entries while they fit into
+/// ReadWindowSize and gaps between them are small. Large file-entries are not windowed (they are read directly)
+int FstUnpack::FillWindow(const std::vector<cnv::unsint>& Order, cnv::unsint Position)
+{
+	//Data of nested archive is already in memory
+	if(Depth != 0)
+		return 0;
+	const Entry& Item = TOCList.at(Order.at(Position));
+	if(Item.CompressFlag == CF_EMPTY || Item.CompressSize > ReadWindowEntryLimit)
+		return 0;
+	if(Item.DataOffset >= WindowBegin && Item.DataOffset + Item.CompressSize <= WindowBegin + Window.size())
+		return 0;
+
+	//Range of the window
+	cnv::qword Begin = Item.DataOffset;
+	cnv::qword End = Item.DataOffset + Item.CompressSize;
+	for(cnv::unsint k = Position + 1; k < Order.size(); k++)
+	{
+		const Entry& Next = TOCList.at(Order.at(k));
+		if(Next.CompressFlag == CF_EMPTY)
+			continue;
+		cnv::qword NextEnd = Next.DataOffset + Next.CompressSize;
+		if(Next.CompressSize > ReadWindowEntryLimit || Next.DataOffset > End + ReadWindowGap || NextEnd - Begin > ReadWindowSize)
+			break;
+		if(NextEnd > End)
+			End = NextEnd;
+	}
+	if(End > FileSize)
+	{
+		SendAlert(36, Item.Path);//Data of file-entry lies outside the archive file.
+		return 1;
+	}
+
+	//Without room in the memory budget data is read by each file-entry itself
+	if(End - Begin > WindowLease.GetSize() && !WindowLease.TryAcquire((Window.capacity() > End - Begin) ? Window.capacity() : End - Begin))
+		return 0;
+
+	EVENT_SCOPE(ReadEvent, "Read window", Order.at(Position));
+	Window.resize(End - Begin);
+	WindowBegin = Begin;
+	OpenArchive.seekg(Begin, std::ios_base::beg);
+	if(StreamRead(OpenArchive, reinterpret_cast<char*>(Window.data()), static_cast<int>(Window.size())))
+	{
+		Window.clear();
+		return 1;
+	}
+	return 0;
+}
+/// \brief Checking that output file of file-entry doesn't need to be written
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[in] Recorded Size recorded in the journal of resumable unpacking (JournalNoRecord - no record)
+/// \param[out] Compare True - content of compressed file-entry must be compared with the file when it is decoded
+/// \return True - file is complete (recorded in the journal) or unchanged (incremental mode)
+/// \details Size is checked first, so nothing is read or decompressed for files of other size. Compressed data is not
+/// decoded here: it is compared by ExtractEntry, which writes the same decoded data if the file differs
+bool FstUnpack::IsUnpacked(cnv::unsint Count, cnv::qword Recorded, bool& Compare)
+{
+	Compare = false;
+	cnv::qword Size = 0;
+	const std::string& Receiver = chf::JoinPath(ExtractPaths, {ExtractPrefix.data(), static_cast<cnv::unsint>(ExtractPrefix.size())},
+		{TOCList.at(Count).Path.data(), static_cast<cnv::unsint>(TOCList.at(Count).Path.size())});
+	if(!chf::GetFileStat(Receiver, Size) || Size != TOCList.at(Count).UncompressSize)
+		return false;
+	if(Recorded == Size || Incremental == IM_SIZE)
+		return true;
+	if(Incremental != IM_CONTENT)
+		return false;
+	if(TOCList.at(Count).CompressFlag == CF_COMPRESS)
+	{
+		Compare = true;
+		return false;
+	}
+	bool Equal = false;
+	ErrorCheckpoint Checkpoint;
+	if(CompareEntry(Count, Receiver, nullptr, Equal))
+	{
+		Checkpoint.Rollback();//File which can't be compared is written again
+		return false;
+	}
+	return Equal;
+}
+/// \brief Comparing content of file with data of file-entry
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[in] local_Input Path to the file (size is equal to uncompressed size of file-entry)
+/// \param[in] Expected Decoded data of the file-entry (nullptr - stored data is read from the archive)
+/// \param[out] Equal True - content is the same
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Archive stream must be opened for stored data, which is compared by blocks directly with the archive.
+/// Comparison stops at the first different block
+int FstUnpack::CompareEntry(cnv::unsint Count, const std::string& local_Input, const cnv::byte* Expected, bool& Equal)
+{
+	Equal = false;
+	const Entry& Item = TOCList.at(Count);
+	if(Item.CompressFlag == CF_EMPTY)
+	{
+		Equal = true;
+		return 0;
+	}
+	ifstream Existing(local_Input, ios::in|ios::binary);
+	if(!Existing.is_open())
+	{
+		SendAlert(20, local_Input);//The file can't be opened or does not exist.
+		return 1;
+	}
+	const cnv::dword BlockSize = 1024*64;//64 KB
+	std::vector<char> Block(BlockSize);
+	if(Expected == nullptr)
+	{
+		ReadBuffer.resize(BlockSize);
+		Source().seekg(Item.DataOffset, std::ios_base::beg);
+	}
+	Equal = true;
+	for(cnv::qword Done = 0; Done < Item.UncompressSize && Equal; )
+	{
+		cnv::dword Part = (Item.UncompressSize - Done > BlockSize) ? BlockSize : static_cast<cnv::dword>(Item.UncompressSize - Done);
+		if(StreamRead(Existing, Block.data(), static_cast<int>(Part)))
 		{
-			OpenArchive.close();
 			return 1;
 		}
-
-		//Read Path
-		TOCList.at(i).Path.resize(250);
-		StreamRead(OpenArchive, TOCList.at(i).Path.data(), 250);
-
-		//String optimization
-		for(cnv::unsint j = 0; j < 250; j++)
+		if(Expected == nullptr)
 		{
-			if(TOCList.at(i).Path.at(j) == 0)
+			if(StreamRead(Source(), reinterpret_cast<char*>(ReadBuffer.data()), static_cast<int>(Part)))
 			{
-				TOCList.at(i).Path.resize(j);
-                break;
+				return 1;
 			}
-		}
-
-		//Calculate CompressFlag
-		if(TOCList.at(i).UncompressSize == 0)
-		{
-			TOCList.at(i).CompressFlag = CF_EMPTY;
-        }
-		else if(TOCList.at(i).CompressSize == TOCList.at(i).UncompressSize)
-		{
-			TOCList.at(i).CompressFlag = CF_UNCOMPRESS;
+			Equal = (memcmp(Block.data(), ReadBuffer.data(), Part) == 0);
 		}
 		else
 		{
-			TOCList.at(i).CompressFlag = CF_COMPRESS;
+			Equal = (memcmp(Block.data(), Expected + Done, Part) == 0);
 		}
+		Done += Part;
 	}
-
-	OpenArchive.close();
 	return 0;
 }
-/// \brief Extracting a single file from the archive
-/// \param[in] Count Ordinal number of the file being unpacked
+/// \brief Opening journal of resumable unpacking and reading records of the previous run
+/// \param[out] Recorded Size of every file-entry recorded as completed (JournalNoRecord - no record)
 /// \return Error code: 0 - no errors, 1 - operation error
-int FstUnpack::ExtractFromArchive(cnv::unsint Count)
+/// \details Journal lies beside the output directory ("<archive>_unpack.journal"). It starts with line of signature,
+/// archive size and amount of entries (journal of other archive is discarded), followed by lines "e <index> <size>"
+/// of completed entries and "w <amount>" watermarks (amount of records in the journal). Watermark is written after
+/// output files of the records before it and the journal are flushed to disk, so only records before the last
+/// watermark are honored. Journal is written again with the honored records, so records of interrupted run which
+/// were not confirmed by watermark are dropped
+int FstUnpack::OpenJournal(std::vector<cnv::qword>& Recorded)
 {
-	//Checking for loading the archive into memory
-	if(ArchivePath.empty())
-	{
-		SendAlert(16, nullptr);//Archive not loaded into memory.
-		return 1;
-	}
-
-	//Checking for compliance with boundaries of the archive table of contents
-	if(AmountEntries <= Count)
-	{
-		SendAlert(17, nullptr);//Violating boundaries of the table of contents (Attempted to read outside the list limits).
-		return 1;
-	}
-
-	//Trying to open the archive
-	OpenArchive.open(ArchivePath, ios::in|ios::binary);
-	if(!OpenArchive.is_open())
+	Recorded.assign(AmountEntries, JournalNoRecord);
+	JournalPending.clear();
+	JournalRecords = 0;
+	std::string JournalPath = GetJournalPath();
+
+	//Reading records of the previous run (if journal belongs to the same archive)
+	ifstream Previous(JournalPath, ios::in|ios::binary);
+	if(Previous.is_open())
 	{
-		SendAlert(18, ArchivePath);//Can't open input archive file. File does not exist or is locked. (Or the file path contains Unicode characters.)
-		return 1;
-	}
-
-	//Formation of variables for generating folder and file names when unpacking
-	std::string SymbolOfDisk; SymbolOfDisk.resize(MAX_PATH);
-	std::string PathOfDirectory; PathOfDirectory.resize(MAX_PATH);
-	std::string NameOfFile; NameOfFile.resize(MAX_PATH);
-	std::string ExtensionOfFile; ExtensionOfFile.resize(MAX_PATH);
-	std::string NameOfFileUpdated; NameOfFileUpdated.resize(MAX_PATH);
-	chf::SplitPath(ArchivePath, SymbolOfDisk, PathOfDirectory, NameOfFile, ExtensionOfFile);
-
-	std::string DirectoryForExtract; DirectoryForExtract.resize(MAX_PATH);
-
-	for(cnv::unsint i = 0; ; i++)
-	{
-		//Correct the unpacking path by checking the data from the archive (if necessary)
-		cnv::unsint Position = 0;
-		cnv::unsint k = 0;
-		if(i != 0)
+		std::string Line;
+		std::getline(Previous, Line);
+		std::stringstream Head(Line);
+		std::string Signature;
+		cnv::qword Size = 0;
+		cnv::qword Amount = 0;
+		Head >> Signature >> Size >> Amount;
+		bool Valid = (Signature == JournalSignature && Size == FileSize && Amount == AmountEntries && !Previous.eof());
+		std::vector<std::pair<cnv::qword, cnv::qword>> Unconfirmed;
+		while(Valid && std::getline(Previous, Line) && !Previous.eof())
 		{
-			for(cnv::unsint j = 0; j < static_cast<cnv::unsint>(TOCList.at(Count).Path.size()); j++)
+			cnv::qword Index = 0;
+			cnv::qword EntrySize = 0;
+			cnv::qword Watermark = 0;
+			if(sscanf(Line.data(), "e %llu %llu", &Index, &EntrySize) == 2 && Index < AmountEntries)
+				Unconfirmed.push_back({Index, EntrySize});
+			else if(sscanf(Line.data(), "w %llu", &Watermark) == 1)
 			{
-				if(TOCList.at(Count).Path.at(j) == '\\')
+				for(cnv::unsint i = 0; i < Unconfirmed.size(); i++)
 				{
-					Position = j + 1;
-					k++;
-					if(i == k)
-						break;
+					Recorded.at(Unconfirmed.at(i).first) = Unconfirmed.at(i).second;
 				}
+				Unconfirmed.clear();
 			}
-
-			if(i - 1 == k)
-				break;
-		}
-
-		if(k != 0)
-			NameOfFileUpdated = NameOfFile + ExtensionOfFile + "_unpack\\" + TOCList.at(Count).Path.substr(0, Position);
-		else
-			NameOfFileUpdated = NameOfFile + ExtensionOfFile + "_unpack\\";
-
-		//Getting file path assembly from parameters (DeepDirectory). This is the option when output folder is created
-		std::string DeepDirectory; DeepDirectory.resize(MAX_PATH);
-		_makepath(DeepDirectory.data(), SymbolOfDisk.data(), PathOfDirectory.data(), NameOfFileUpdated.data(), nullptr);
-		chf::CreateDirectory(DeepDirectory);
-		if(!(chf::IsDirectoryExists(DeepDirectory)))
-		{
-			OpenArchive.close();
-			SendAlert(19, DeepDirectory);//Directory does not exist.
-			return 1;
 		}
+		Previous.close();
 	}
 
-	//Formation of path to output file
-	NameOfFileUpdated = NameOfFile + ExtensionOfFile + "_unpack\\";
-	_makepath(DirectoryForExtract.data(), SymbolOfDisk.data(), PathOfDirectory.data(), NameOfFileUpdated.data(), nullptr);
-	std::string Receiver; Receiver.resize(MAX_PATH);
-	Receiver = DirectoryForExtract.data() + TOCList.at(Count).Path;
-
-	//Trying to open output file
-	OpenReceiver.open(Receiver, ios::out|ios::binary);
-	if(!OpenReceiver.is_open())
+	//Journal is started again with the honored records
+	Journal = fopen(JournalPath.data(), "wb");
+	if(Journal == nullptr)
 	{
-		OpenArchive.close();
-		SendAlert(20, Receiver);//The file can't be opened or does not exist.
+		SendAlert(58, JournalPath);//Can't write unpack journal file. File is locked or disk is full. (Or the file path contains Unicode characters.)
 		return 1;
-    }
-
-	//Loading the required data segment from the archive
-	ReadBuffer.resize(TOCList.at(Count).CompressSize);
-	OpenArchive.seekg(TOCList.at(Count).DataOffset, std::ios_base::beg);
-	StreamRead(OpenArchive, reinterpret_cast<char*>(ReadBuffer.data()), static_cast<int>(TOCList.at(Count).CompressSize));
-
-	//Trying to unpack the file-entry if it is compressed
-	if(TOCList.at(Count).CompressFlag == 1)
-	{
-		DecompBuffer.resize(TOCList.at(Count).UncompressSize + 16);//Adding some space just in case
-
-		UncompressedSize = static_cast<cnv::dword>(LZDecompress(DecompBuffer.data(), ReadBuffer.data(), TOCList.at(Count).CompressSize));
-
-		if(UncompressedSize == TOCList.at(Count).UncompressSize)
-		{
-			OpenReceiver.write(reinterpret_cast<const char*>(DecompBuffer.data()), TOCList.at(Count).UncompressSize);
-		}
-		else
-		{
-			SendAlert(21, Receiver);//The decompressed sizes of file and file-entry do not match.
-			return 1;
-		}
 	}
-	else if(TOCList.at(Count).CompressFlag == 0)
+	fprintf(Journal, "%s %llu %llu\n", JournalSignature, FileSize, static_cast<cnv::qword>(AmountEntries));
+	for(cnv::unsint i = 0; i < AmountEntries; i++)
 	{
-		OpenReceiver.write(reinterpret_cast<const char*>(ReadBuffer.data()), TOCList.at(Count).CompressSize);
+		if(Recorded.at(i) == JournalNoRecord)
+			continue;
+		fprintf(Journal, "e %u %llu\n", i, Recorded.at(i));
+		JournalRecords++;
 	}
-
-	OpenReceiver.close();
-	OpenArchive.close();
-
-	if(chf::GetFileSize(Receiver) == 0 && TOCList.at(Count).CompressFlag != 2)
+	return SyncJournal();
+}
+/// \brief Recording completed file-entry in the journal
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[in] Size Size of output file
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Record counts only after the next watermark, which is written every JournalSyncInterval records
+int FstUnpack::WriteJournal(cnv::unsint Count, cnv::qword Size)
+{
+	if(fprintf(Journal, "e %u %llu\n", Count, Size) < 0)
 	{
-		SendAlert(22, Receiver);//The created file does not exist or has size of zero.
+		SendAlert(58, TOCList.at(Count).Path);//Can't write unpack journal file. File is locked or disk is full. (Or the file path contains Unicode characters.)
 		return 1;
 	}
-	return 0;
+	JournalRecords++;
+	JournalPending.push_back(Count);
+	if(JournalPending.size() < JournalSyncInterval)
+		return 0;
+	return SyncJournal();
 }
-/// \brief Unpacking entire contents of the archive
+/// \brief Flushing output files of pending records and the journal to disk, and writing watermark
 /// \return Error code: 0 - no errors, 1 - operation error
-int FstUnpack::UnpackEntireArchive()
+/// \details Records before the watermark are kept after crash or power loss together with their output files
+int FstUnpack::SyncJournal()
 {
-	for(cnv::dword i = 0; i < AmountEntries; i++)
+	for(cnv::unsint i = 0; i < JournalPending.size(); i++)
 	{
-		if(ExtractFromArchive(i))
+		cnv::unsint Count = JournalPending.at(i);
+		const std::string& Receiver = chf::JoinPath(ExtractPaths, {ExtractPrefix.data(), static_cast<cnv::unsint>(ExtractPrefix.size())},
+			{TOCList.at(Count).Path.data(), static_cast<cnv::unsint>(TOCList.at(Count).Path.size())});
+		FILE* Output = fopen(Receiver.data(), "r+b");
+		bool Flushed = (Output != nullptr && fflush(Output) == 0 && _commit(_fileno(Output)) == 0);
+		if(Output != nullptr)
+			fclose(Output);
+		if(!Flushed)
+		{
+			SendAlert(71, Receiver);//Can't flush unpacked file to disk. File is locked or was removed while unpacking.
 			return 1;
+		}
+	}
+	JournalPending.clear();
+	if(fprintf(Journal, "w %u\n", JournalRecords) < 0 || fflush(Journal) != 0 || _commit(_fileno(Journal)) != 0)
+	{
+		SendAlert(58, GetJournalPath());//Can't write unpack journal file. File is locked or disk is full. (Or the file path contains Unicode characters.)
+		return 1;
 	}
 	return 0;
 }
+/// \brief Closing the journal
+/// \param[in] Completed True - all file-entries are unpacked (journal is removed), False - journal is kept for the next run
+void FstUnpack::CloseJournal(bool Completed)
+{
+	if(Journal == nullptr)
+		return;
+	if(!Completed && !JournalPending.empty())
+		SyncJournal();
+	fclose(Journal);
+	Journal = nullptr;
+	JournalPending.clear();
+	if(Completed)
+		remove(GetJournalPath().data());
+}
 /// \brief Creating a list-file with contents of the archive
 /// \return Error code: 0 - no errors, 1 - operation error
 int FstUnpack::CreateListFile()
@@ -596,17 +2316,9 @@ int FstUnpack::CreateListFile()
 		return 1;
 	}
 
-	//Formation of variables for generating folder and file names when unpacking
-	std::string SymbolOfDisk; SymbolOfDisk.resize(MAX_PATH);
-	std::string PathOfDirectory; PathOfDirectory.resize(MAX_PATH);
-	std::string NameOfFile; NameOfFile.resize(MAX_PATH);
-	std::string ExtensionOfFile; ExtensionOfFile.resize(MAX_PATH);
-	std::string DirectoryForList; DirectoryForList.resize(MAX_PATH);
-	chf::SplitPath(ArchivePath, SymbolOfDisk, PathOfDirectory, NameOfFile, ExtensionOfFile);
-
-	//Create list-file of the same name in this folder
-	std::string ListFileName; ListFileName.reserve(MAX_PATH);
-	ListFileName = SymbolOfDisk + PathOfDirectory + NameOfFile + ExtensionOfFile + ".list";
+	//Create list-file of the same name in this folder, its paths refer to output directory of unpacking
+	std::string ListFileName = ArchivePath + ".list";
+	chf::PathPart NameOfArchive = chf::GetNamePart(ArchivePath);
 	ofstream ListFromArchiveFile(ListFileName, ios::out);
 
 	//Forming the list-file
@@ -625,11 +2337,13 @@ int FstUnpack::CreateListFile()
 			}
 			if(TOCList.at(i).CompressFlag == CF_UNCOMPRESS)
 			{
-				ListFromArchiveFile << "u " << NameOfFile << ExtensionOfFile << "_unpack\\" << TOCList.at(i).Path;
+				ListFromArchiveFile << "u ";
+				ListFromArchiveFile.write(NameOfArchive.Data, NameOfArchive.Size) << "_unpack\\" << TOCList.at(i).Path;
 			}
 			else if(TOCList.at(i).CompressFlag == CF_COMPRESS)
 			{
-				ListFromArchiveFile << "c " << NameOfFile << ExtensionOfFile << "_unpack\\" << TOCList.at(i).Path;
+				ListFromArchiveFile << "c ";
+				ListFromArchiveFile.write(NameOfArchive.Data, NameOfArchive.Size) << "_unpack\\" << TOCList.at(i).Path;
 			}
 		}
 		ListFromArchiveFile.close();
@@ -642,14 +2356,396 @@ int FstUnpack::CreateListFile()
 	}
 	return 0;
 }
+/// \brief Reading uncompressed data of file-entry into memory
+/// \param[in] Archive File stream of the archive opened by caller (one stream per thread)
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[out] Output Buffer for uncompressed data (resized to size of file-entry)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Buffer is first resized to GetDecodeSize, so data is decoded in place, then cut to size of file-entry
+/// (capacity is kept, so reused buffer isn't allocated again)
+int FstUnpack::DecodeEntry(std::istream& Archive, cnv::unsint Count, std::vector<cnv::byte>& Output)
+{
+	//Checking for compliance with boundaries of the archive table of contents
+	if(AmountEntries <= Count)
+	{
+		SendAlert(35, nullptr);//Violating boundaries of the table of contents (Attempted to read outside the list limits).
+		return 1;
+	}
+	Output.resize(GetDecodeSize(Count));
+	int Result = DecodeEntry(Archive, Count, Output.data(), Output.size());
+	Output.resize(TOCList.at(Count).UncompressSize);
+	return Result;
+}
+/// \brief Reading uncompressed data of file-entry into memory owned by caller
+/// \param[in] Archive File stream of the archive opened by caller (one stream per thread)
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[out] Output Buffer for uncompressed data
+/// \param[in] OutputSize Size of buffer (not smaller than uncompressed size of file-entry)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Nothing is written past the end of the buffer even if the archive is damaged. Stored entries and entries
+/// compressed with shared dictionary are decoded in place into buffer of uncompressed size. The library decoder writes
+/// up to LibraryOutputSlack bytes past the data, so other compressed entries are decoded in place only into buffer of
+/// GetDecodeSize bytes; smaller buffer gets them through a temporary buffer and a copy
+int FstUnpack::DecodeEntry(std::istream& Archive, cnv::unsint Count, cnv::byte* Output, cnv::qword OutputSize)
+{
+	ErrorEntry EntryMark(Count);
+
+	//Checking for compliance with boundaries of the archive table of contents
+	if(AmountEntries <= Count)
+	{
+		SendAlert(35, nullptr);//Violating boundaries of the table of contents (Attempted to read outside the list limits).
+		return 1;
+	}
+
+	//Checking size of the buffer
+	if(OutputSize < TOCList.at(Count).UncompressSize)
+	{
+		SendAlert(56, TOCList.at(Count).Path);//Output buffer is smaller than uncompressed size of file-entry.
+		return 1;
+	}
+
+	//Access trace (if hook is set)
+	TraceAccess(Count);
+
+	std::vector<cnv::byte> RawData;
+	return ReadData(Archive, Count, Output, OutputSize, RawData);
+}
+/// \brief Get size of buffer which lets DecodeEntry decode file-entry in place
+/// \param[in] Count Ordinal number of the file-entry
+/// \return Uncompressed size, plus LibraryOutputSlack for file-entry decoded by the library
+cnv::qword FstUnpack::GetDecodeSize(cnv::unsint Count)
+{
+	const Entry& Item = TOCList.at(Count);
+	if(Item.CompressFlag == CF_COMPRESS && !(Item.Flags & EF_DICTIONARY))
+		return Item.UncompressSize + LibraryOutputSlack;
+	return Item.UncompressSize;
+}
+/// \brief Reading beginning of uncompressed data of file-entry
+/// \param[in] Archive File stream of the archive opened by caller (one stream per thread)
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[in] Size Size of the beginning (cut at the end of file-entry)
+/// \param[out] Output Data of the beginning (resized to its size)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Decoding stops as soon as the beginning is complete, rest of compressed data is not read
+int FstUnpack::DecodePrefix(std::istream& Archive, cnv::unsint Count, cnv::qword Size, std::vector<cnv::byte>& Output)
+{
+	return ReadRange(Archive, Count, 0, Size, Output);
+}
+/// \brief Reading range of uncompressed data of file-entry
+/// \param[in] Archive File stream of the archive opened by caller (one stream per thread)
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[in] Offset Offset of the range in uncompressed data (not greater than uncompressed size)
+/// \param[in] Length Length of the range (cut at the end of file-entry)
+/// \param[out] Output Data of the range (resized to its length)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Stored data of the range is read directly. Data compressed with shared dictionary is decoded from the beginning
+/// with data before the range discarded, and reading stops as soon as the range is complete. Other compressed data is
+/// decoded whole by the library decoder
+int FstUnpack::ReadRange(std::istream& Archive, cnv::unsint Count, cnv::qword Offset, cnv::qword Length, std::vector<cnv::byte>& Output)
+{
+	ErrorEntry EntryMark(Count);
+
+	//Checking for compliance with boundaries of the archive table of contents
+	if(AmountEntries <= Count)
+	{
+		SendAlert(35, nullptr);//Violating boundaries of the table of contents (Attempted to read outside the list limits).
+		return 1;
+	}
+
+	//Checking the range
+	const Entry& Item = TOCList.at(Count);
+	if(Offset > Item.UncompressSize)
+	{
+		SendAlert(57, Item.Path);//Requested range starts past the end of file-entry.
+		return 1;
+	}
+	if(Length > Item.UncompressSize - Offset)
+		Length = Item.UncompressSize - Offset;
+	Output.resize(Length);
+
+	//Checking that data of file-entry lies inside the archive
+	if(Item.DataOffset + Item.CompressSize > FileSize)
+	{
+		SendAlert(36, Item.Path);//Data of file-entry lies outside the archive file.
+		return 1;
+	}
+
+	//Access trace (if hook is set)
+	TraceAccess(Count);
+
+	if(Length == 0 || Item.CompressFlag == CF_EMPTY)
+		return 0;
+
+	if(Item.CompressFlag == CF_UNCOMPRESS)
+	{
+		EVENT_SCOPE(ReadEvent, "Read", Count);
+		Archive.seekg(Item.DataOffset + Offset, std::ios_base::beg);
+		return StreamRead(Archive, reinterpret_cast<char*>(Output.data()), Length);
+	}
+
+	const lzc::Dictionary* Dict = nullptr;
+	if(SelectDictionary(Count, Dict))
+		return 1;
+
+	//Library decoder can't stop inside the data, so file-entry compressed without dictionary is decoded whole
+	if(Dict == nullptr)
+	{
+		std::vector<cnv::byte> Decoded(GetDecodeSize(Count));
+		std::vector<cnv::byte> RawData;
+		if(ReadData(Archive, Count, Decoded.data(), Decoded.size(), RawData))
+			return 1;
+		memcpy(Output.data(), Decoded.data() + Offset, Length);
+		return 0;
+	}
+
+	EVENT_SCOPE(DecompressEvent, "Decompress", Count);
+	Archive.seekg(Item.DataOffset, std::ios_base::beg);
+	cnv::qword Left = Item.CompressSize;
+	cnv::qword Step = RangeReadStart;
+	auto Read = [&Archive, &Left, &Step](cnv::byte* Block, cnv::qword Size) -> cnv::qword
+	{
+		//Reading starts with small part and grows, so short ranges at the beginning don't read large blocks
+		cnv::qword Part = (Left > Size) ? Size : Left;
+		if(Part > Step)
+			Part = Step;
+		Step *= 2;
+		if(Part == 0 || StreamRead(Archive, reinterpret_cast<char*>(Block), static_cast<int>(Part)))
+			return 0;
+		Left -= Part;
+		return Part;
+	};
+	cnv::qword Decoded = 0;
+	if(lzc::DecompressRange(Read, Offset, Output.data(), Length, Decoded, Dict) || Decoded != Length)
+	{
+		SendAlert(37, Item.Path);//The decompressed sizes of file and file-entry do not match.
+		return 1;
+	}
+	return 0;
+}
+/// \brief Reading data of file-entry and decoding it into buffer of uncompressed size
+/// \param[in] Archive File stream of the archive
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[out] Output Buffer for uncompressed data
+/// \param[in] OutputSize Size of the buffer (not smaller than uncompressed size of file-entry, see Decompress)
+/// \param[in,out] RawData Buffer for compressed data (may be reused between calls)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Stored data is read directly into the output buffer
+int FstUnpack::ReadData(std::istream& Archive, cnv::unsint Count, cnv::byte* Output, cnv::qword OutputSize, std::vector<cnv::byte>& RawData)
+{
+	//Checking that data of file-entry lies inside the archive
+	if(TOCList.at(Count).DataOffset + TOCList.at(Count).CompressSize > FileSize)
+	{
+		SendAlert(36, TOCList.at(Count).Path);//Data of file-entry lies outside the archive file.
+		return 1;
+	}
+	if(TOCList.at(Count).CompressFlag == CF_EMPTY)
+		return 0;
+
+	EVENT_SCOPE(ReadEvent, "Read", Count);
+	Archive.seekg(TOCList.at(Count).DataOffset, std::ios_base::beg);
+	if(TOCList.at(Count).CompressFlag == CF_UNCOMPRESS)
+		return StreamRead(Archive, reinterpret_cast<char*>(Output), TOCList.at(Count).CompressSize);
+
+	RawData.resize(TOCList.at(Count).CompressSize);
+	if(StreamRead(Archive, reinterpret_cast<char*>(RawData.data()), TOCList.at(Count).CompressSize))
+		return 1;
+	EVENT_END(ReadEvent);
+
+	EVENT_SCOPE(DecompressEvent, "Decompress", Count);
+	return Decompress(Count, Output, OutputSize, RawData.data());
+}
+/// \brief Decompressing data of file-entry
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[out] local_Output Buffer for uncompressed data
+/// \param[in] OutputSize Size of the buffer (not smaller than uncompressed size of file-entry)
+/// \param[in] local_Input Compressed data of file-entry
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Entries with dictionary flag are decoded by native codec with shared dictionary. Other entries are decoded
+/// by the library function, which doesn't know size of output buffer: it decodes in place if the buffer has
+/// LibraryOutputSlack after uncompressed size, otherwise into scratch buffer, and decoded size is checked
+int FstUnpack::Decompress(cnv::unsint Count, cnv::byte* local_Output, cnv::qword OutputSize, cnv::byte* local_Input)
+{
+	const Entry& Item = TOCList.at(Count);
+	const lzc::Dictionary* Dict = nullptr;
+	if(SelectDictionary(Count, Dict))
+		return 1;
+	cnv::qword Decoded = 0;
+	//Sizes of library function are 32-bit signed, larger file-entry can't be decoded by it
+	if(Dict == nullptr && (Item.CompressSize > LONG_MAX || Item.UncompressSize > LONG_MAX))
+	{
+		SendAlert(37, Item.Path);//The decompressed sizes of file and file-entry do not match.
+		return 1;
+	}
+	if(Dict != nullptr)
+	{
+		if(lzc::Decompress(local_Input, Item.CompressSize, local_Output, Item.UncompressSize, Decoded, Dict))
+			Decoded = 0;
+	}
+	else if(OutputSize >= Item.UncompressSize + LibraryOutputSlack)
+		Decoded = static_cast<cnv::qword>(SerialDecompress(local_Output, local_Input, static_cast<unsigned long>(Item.CompressSize)));
+	else
+	{
+		std::vector<cnv::byte> Scratch(Item.UncompressSize + LibraryOutputSlack);
+		Decoded = static_cast<cnv::qword>(SerialDecompress(Scratch.data(), local_Input, static_cast<unsigned long>(Item.CompressSize)));
+		if(Decoded == Item.UncompressSize)
+			memcpy(local_Output, Scratch.data(), Item.UncompressSize);
+	}
+	if(Decoded != Item.UncompressSize)
+	{
+		SendAlert(37, Item.Path);//The decompressed sizes of file and file-entry do not match.
+		return 1;
+	}
+	return 0;
+}
+/// \brief Selecting dictionary for decoding of file-entry
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[out] Dict Shared dictionary (or nullptr - file-entry is compressed without dictionary)
+/// \return Error code: 0 - no errors, 1 - operation error (archive has no dictionary)
+int FstUnpack::SelectDictionary(cnv::unsint Count, const lzc::Dictionary*& Dict)
+{
+	Dict = nullptr;
+	if(!(TOCList.at(Count).Flags & EF_DICTIONARY))
+		return 0;
+	if(SharedDictionary.Data.empty())
+	{
+		SendAlert(37, TOCList.at(Count).Path);//The decompressed sizes of file and file-entry do not match.
+		return 1;
+	}
+	Dict = &SharedDictionary;
+	return 0;
+}
+/// \brief Passing path of accessed file-entry to the trace hook
+/// \param[in] Count Ordinal number of the file-entry
+/// \details Calls are serialized, so the hook may be simple even when entries are read by several threads
+void FstUnpack::TraceAccess(cnv::unsint Count)
+{
+	if(!TraceHook)
+		return;
+	std::lock_guard<std::mutex> Lock(TraceMutex);
+	TraceHook(TOCList.at(Count).Path);
+}
+/// \brief Calculating size of archive header (table of contents included)
+/// \return Size of archive header in bytes
+cnv::qword FstUnpack::GetHeadSize()
+{
+	if(Format == AF_FST64 && Version == Fst64DictionaryVersion)
+		return Fst64HeadSize + Fst64DictionaryFields + static_cast<cnv::qword>(AmountEntries) * Fst64RecordSize;
+	if(Format == AF_FST64)
+		return Fst64HeadSize + static_cast<cnv::qword>(AmountEntries) * Fst64RecordSize;
+	return static_cast<cnv::qword>(AmountEntries) * 262 + 4;
+}
+/// \brief Writing header of the archive (table of contents) with other data offsets
+/// \param[in] OutputStream Output stream (positioned at beginning of the file)
+/// \param[in] Offsets New data offsets of all file-entries (other fields of records are not changed)
+/// \param[in] local_DictionaryOffset Offset of shared dictionary written to the header (archives with dictionary only)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Header is written in format of the archive. Data of shared dictionary is not written
+int FstUnpack::WriteHead(std::ostream& OutputStream, const std::vector<cnv::qword>& Offsets, cnv::qword local_DictionaryOffset)
+{
+	PutArchiveHead(OutputStream, Format, Version, AmountEntries, local_DictionaryOffset, SharedDictionary.Data.size());
+	for(cnv::dword i = 0; i < AmountEntries; i++)
+	{
+		PutRecord(OutputStream, i, Offsets.at(i));
+	}
+	if(!OutputStream.good())
+	{
+		SendAlert(52, nullptr);//StreamCopy - Write error on output operation.
+		return 1;
+	}
+	return 0;
+}
+/// \brief Writing single record of table of contents (as it is in memory)
+/// \param[in] OutputStream Output stream (positioned at GetRecordOffset of the record)
+/// \param[in] Count Ordinal number of the file-entry
+void FstUnpack::WriteRecord(std::ostream& OutputStream, cnv::unsint Count)
+{
+	PutRecord(OutputStream, Count, TOCList.at(Count).DataOffset);
+}
+/// \brief Writing single record of table of contents in format of the archive
+/// \param[in] OutputStream Output stream
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[in] Offset Data offset written to the record
+void FstUnpack::PutRecord(std::ostream& OutputStream, cnv::unsint Count, cnv::qword Offset)
+{
+	const Entry& Item = TOCList.at(Count);
+	PutArchiveRecord(OutputStream, Format, Offset, Item.CompressSize, Item.UncompressSize, Item.Flags, Item.Path);
+}
+/// \brief Calculating offset of record of table of contents in the archive
+/// \param[in] Count Ordinal number of the file-entry
+/// \return Offset of the record in bytes
+cnv::qword FstUnpack::GetRecordOffset(cnv::unsint Count)
+{
+	cnv::qword RecordSize = (Format == AF_FST64) ? Fst64RecordSize : 262;
+	return GetHeadSize() - (AmountEntries - static_cast<cnv::qword>(Count)) * RecordSize;
+}
+/// \brief Changing data of file-entry in table of contents (in memory)
+/// \param[in] Count Ordinal number of the file-entry
+/// \param[in] Offset Data offset
+/// \param[in] local_CompressSize Compressed size (equal to uncompressed size - data is stored)
+/// \param[in] local_UncompressSize Uncompressed size
+/// \param[in] local_Flags Flags (EntryFlag)
+void FstUnpack::SetEntry(cnv::unsint Count, cnv::qword Offset, cnv::qword local_CompressSize, cnv::qword local_UncompressSize, cnv::dword local_Flags)
+{
+	Entry& Item = TOCList.at(Count);
+	Item.DataOffset = Offset;
+	Item.CompressSize = local_CompressSize;
+	Item.UncompressSize = local_UncompressSize;
+	Item.Flags = local_Flags;
+	if(Item.UncompressSize == 0)
+		Item.CompressFlag = CF_EMPTY;
+	else if(Item.CompressSize == Item.UncompressSize)
+		Item.CompressFlag = CF_UNCOMPRESS;
+	else
+		Item.CompressFlag = CF_COMPRESS;
+}
+/// \brief Removing file-entry from table of contents (in memory)
+/// \param[in] Count Ordinal number of the file-entry
+void FstUnpack::RemoveEntry(cnv::unsint Count)
+{
+	TOCList.erase(TOCList.begin() + Count);
+	AmountEntries--;
+}
 
 
+/// \brief Checking that data starts with header of archive
+/// \param[in] Head Beginning of data (header with the first record of table of contents and signature of extended archive)
+/// \param[in] Size Size of whole data
+/// \return True - data is an archive
+/// \details Archives have no signature, so the check is structural: header must describe table of contents which fits
+/// into the data followed by data of the first record with readable path, or marker entry of extended archive followed
+/// by its signature
+bool IsArchiveHead(const std::vector<cnv::byte>& Head, cnv::qword Size)
+{
+	if(Head.size() < 4 + 262)
+		return false;
+	auto Field = [&Head](cnv::unsint Position) -> cnv::qword
+	{
+		return static_cast<cnv::qword>(Head[Position]) | static_cast<cnv::qword>(Head[Position + 1]) << 8 |
+			static_cast<cnv::qword>(Head[Position + 2]) << 16 | static_cast<cnv::qword>(Head[Position + 3]) << 24;
+	};
+	cnv::qword Amount = Field(0);
+	cnv::qword Offset = Field(4);
+
+	//Extended archive
+	if(Offset == Fst64MarkerOffset && (Amount == Fst64MarkerAmount || Amount > (Size - 4) / 262 || Amount == 0xFFFFFFFF))
+		return Head.size() >= 4 + 262 + 4 && memcmp(Head.data() + 4 + 262, Fst64Signature, 4) == 0;
+
+	//Classic archive
+	cnv::qword HeadSize = 4 + Amount * 262;
+	if(Amount == 0 || HeadSize > Size || Offset < HeadSize || Offset > Size || Field(8) > Size - Offset)
+		return false;
+	const cnv::byte* Path = Head.data() + 16;
+	cnv::unsint Length = 0;
+	while(Length < 250 && Path[Length] >= 0x20)
+		Length++;
+	return Length != 0 && Length < 250 && Path[Length] == 0;
+}
 /// \brief Read block of data from file as DWORD
 /// \param[in] local_Input File stream from which DWORD data is read
 /// \param[out] local_Output DWORD vector for storing processed data
 /// \param[in] Amount Number of DWORDs to read from the file stream
 /// \return Error code: 0 - no errors, 1 - operation error
-int DwordRead(ifstream& local_Input, std::vector<cnv::dword>& local_Output, cnv::unsint Amount)
+int DwordRead(std::istream& local_Input, std::vector<cnv::dword>& local_Output, cnv::unsint Amount)
 {
 	if(local_Output.size() < Amount)
 	{
@@ -694,7 +2790,7 @@ int DwordRead(ifstream& local_Input, std::vector<cnv::dword>& local_Output, cnv:
 /// \param[in] local_Input File stream from which DWORD data is read
 /// \param[out] local_Output DWORD variable for storing processed data
 /// \return Error code: 0 - no errors, 1 - operation error
-int DwordRead(ifstream& local_Input, cnv::dword& local_Output)
+int DwordRead(std::istream& local_Input, cnv::dword& local_Output)
 {
 	std::vector<char> Buffer(4);
 	local_Input.read(Buffer.data(), 4);
@@ -729,9 +2825,16 @@ int DwordRead(ifstream& local_Input, cnv::dword& local_Output)
 /// \param[out] Buffer Buffer for outputting read data
 /// \param[in] ReadSize Read data size
 /// \return Error code: 0 - no errors, 1 - operation error
-int StreamRead(ifstream& InputStream, char* Buffer, int ReadSize)
+/// \details Blocks larger than INT_MAX are read by parts, because size of one stream read is limited by it
+int StreamRead(std::istream& InputStream, char* Buffer, cnv::qword ReadSize)
 {
-	InputStream.read(Buffer, ReadSize);
+	for(cnv::qword Left = ReadSize; Left != 0 && InputStream.good(); )
+	{
+		cnv::qword Part = (Left > INT_MAX) ? INT_MAX : Left;
+		InputStream.read(Buffer, static_cast<std::streamsize>(Part));
+		Buffer += Part;
+		Left -= Part;
+	}
 	if(!InputStream.good())
 	{
 		if(InputStream.eof())
@@ -752,3 +2855,175 @@ int StreamRead(ifstream& InputStream, char* Buffer, int ReadSize)
 	}
 	return 0;
 }
+/// \brief Read block of data from file as QWORD
+/// \param[in] local_Input File stream from which QWORD data is read
+/// \param[out] local_Output QWORD variable for storing processed data
+/// \return Error code: 0 - no errors, 1 - operation error
+int QwordRead(std::istream& local_Input, cnv::qword& local_Output)
+{
+	cnv::byte Buffer[8];
+	if(StreamRead(local_Input, reinterpret_cast<char*>(Buffer), 8))
+		return 1;
+	cnv::qword BufferQword = 0;
+	for(cnv::unsint i = 0; i < 8; i++)
+	{
+		BufferQword |= static_cast<cnv::qword>(Buffer[i]) << (8 * i);
+	}
+	local_Output = BufferQword;
+	return 0;
+}
+/// \brief Copy block of data from one file to another by parts
+/// \param[in] InputStream Input file stream (positioned at beginning of the data)
+/// \param[in] OutputStream Output file stream (positioned at destination of the data)
+/// \param[in] Size Size of copied data
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Memory consumption doesn't depend on size of copied data
+int StreamCopy(std::istream& InputStream, ofstream& OutputStream, cnv::qword Size)
+{
+	const cnv::dword BlockSize = 1024*64;//64 KB
+	std::vector<char> Block(BlockSize);
+	for(cnv::qword Left = Size; Left != 0; )
+	{
+		cnv::dword Part = (Left > BlockSize) ? BlockSize : static_cast<cnv::dword>(Left);
+		if(StreamRead(InputStream, Block.data(), static_cast<int>(Part)))
+			return 1;
+		OutputStream.write(Block.data(), Part);
+		if(!OutputStream.good())
+		{
+			SendAlert(52, nullptr);//StreamCopy - Write error on output operation.
+			return 1;
+		}
+		Left -= Part;
+	}
+	return 0;
+}
+/// \brief Compressing data with library LZ-compression function
+/// \param[out] OutputBuffer Buffer to get compressed data
+/// \param[in] InputBuffer Buffer with uncompressed data
+/// \param[in] BufferSize Size of uncompressed data
+/// \return Compression size of output data
+/// \details The library doesn't document that the function may be called concurrently, so calls from worker
+/// threads are serialized (reading of files and compression with shared dictionary still run in parallel)
+long SerialCompress(unsigned char* OutputBuffer, unsigned char* InputBuffer, unsigned long BufferSize)
+{
+	static std::mutex CompressLock;
+	std::lock_guard<std::mutex> Lock(CompressLock);
+	return LZCompress(OutputBuffer, InputBuffer, BufferSize);
+}
+/// \brief Decompressing data with library LZ-decompression function
+/// \param[out] OutputBuffer Buffer to get uncompressed data (with space after uncompressed size, see LibraryOutputSlack)
+/// \param[in] InputBuffer Buffer with compressed data
+/// \param[in] BufferSize Size of compressed data
+/// \return Uncompression size of output data
+/// \details Calls from worker threads are serialized, as for SerialCompress
+long SerialDecompress(unsigned char* OutputBuffer, unsigned char* InputBuffer, unsigned long BufferSize)
+{
+	static std::mutex DecompressLock;
+	std::lock_guard<std::mutex> Lock(DecompressLock);
+	return LZDecompress(OutputBuffer, InputBuffer, BufferSize);
+}
+/// \brief Get path of journal of header of edited archive
+/// \param[in] local_Input Path to the archive
+/// \return Path of the journal (beside the archive)
+std::string GetEditJournalPath(const std::string& local_Input)
+{
+	return local_Input + ".edit";
+}
+/// \brief Removing journal of unfinished edit left beside the archive
+/// \param[in] local_Input Path to the archive
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Journal refers to header of the archive it was written for. Modes which create the archive anew call this
+/// before writing it, so the journal of the replaced archive isn't taken for journal of the new one
+int ClearEditJournal(const std::string& local_Input)
+{
+	std::string JournalPath = GetEditJournalPath(local_Input);
+	cnv::qword JournalSize = 0;
+	if(chf::GetFileStat(JournalPath, JournalSize) && remove(JournalPath.data()) != 0)
+	{
+		SendAlert(72, JournalPath);//Can't remove journal file. File is read-only or locked.
+		return 1;
+	}
+	return 0;
+}
+/// \brief Writing beginning of archive header (everything before the first record of table of contents)
+/// \param[in] OutputStream Output stream (positioned at beginning of the file)
+/// \param[in] local_Format Container variant of the archive (ArchiveFormat)
+/// \param[in] local_Version Version of extended header (extended archive only)
+/// \param[in] local_AmountEntries Amount of file-entries
+/// \param[in] local_DictionaryOffset Offset of shared dictionary (extended archive with dictionary only)
+/// \param[in] local_DictionarySize Size of shared dictionary (extended archive with dictionary only)
+/// \details Shared by packing and by rewriting of the header (compaction, editing), so both write the same format
+void PutArchiveHead(std::ostream& OutputStream, cnv::dword local_Format, cnv::dword local_Version, cnv::qword local_AmountEntries,
+	cnv::qword local_DictionaryOffset, cnv::dword local_DictionarySize)
+{
+	if(local_Format != AF_FST64)
+	{
+		PutBytes(OutputStream, local_AmountEntries, 4);
+		return;
+	}
+
+	//Marker entry for readers of classic format: single record whose data lies outside any classic archive
+	std::string Marker = Fst64MarkerPath;
+	Marker.resize(250);
+	PutBytes(OutputStream, Fst64MarkerAmount, 4);
+	PutBytes(OutputStream, Fst64MarkerOffset, 4);
+	PutBytes(OutputStream, 1, 4);
+	PutBytes(OutputStream, 2, 4);
+	OutputStream.write(Marker.data(), 250);
+
+	//Extended header
+	OutputStream.write(Fst64Signature, 4);
+	PutBytes(OutputStream, local_Version, 4);
+	PutBytes(OutputStream, local_AmountEntries, 8);
+	if(local_Version == Fst64DictionaryVersion)
+	{
+		PutBytes(OutputStream, local_DictionaryOffset, 8);
+		PutBytes(OutputStream, local_DictionarySize, 4);
+	}
+}
+/// \brief Writing single record of table of contents in format of the archive
+/// \param[in] OutputStream Output stream (positioned at the record)
+/// \param[in] local_Format Container variant of the archive (ArchiveFormat)
+/// \param[in] Offset Data offset
+/// \param[in] local_CompressSize Compressed size
+/// \param[in] local_UncompressSize Uncompressed size
+/// \param[in] local_Flags Flags (EntryFlag, extended archive only)
+/// \param[in] local_Path Path of file-entry (padded with zeros to 250 bytes)
+void PutArchiveRecord(std::ostream& OutputStream, cnv::dword local_Format, cnv::qword Offset, cnv::qword local_CompressSize,
+	cnv::qword local_UncompressSize, cnv::dword local_Flags, const std::string& local_Path)
+{
+	//8-byte fields and flags in extended archive
+	cnv::unsint FieldSize = (local_Format == AF_FST64) ? 8 : 4;
+	std::string Path = local_Path;
+	Path.resize(250);
+	PutBytes(OutputStream, Offset, FieldSize);
+	PutBytes(OutputStream, local_CompressSize, FieldSize);
+	PutBytes(OutputStream, local_UncompressSize, FieldSize);
+	if(local_Format == AF_FST64)
+		PutBytes(OutputStream, local_Flags, 4);
+	OutputStream.write(Path.data(), 250);
+}
+/// \brief Calculating size of padding before data of file-entry
+/// \param[in] Position Position of data in the archive without padding
+/// \param[in] local_Alignment Alignment boundary (0 or 1 - no alignment)
+/// \param[in] StoredOnly Flag of alignment of uncompressed file-entries only
+/// \param[in] Flag Compression flag of the file-entry
+/// \return Size of padding (0 - no alignment for this file-entry)
+/// \details Shared by packing and compaction, so both place data at the same boundaries
+cnv::dword GetAlignGap(cnv::qword Position, cnv::dword local_Alignment, bool StoredOnly, cnv::dword Flag)
+{
+	if(local_Alignment < 2 || (StoredOnly && Flag != CF_UNCOMPRESS))
+		return 0;
+	return static_cast<cnv::dword>((local_Alignment - Position % local_Alignment) % local_Alignment);
+}
+/// \brief Write number to file as little-endian sequence of bytes
+/// \param[in] OutputStream Output stream
+/// \param[in] Value Written number
+/// \param[in] Size Amount of written bytes
+void PutBytes(std::ostream& OutputStream, cnv::qword Value, cnv::unsint Size)
+{
+	for(cnv::unsint j = 0; j < Size; j++)
+	{
+		OutputStream << static_cast<cnv::byte>(Value >> 8 * j);
+	}
+}
@@ -17,11 +17,22 @@
 #include <io.h>
 #include <vector>
 #include <fstream> 		// ofstream
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <chrono>
+#include <climits>		// INT_MAX
 #pragma hdrstop//This directive terminates the list of header files eligible for precompilation (Using ONLY for <standard> headers, no "custom")
 
 #include "FileMark.h"
 #include "CHF.h"
 #include "ErrorDescription.h"
+#include "LzCodec.h"
+#include "EventTrace.h"
 
 /// \cond
 /// \brief Library LZ-decompression function
@@ -38,6 +49,27 @@ extern "C" __declspec(dllexport) __stdcall long LZDecompress(unsigned char* Outp
 extern "C" __declspec(dllexport) __stdcall long LZCompress(unsigned char* OutputBuffer, unsigned char* InputBuffer, unsigned long BufferSize);
 /// \endcond
 
+/// \brief Enumeration of archive container variants
+enum ArchiveFormat
+{
+	AF_FST = 0,		///< Classic archive (32-bit offsets and sizes)
+	AF_FST64 = 1	///< Extended archive (64-bit offsets and sizes)
+};
+
+/// \brief Enumeration of file-entry flags (table of contents of extended archive)
+enum EntryFlag
+{
+	EF_DICTIONARY = 1	///< Data is compressed with shared dictionary of the archive
+};
+
+/// \brief Enumeration of modes of skipping unchanged output files when unpacking entire archive
+enum IncrementalMode
+{
+	IM_NONE = 0,	///< All files are written
+	IM_SIZE = 1,	///< File of the same size as file-entry is skipped
+	IM_CONTENT = 2	///< File of the same size and content as file-entry is skipped
+};
+
 /// \brief The class contains data and functions necessary for packing FST files
 class FstPack
 {
@@ -45,25 +77,73 @@ class FstPack
 	/// \brief Amount of entries in the archive
 	cnv::dword AmountEntries;
 	/// \brief Archive size in bytes
-	cnv::dword FileSize;
+	cnv::qword FileSize;
+	/// \brief Container variant of created archive (not cleared between packings)
+	cnv::dword Format;
+	/// \brief Alignment boundary for data of file-entries (0 or 1 - no alignment, not cleared between packings)
+	cnv::dword Alignment;
+	/// \brief Flag of aligning only uncompressed file-entries (not cleared between packings)
+	bool AlignStoredOnly;
+	/// \brief Amount of padding bytes written for alignment
+	cnv::qword Padding;
+	/// \brief Path to access trace file which sets order of data placement (not cleared between packings)
+	std::string TracePath;
+	/// \brief Amount of file-entries placed by the access trace
+	cnv::dword AmountTraced;
+	/// \brief Flag of compressing small text file-entries with shared dictionary (not cleared between packings)
+	bool DictionaryMode;
+	/// \brief Shared dictionary of created archive (empty - archive without dictionary)
+	lzc::Dictionary SharedDictionary;
+	/// \brief Flag of dry run: sizes and time of packing are estimated, the archive is not created (not cleared between packings)
+	bool DryRun;
+	/// \brief Projected size of the archive (dry run)
+	cnv::qword ProjectedSize;
+	/// \brief Amount of compressed file-entries compressed by dry run (the rest is estimated)
+	cnv::dword AmountSampled;
+	/// \brief Estimated time of packing in seconds (dry run)
+	double EstimatedTime;
+	/// \brief Time of dry run in seconds
+	double DryRunTime;
 	/// \brief Packing file-entry structure
 	struct Entry
 	{
 		/// \brief Offset of file-entry in the archive
-		cnv::dword DataOffset;
+		cnv::qword DataOffset;
 		/// \brief Compressed size (in bytes) of file-entry in the archive
-		cnv::dword CompressSize;
+		cnv::qword CompressSize;
 		/// \brief Uncompressed size (in bytes) of file-entry in the archive
-		cnv::dword UncompressSize;
+		cnv::qword UncompressSize;
 		/// \brief Compression state flag of file-entry in the archive
 		cnv::dword CompressFlag;
+		/// \brief Flags of file-entry in the archive (EntryFlag)
+		cnv::dword Flags;
 		/// \brief Path to file-entry in the archive
 		std::string Path;
 		/// \brief Path to file on the hard drive
 		std::string RealPath;
+		/// \brief Compressed size is estimated by ratio of sampled file-entries (dry run of packing)
+		bool Estimated;
 	};
 	/// \brief Archive table of contents array
 	std::vector<Entry> TOCList;
+	/// \brief List of problems found when checking files from the list-file (missing, empty, too large)
+	std::vector<std::string> ScanReport;
+	/// \brief Rule for directory packing
+	struct Rule
+	{
+		/// \brief Kind of rule: '+' - include, '-' - exclude, 'c' - compress, 'u' - store uncompressed
+		char Kind;
+		/// \brief Wildcard pattern for path of file-entry
+		std::string Pattern;
+	};
+	/// \brief Rules for directory packing (applied in order, the last matching rule wins)
+	std::vector<Rule> RuleList;
+	/// \brief Flag of creating list-file when packing directory
+	bool EmitList;
+	/// \brief Root directory path (directory packing)
+	std::string RootPath;
+	/// \brief State of directory walk shared by worker threads
+	struct WalkState;
 
 	/// \brief Archive Path
 	std::string ArchivePath;
@@ -77,7 +157,11 @@ class FstPack
 	public:
 	FstPack()
 	{
-
+		Format = AF_FST;
+		Alignment = 0;
+		AlignStoredOnly = false;
+		DictionaryMode = false;
+		DryRun = false;
 	}
 	~FstPack()
 	{
@@ -85,9 +169,47 @@ class FstPack
 	}
 
 	int Pack(char*, char*);
+	int PackDirectory(char*, char*, char*);
 
+	/// \brief Set container variant of created archive
+	void SetFormat(cnv::dword local_Input){Format = local_Input;}
+	/// \brief Get container variant of created archive
+	cnv::dword GetFormat(){return Format;}
+	/// \brief Set alignment boundary for data of file-entries (all or only uncompressed ones)
+	void SetAlignment(cnv::dword local_Input, bool StoredOnly){Alignment = local_Input; AlignStoredOnly = StoredOnly;}
+	/// \brief Get alignment boundary for data of file-entries
+	cnv::dword GetAlignment(){return Alignment;}
+	/// \brief Get amount of padding bytes written for alignment
+	cnv::qword GetPadding(){return Padding;}
+	/// \brief Set path to access trace file which sets order of data placement (empty - table of contents order)
+	void SetTracePath(std::string local_Input){TracePath = local_Input;}
+	/// \brief Get path to access trace file
+	std::string GetTracePath(){return TracePath;}
+	/// \brief Get amount of file-entries placed by the access trace
+	cnv::dword GetAmountTraced(){return AmountTraced;}
+	/// \brief Set compressing small text file-entries with shared dictionary (extended archive only)
+	void SetDictionary(bool local_Input){DictionaryMode = local_Input;}
+	/// \brief Get flag of compressing small text file-entries with shared dictionary
+	bool GetDictionary(){return DictionaryMode;}
+	/// \brief Get size of shared dictionary of created archive (0 - archive without dictionary)
+	cnv::dword GetDictionarySize(){return SharedDictionary.Data.size();}
+	cnv::dword GetAmountDictionary();
+	/// \brief Set dry run of packing (sizes and time are estimated, the archive is not created)
+	void SetDryRun(bool local_Input){DryRun = local_Input;}
+	/// \brief Get flag of dry run of packing
+	bool GetDryRun(){return DryRun;}
+	/// \brief Get projected size of the archive (dry run)
+	cnv::qword GetProjectedSize(){return ProjectedSize;}
+	/// \brief Get amount of compressed file-entries compressed by dry run (the rest is estimated)
+	cnv::dword GetAmountSampled(){return AmountSampled;}
+	/// \brief Get estimated time of packing in seconds (dry run)
+	double GetEstimatedTime(){return EstimatedTime;}
+	/// \brief Get time of dry run in seconds
+	double GetDryRunTime(){return DryRunTime;}
 	/// \brief Get amount of table of contents entries
 	cnv::dword GetAmountEntries(){return TOCList.size();}
+	/// \brief Get root directory path (directory packing)
+	std::string GetRootPath(){return RootPath;}
 	/// \brief Get archive path
 	std::string GetArchivePath(){return ArchivePath;}
 	/// \brief Get list path
@@ -96,12 +218,39 @@ class FstPack
 	std::string GetEntryPath(cnv::unsint i){return TOCList.at(i).Path;}
 	/// \brief Get compression flag of file-entry in the archive
 	cnv::dword GetCompressFlag(cnv::unsint i){return TOCList.at(i).CompressFlag;}
+	/// \brief Get uncompressed size of file-entry
+	cnv::qword GetUncompressSize(cnv::unsint i){return TOCList.at(i).UncompressSize;}
+	/// \brief Get compressed size of file-entry (projected size after dry run)
+	cnv::qword GetCompressSize(cnv::unsint i){return TOCList.at(i).CompressSize;}
+	/// \brief Get flag of compressed size estimated by ratio of sampled file-entries (dry run)
+	bool IsEstimated(cnv::unsint i){return TOCList.at(i).Estimated;}
+	/// \brief Get amount of problems found when checking files from the list-file
+	cnv::dword GetAmountReport(){return ScanReport.size();}
+	/// \brief Get description of problem found when checking files from the list-file
+	std::string GetReportLine(cnv::unsint i){return ScanReport.at(i);}
 
 	private:
 	void Clear();
 	int ReadOpenList(ifstream&);
+	int ScanFiles();
+	int ReadRules(char*);
+	bool ApplyRules(std::string, cnv::dword&);
+	int WalkDirectory(std::string, WalkState&);
+	int BuildDictionary(std::vector<Entry*>&);
+	bool CompressWithDictionary(Entry&, const cnv::byte*, std::vector<cnv::byte>&);
+	void PrepareAhead(WalkState&, std::unique_lock<std::mutex>&);
+	int FillParallel(std::vector<std::vector<cnv::byte>>&);
+	int PrepareEntry(Entry&, ifstream&, std::vector<cnv::byte>&);
+	int WriteEntry(Entry&, ifstream&, const std::vector<cnv::byte>&);
+	int WriteListFile();
 	int FillData();
 	void FillHead();
+	cnv::qword GetHeadSize();
+	int BuildPlacement(std::vector<cnv::unsint>&);
+	int EstimatePack();
+	cnv::dword GetAlignGap(cnv::qword, cnv::dword);
+	int AlignOutput(cnv::dword);
+	int CheckLimit(cnv::qword, std::string);
 	int AddUncompressedFile(cnv::unsint);
 	int AddCompressedFile(cnv::unsint);
 };
@@ -113,18 +262,28 @@ class FstUnpack
 	/// \brief Amount of entries in the archive
 	cnv::dword AmountEntries;
 	/// \brief Archive size in bytes
-	cnv::dword FileSize;
+	cnv::qword FileSize;
+	/// \brief Container variant of the archive
+	cnv::dword Format;
+	/// \brief Version of extended archive header (0 - classic archive)
+	cnv::dword Version;
+	/// \brief Shared dictionary of the archive (read once when the archive is loaded)
+	lzc::Dictionary SharedDictionary;
+	/// \brief Offset of shared dictionary in the archive
+	cnv::qword DictionaryOffset;
 	/// \brief Unpacking file-entry structure
 	struct Entry
 	{
 		/// \brief Offset of file-entry in the archive
-		cnv::dword DataOffset;
+		cnv::qword DataOffset;
 		/// \brief Compressed size (in bytes) of file-entry in the archive
-		cnv::dword CompressSize;
+		cnv::qword CompressSize;
 		/// \brief Uncompressed size (in bytes) of file-entry in the archive
-		cnv::dword UncompressSize;
+		cnv::qword UncompressSize;
 		/// \brief Compression state flag of file-entry in the archive
 		cnv::dword CompressFlag;
+		/// \brief Flags of file-entry in the archive (EntryFlag)
+		cnv::dword Flags;
 		/// \brief Path to file-entry in the archive
 		std::string Path;
 	};
@@ -133,55 +292,186 @@ class FstUnpack
 
 	/// \brief Buffer for reading entries from the archive
 	std::vector<cnv::byte> ReadBuffer;
-	/// \brief Uncompressed data buffer for single entry
+	/// \brief Uncompressed data buffer for single entry (uncompressed size plus LibraryOutputSlack, so the library decodes in place)
 	std::vector<cnv::byte> DecompBuffer;
-	/// \brief Buffer to store size of uncompressed entry
-	cnv::dword UncompressedSize;
+	/// \brief Part of memory budget held by ReadBuffer and DecompBuffer (buffers are kept between entries)
+	chf::MemoryLease BufferLease;
 
 	/// \brief File stream for archive (input)
 	ifstream OpenArchive;
+	/// \brief Nesting level of the archive (0 - archive file, 1 and more - archive stored as file-entry of another archive)
+	cnv::dword Depth;
+	/// \brief Data of nested archive decoded into memory (empty for archive file)
+	std::vector<cnv::byte> Image;
+	/// \brief Part of memory budget held by data of nested archive
+	chf::MemoryLease ImageLease;
+	/// \brief Stream buffer over data of nested archive
+	chf::MemoryBuffer ImageBuffer;
+	/// \brief Stream for nested archive (input, read the same way as file stream of archive file)
+	std::istream ImageStream;
+	/// \brief Path of nested archive inside the outermost archive with trailing separator (empty for archive file)
+	std::string NestedPath;
+	/// \brief Nested archives which can't be loaded or processed (they are skipped by traversal)
+	std::vector<std::string> NestedReport;
 	/// \brief File stream for destination file  (output)
 	ofstream OpenReceiver;
 	/// \brief Archive path
 	std::string ArchivePath;
+	/// \brief Output directory of unpacking with trailing separator (directory of the archive + "<name>_unpack\\")
+	std::string ExtractPrefix;
+	/// \brief Position in output directory path from which directories are created (directories before it must exist)
+	cnv::unsint ExtractFrom;
+	/// \brief Reusable buffers for paths of unpacked files (unpacking runs in single worker, so one arena is enough)
+	chf::PathArena ExtractPaths;
+	/// \brief Flag of resumable unpacking: completed file-entries are recorded in journal, which is used by the next run (not cleared between loadings)
+	bool ResumeMode;
+	/// \brief Journal of completed file-entries (opened while the archive is unpacked)
+	FILE* Journal;
+	/// \brief File-entries recorded in the journal since the last watermark (their records don't count yet)
+	std::vector<cnv::unsint> JournalPending;
+	/// \brief Amount of records in the journal
+	cnv::unsint JournalRecords;
+	/// \brief Read window: data of several neighbouring file-entries read by single request
+	std::vector<cnv::byte> Window;
+	/// \brief Offset of the read window in the archive
+	cnv::qword WindowBegin;
+	/// \brief Part of memory budget held by the read window
+	chf::MemoryLease WindowLease;
+	/// \brief Mode of skipping unchanged output files (IncrementalMode, not cleared between loadings)
+	cnv::dword Incremental;
+	/// \brief Amount of file-entries skipped by the last unpacking
+	cnv::unsint AmountSkipped;
+	/// \brief Hook called with path of every file-entry read from the archive (not cleared between loadings)
+	std::function<void(const std::string&)> TraceHook;
+	/// \brief Mutex for calls of the trace hook
+	std::mutex TraceMutex;
 
 	public:
-	FstUnpack()
+	FstUnpack() : ImageStream(&ImageBuffer)
 	{
-
+		Depth = 0;
+		ExtractFrom = 0;
+		ResumeMode = false;
+		Incremental = IM_NONE;
+		WindowBegin = 0;
+		Journal = nullptr;
 	}
 	~FstUnpack()
 	{
-
+		if(Journal != nullptr)
+			fclose(Journal);
 	}
 
 	int Load(char*);
+	int Load(FstUnpack&, cnv::unsint);
+	bool IsArchiveEntry(std::istream&, cnv::unsint);
+	int ClassifyEntry(std::istream&, cnv::unsint, cnv::dword&);
+	int ForEachNested(std::function<int(FstUnpack&)>);
 	int ExtractFromArchive(cnv::unsint Count);
 	int UnpackEntireArchive();
     int CreateListFile();
+	int DecodeEntry(std::istream&, cnv::unsint, std::vector<cnv::byte>&);
+	int DecodeEntry(std::istream&, cnv::unsint, cnv::byte*, cnv::qword);
+	cnv::qword GetDecodeSize(cnv::unsint);
+	int DecodePrefix(std::istream&, cnv::unsint, cnv::qword, std::vector<cnv::byte>&);
+	int ReadRange(std::istream&, cnv::unsint, cnv::qword, cnv::qword, std::vector<cnv::byte>&);
+	cnv::qword GetHeadSize();
+	int WriteHead(std::ostream&, const std::vector<cnv::qword>&, cnv::qword);
+	void WriteRecord(std::ostream&, cnv::unsint);
+	cnv::qword GetRecordOffset(cnv::unsint);
+	void SetEntry(cnv::unsint, cnv::qword, cnv::qword, cnv::qword, cnv::dword);
+	/// \brief Change path of file-entry in table of contents (in memory)
+	void SetPath(cnv::unsint i, std::string local_Input){TOCList.at(i).Path = local_Input;}
+	void RemoveEntry(cnv::unsint);
 
+	/// \brief Set resumable unpacking (journal of completed file-entries beside the output directory)
+	void SetResume(bool local_Input){ResumeMode = local_Input;}
+	/// \brief Get flag of resumable unpacking
+	bool GetResume(){return ResumeMode;}
+	/// \brief Set mode of skipping unchanged output files (IncrementalMode)
+	void SetIncremental(cnv::dword local_Input){Incremental = local_Input;}
+	/// \brief Get mode of skipping unchanged output files
+	cnv::dword GetIncremental(){return Incremental;}
+	/// \brief Get amount of file-entries skipped by the last unpacking
+	cnv::unsint GetAmountSkipped(){return AmountSkipped;}
+	/// \brief Set hook called with path of every file-entry read from the archive (empty function - no tracing)
+	void SetTraceHook(std::function<void(const std::string&)> local_Input){TraceHook = local_Input;}
 	/// \brief Get archive path
 	std::string GetArchivePath(){return ArchivePath;}
+	/// \brief Get path of nested archive inside the outermost archive with trailing separator (empty for archive file)
+	std::string GetNestedPath(){return NestedPath;}
+	/// \brief Get amount of lines of nested archives report
+	cnv::unsint GetAmountNestedReport(){return NestedReport.size();}
+	/// \brief Get line of nested archives report
+	std::string GetNestedReportLine(cnv::unsint i){return NestedReport.at(i);}
+	/// \brief Get nesting level of the archive (0 - archive file)
+	cnv::dword GetDepth(){return Depth;}
 	/// \brief Get amount of table of contents entries
 	cnv::dword GetAmountEntries(){return AmountEntries;}
 	/// \brief Get file size
-	cnv::dword GetFileSize(){return FileSize;}
+	cnv::qword GetFileSize(){return FileSize;}
+	/// \brief Get container variant of the archive
+	cnv::dword GetFormat(){return Format;}
 	/// \brief Get offset of file-entry in the archive                              
-	cnv::dword GetDataOffset(cnv::unsint i){return TOCList.at(i).DataOffset;}
+	cnv::qword GetDataOffset(cnv::unsint i){return TOCList.at(i).DataOffset;}
 	/// \brief Get compression size of file-entry in the archive                                
-	cnv::dword GetCompressSize(cnv::unsint i){return TOCList.at(i).CompressSize;}
+	cnv::qword GetCompressSize(cnv::unsint i){return TOCList.at(i).CompressSize;}
 	/// \brief Get decompression size of file-entry in the archive                  
-	cnv::dword GetUncompressSize(cnv::unsint i){return TOCList.at(i).UncompressSize;}
+	cnv::qword GetUncompressSize(cnv::unsint i){return TOCList.at(i).UncompressSize;}
 	/// \brief Get compression flag of file-entry in the archive
 	cnv::dword GetCompressFlag(cnv::unsint i){return TOCList.at(i).CompressFlag;}
+	/// \brief Get flags of file-entry in the archive
+	cnv::dword GetFlags(cnv::unsint i){return TOCList.at(i).Flags;}
+	/// \brief Get size of shared dictionary of the archive (0 - archive without dictionary)
+	cnv::dword GetDictionarySize(){return SharedDictionary.Data.size();}
+	/// \brief Get offset of shared dictionary in the archive
+	cnv::qword GetDictionaryOffset(){return DictionaryOffset;}
+	/// \brief Get data of shared dictionary of the archive
+	const std::vector<cnv::byte>& GetDictionaryData(){return SharedDictionary.Data;}
 	/// \brief Get path of file-entry in the archive
 	std::string GetPath(cnv::unsint i){return TOCList.at(i).Path;}
 
 	private:
 	void Clear();
+	int ReadHead();
+	int OpenSource();
+	void CloseSource();
+	/// \brief Get stream of the archive (file stream or stream of nested archive in memory)
+	std::istream& Source(){return (Depth == 0) ? static_cast<std::istream&>(OpenArchive) : ImageStream;}
+	std::string GetJournalPath();
+	int ReadEntry(cnv::unsint);
+	int ReadExtendedHead();
+	int ReadDictionary(cnv::qword, cnv::dword);
+	int ReadData(std::istream&, cnv::unsint, cnv::byte*, cnv::qword, std::vector<cnv::byte>&);
+	void PutRecord(std::ostream&, cnv::unsint, cnv::qword);
+	int Decompress(cnv::unsint, cnv::byte*, cnv::qword, cnv::byte*);
+	int SelectDictionary(cnv::unsint, const lzc::Dictionary*&);
+	void TraceAccess(cnv::unsint);
+	int ExtractEntry(cnv::unsint, bool, bool&);
+	int DecodeBuffer(cnv::unsint, cnv::byte*);
+	bool ReserveBuffers(cnv::qword, cnv::qword);
+	int StreamEntry(cnv::unsint, const cnv::byte*);
+	int FillWindow(const std::vector<cnv::unsint>&, cnv::unsint);
+	bool IsUnpacked(cnv::unsint, cnv::qword, bool&);
+	int CompareEntry(cnv::unsint, const std::string&, const cnv::byte*, bool&);
+	int OpenJournal(std::vector<cnv::qword>&);
+	int WriteJournal(cnv::unsint, cnv::qword);
+	int SyncJournal();
+	void CloseJournal(bool);
 };
 
-int DwordRead(ifstream&, std::vector<cnv::dword>&, cnv::unsint);
-int DwordRead(ifstream&, cnv::dword&);
-int StreamRead(ifstream&, char*, int);
+bool IsArchiveHead(const std::vector<cnv::byte>&, cnv::qword);
+int DwordRead(std::istream&, std::vector<cnv::dword>&, cnv::unsint);
+int DwordRead(std::istream&, cnv::dword&);
+int QwordRead(std::istream&, cnv::qword&);
+int StreamRead(std::istream&, char*, cnv::qword);
+int StreamCopy(std::istream&, ofstream&, cnv::qword);
+long SerialCompress(unsigned char*, unsigned char*, unsigned long);
+long SerialDecompress(unsigned char*, unsigned char*, unsigned long);
+std::string GetEditJournalPath(const std::string&);
+int ClearEditJournal(const std::string&);
+void PutBytes(std::ostream&, cnv::qword, cnv::unsint);
+void PutArchiveHead(std::ostream&, cnv::dword, cnv::dword, cnv::qword, cnv::qword, cnv::dword);
+void PutArchiveRecord(std::ostream&, cnv::dword, cnv::qword, cnv::qword, cnv::qword, cnv::dword, const std::string&);
+cnv::dword GetAlignGap(cnv::qword, cnv::dword, bool, cnv::dword);
 #endif
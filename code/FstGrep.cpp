@@ -0,0 +1,242 @@
+/// \file
+/// \brief Fst content search module
+/// \author SpinelDusk
+/// \details Searching text in contents of file-entries of FST file without unpacking it to disk
+
+#pragma GCC diagnostic ignored "-Wc++98-compat"					//Disable warning: 'nullptr' is incompatible with C++98
+#pragma GCC diagnostic ignored "-Wdisabled-macro-expansion"		//Disable warning: Disabled expansion of recursive macro
+#pragma GCC diagnostic ignored "-Wlanguage-extension-token"		//Disable warning: Extension used
+
+#pragma package(smart_init)//Ensures that packaged units are initialized in the order determined by their dependencies
+
+#include "FstGrep.h"
+
+/// \brief Macro makes it easy to write SendAlert function in the code
+#define SendAlert(a,b) SendAlert(__FILE__,__FUNCSIG__,__LINE__,a,3,b)
+
+/// \brief Maximum length of line shown with the occurrence (characters on each side of the occurrence)
+const cnv::unsint LineReach = 60;
+/// \brief Maximum length of text searched by regular expression at once (longer lines are searched by parts)
+const cnv::unsint ExpressionReach = 1024*64;//64 KB
+
+/// \brief Clearing instance fields (search instance)
+void FstGrep::Clear()
+{
+	MatchList.erase(MatchList.begin(), MatchList.end());
+	Expression.reset();
+	AmountSearched = 0;
+	AmountMatched = 0;
+	SearchedSize = 0;
+	AmountBinary = 0;
+	FailReport.erase(FailReport.begin(), FailReport.end());
+}
+/// \brief Searching text in all file-entries of the archive whose paths match the mask
+/// \param[in] local_Input Path to the archive
+/// \param[in] local_Pattern Searched text (plain text or regular expression, see SetRegex)
+/// \param[in] local_Mask Pattern of paths of searched file-entries ('*' and '?', empty - all file-entries)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details File-entries are decoded on worker threads in order of their data in the archive (each worker uses its
+/// own file stream and buffer). File-entries whose paths don't match the mask are not decoded. File-entry which can't
+/// be decoded is listed in FailReport, occurrences in other file-entries are kept
+int FstGrep::Search(char* local_Input, std::string local_Pattern, std::string local_Mask)
+{
+	//Clearing the instance fields
+	Clear();
+	Pattern = local_Pattern;
+	PathMask = local_Mask;
+
+	if(Pattern.empty())
+	{
+		SendAlert(62, nullptr);//Search pattern is empty or is not valid regular expression.
+		return 1;
+	}
+	if(RegexMode && Compile())
+		return 1;
+
+	if(Archive.Load(local_Input))
+		return 1;
+
+	//Searched file-entries ordered by data offset, so the archive is read forward
+	std::vector<cnv::unsint> Order;
+	for(cnv::unsint i = 0; i < Archive.GetAmountEntries(); i++)
+	{
+		if(Archive.GetCompressFlag(i) == CF_EMPTY || Archive.GetUncompressSize(i) == 0)
+			continue;
+		if(!PathMask.empty() && !chf::MatchPattern(Archive.GetPath(i), PathMask))
+			continue;
+		Order.push_back(i);
+		SearchedSize += Archive.GetUncompressSize(i);
+	}
+	std::stable_sort(Order.begin(), Order.end(), [this](cnv::unsint First, cnv::unsint Second)
+	{
+		return Archive.GetDataOffset(First) < Archive.GetDataOffset(Second);
+	});
+	AmountSearched = Order.size();
+
+	std::vector<ifstream> Streams(chf::GetWorkerCount());
+	std::vector<std::vector<cnv::byte>> Buffers(chf::GetWorkerCount());
+	std::vector<std::vector<Match>> Found(Order.size());
+	std::vector<cnv::unsint> FailedError(Order.size(), 0);
+	std::vector<cnv::byte> Binary(Order.size(), 0);
+	chf::ParallelFor(Order.size(), [&](cnv::unsint k, cnv::unsint w)
+	{
+		cnv::unsint i = Order.at(k);
+		ErrorEntry EntryMark(i);
+		ifstream& Stream = Streams.at(w);
+		if(!Stream.is_open())
+			Stream.open(Archive.GetArchivePath(), ios::in|ios::binary);
+
+		//Uncompressed data and compressed data read for decoding
+		chf::MemoryLease Lease(Archive.GetUncompressSize(i) + Archive.GetCompressSize(i));
+		std::vector<cnv::byte>& Buffer = Buffers.at(w);
+		if(Archive.DecodeEntry(Stream, i, Buffer))
+		{
+			FailedError.at(k) = GetThreadError().ErrorIndex;
+			Stream.close();//Stream state is restored for the next file-entry
+		}
+		else if(RegexMode && !lzc::IsText(Buffer.data(), Buffer.size()))
+			Binary.at(k) = 1;
+		else if(RegexMode && SearchExpression(Buffer.data(), Buffer.size(), i, Found.at(k)))
+			FailedError.at(k) = GetThreadError().ErrorIndex;
+		else
+			SearchText(Buffer.data(), Buffer.size(), i, Found.at(k));
+
+		//With memory budget the buffer is not kept after its lease is released
+		if(chf::GetMemoryLimit() != 0)
+			std::vector<cnv::byte>().swap(Buffer);
+	});
+	for(cnv::unsint k = 0; k < Order.size(); k++)
+	{
+		if(FailedError.at(k) != 0)
+			FailReport.push_back(((FailedError.at(k) == 74) ? "Unsearched: " : "Not read  : ") + Archive.GetPath(Order.at(k)) + " (error " + INTtoSTRING(static_cast<int>(FailedError.at(k))) + ")");
+		AmountBinary += Binary.at(k);
+	}
+	if(!FailReport.empty())
+		ClearError();
+
+	//Occurrences in order of table of contents
+	std::vector<cnv::unsint> Position(Order.size());
+	for(cnv::unsint k = 0; k < Order.size(); k++)
+		Position.at(k) = k;
+	std::sort(Position.begin(), Position.end(), [&Order](cnv::unsint First, cnv::unsint Second)
+	{
+		return Order.at(First) < Order.at(Second);
+	});
+	for(cnv::unsint k : Position)
+	{
+		if(Found.at(k).empty())
+			continue;
+		MatchList.insert(MatchList.end(), std::make_move_iterator(Found.at(k).begin()), std::make_move_iterator(Found.at(k).end()));
+		AmountMatched++;
+	}
+	return 0;
+}
+/// \brief Compiling regular expression
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstGrep::Compile()
+{
+	try
+	{
+		Expression.reset(new std::regex(Pattern, std::regex::ECMAScript|std::regex::optimize));
+	}
+	catch(const std::regex_error&)
+	{
+		SendAlert(62, Pattern);//Search pattern is empty or is not valid regular expression.
+		return 1;
+	}
+	return 0;
+}
+/// \brief Searching plain text in uncompressed data of file-entry
+/// \param[in] Data Uncompressed data
+/// \param[in] Size Size of data
+/// \param[in] Entry Ordinal number of file-entry
+/// \param[out] Output Occurrences (appended)
+/// \details Candidates are found by the first byte of the text with memchr (vectorized by the runtime library) and
+/// checked with memcmp. Occurrences don't overlap
+void FstGrep::SearchText(const cnv::byte* Data, cnv::qword Size, cnv::dword Entry, std::vector<Match>& Output)
+{
+	const cnv::byte* Text = reinterpret_cast<const cnv::byte*>(Pattern.data());
+	cnv::qword Length = Pattern.size();
+	cnv::qword Offset = 0;
+	while(Offset + Length <= Size)
+	{
+		const void* Candidate = memchr(Data + Offset, Text[0], Size - Length - Offset + 1);
+		if(Candidate == nullptr)
+			break;
+		Offset = static_cast<const cnv::byte*>(Candidate) - Data;
+		if(memcmp(Data + Offset, Text, Length) == 0)
+		{
+			Output.push_back({Entry, Offset, GetLine(Data, Size, Offset)});
+			Offset += Length;
+		}
+		else
+		{
+			Offset++;
+		}
+	}
+}
+/// \brief Searching regular expression in uncompressed data of file-entry
+/// \param[in] Data Uncompressed data
+/// \param[in] Size Size of data
+/// \param[in] Entry Ordinal number of file-entry
+/// \param[out] Output Occurrences (appended)
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Data is searched line by line (as by grep), so occurrence can't span several lines. Lines longer than
+/// ExpressionReach are searched by parts of this length (occurrence can't span several parts), so time and stack
+/// of the regular expression engine are bounded. Empty occurrences are not reported. If the engine gives up
+/// (complexity or stack limit), occurrences found before are kept and the error is reported
+int FstGrep::SearchExpression(const cnv::byte* Data, cnv::qword Size, cnv::dword Entry, std::vector<Match>& Output)
+{
+	const char* Begin = reinterpret_cast<const char*>(Data);
+	const char* End = Begin + Size;
+	const char* Line = Begin;
+	while(Line < End)
+	{
+		const char* LineEnd = static_cast<const char*>(memchr(Line, '\n', End - Line));
+		if(LineEnd == nullptr)
+			LineEnd = End;
+		for(const char* Part = Line; Part < LineEnd; Part += ExpressionReach)
+		{
+			const char* PartEnd = (static_cast<cnv::qword>(LineEnd - Part) > ExpressionReach) ? Part + ExpressionReach : LineEnd;
+			try
+			{
+				for(std::cregex_iterator Item(Part, PartEnd, *Expression), Last; Item != Last; ++Item)
+				{
+					if(Item->length() == 0)
+						continue;
+					cnv::qword Offset = Item->position() + (Part - Begin);
+					Output.push_back({Entry, Offset, GetLine(Data, Size, Offset)});
+				}
+			}
+			catch(const std::regex_error&)
+			{
+				SendAlert(74, Archive.GetPath(Entry));//Regular expression is too complex for data of file-entry.
+				return 1;
+			}
+		}
+		Line = LineEnd + 1;
+	}
+	return 0;
+}
+/// \brief Getting line containing the occurrence for output
+/// \param[in] Data Uncompressed data
+/// \param[in] Size Size of data
+/// \param[in] Offset Offset of the occurrence
+/// \return Part of the line around the occurrence (at most LineReach characters on each side), unprintable
+/// characters are replaced by '.'
+std::string FstGrep::GetLine(const cnv::byte* Data, cnv::qword Size, cnv::qword Offset)
+{
+	cnv::qword First = Offset;
+	while(First > 0 && Offset - First < LineReach && Data[First - 1] != '\n' && Data[First - 1] != '\r')
+		First--;
+	cnv::qword Last = Offset;
+	while(Last < Size && Last - Offset < LineReach && Data[Last] != '\n' && Data[Last] != '\r')
+		Last++;
+	std::string Line(reinterpret_cast<const char*>(Data) + First, Last - First);
+	for(char& Symbol : Line)
+	{
+		if(static_cast<cnv::byte>(Symbol) < 0x20 || Symbol == 0x7F)
+			Symbol = '.';
+	}
+	return Line;
+}
@@ -0,0 +1,115 @@
+/// \file
+/// \brief Fst content search module (Header)
+/// \author SpinelDusk
+
+#pragma GCC diagnostic ignored "-Wpadded"						//Disable warning: Padding class -- with -- byte to align --
+
+#pragma once//This header guard directive designed to cause the current source file to be included only once in a single compilation
+#ifndef FstGrepH
+#define FstGrepH
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <regex>
+#include <memory>
+#include <cstring>
+#pragma hdrstop//This directive terminates the list of header files eligible for precompilation (Using ONLY for <standard> headers, no "custom")
+
+#include "FstFile.h"
+
+/// \brief The class contains data and functions necessary for searching text in contents of file-entries of FST file
+/// \details File-entries are decoded in memory on worker threads (each worker reuses its own buffer), nothing is
+/// written to disk. Text is searched as plain sequence of bytes or as regular expression (line by line, text
+/// file-entries only)
+class FstGrep
+{
+	private:
+	/// \brief Single occurrence of the text
+	struct Match
+	{
+		/// \brief Ordinal number of file-entry
+		cnv::dword Entry;
+		/// \brief Offset of the occurrence in uncompressed data of file-entry
+		cnv::qword Offset;
+		/// \brief Line containing the occurrence (cut and with unprintable characters replaced)
+		std::string Line;
+	};
+	/// \brief Occurrences in all searched file-entries (ordered by file-entry and offset)
+	std::vector<Match> MatchList;
+	/// \brief Searched text (plain text or regular expression)
+	std::string Pattern;
+	/// \brief Pattern of paths of searched file-entries (empty - all file-entries)
+	std::string PathMask;
+	/// \brief Search mode: 0 - plain text, 1 - regular expression
+	cnv::unsint RegexMode;
+	/// \brief Compiled regular expression (regex mode only)
+	std::unique_ptr<std::regex> Expression;
+	/// \brief Amount of file-entries decoded and searched
+	cnv::unsint AmountSearched;
+	/// \brief Amount of file-entries with at least one occurrence
+	cnv::unsint AmountMatched;
+	/// \brief Total uncompressed size of searched file-entries
+	cnv::qword SearchedSize;
+	/// \brief Amount of binary file-entries which were not searched by regular expression
+	cnv::unsint AmountBinary;
+	/// \brief File-entries which couldn't be decoded (their occurrences are missing from the results)
+	std::vector<std::string> FailReport;
+	/// \brief Searched archive
+	FstUnpack Archive;
+
+	public:
+	FstGrep()
+	{
+		RegexMode = 0;
+		AmountSearched = 0;
+		AmountMatched = 0;
+		SearchedSize = 0;
+		AmountBinary = 0;
+	}
+	~FstGrep()
+	{
+
+	}
+
+	int Search(char*, std::string, std::string);
+
+	/// \brief Set search mode
+	/// \param[in] local_Input True - pattern is regular expression (ECMAScript), False - plain text
+	void SetRegex(bool local_Input){RegexMode = local_Input ? 1 : 0;}
+	/// \brief Get archive path
+	std::string GetArchivePath(){return Archive.GetArchivePath();}
+	/// \brief Get amount of table of contents entries
+	cnv::dword GetAmountEntries(){return Archive.GetAmountEntries();}
+	/// \brief Get amount of file-entries decoded and searched
+	cnv::unsint GetAmountSearched(){return AmountSearched;}
+	/// \brief Get amount of file-entries with at least one occurrence
+	cnv::unsint GetAmountMatched(){return AmountMatched;}
+	/// \brief Get total uncompressed size of searched file-entries
+	cnv::qword GetSearchedSize(){return SearchedSize;}
+	/// \brief Get amount of binary file-entries which were not searched by regular expression
+	cnv::unsint GetAmountBinary(){return AmountBinary;}
+	/// \brief Get amount of file-entries which couldn't be decoded
+	cnv::unsint GetAmountReport(){return FailReport.size();}
+	/// \brief Get line of report about file-entry which couldn't be decoded
+	std::string GetReportLine(cnv::unsint i){return FailReport.at(i);}
+	/// \brief Get amount of occurrences
+	cnv::dword GetAmountMatches(){return MatchList.size();}
+	/// \brief Get path of file-entry containing the occurrence
+	std::string GetMatchPath(cnv::unsint i){return Archive.GetPath(MatchList.at(i).Entry);}
+	/// \brief Get ordinal number of file-entry containing the occurrence
+	cnv::dword GetMatchEntry(cnv::unsint i){return MatchList.at(i).Entry;}
+	/// \brief Get offset of the occurrence in uncompressed data of file-entry
+	cnv::qword GetMatchOffset(cnv::unsint i){return MatchList.at(i).Offset;}
+	/// \brief Get line containing the occurrence
+	std::string GetMatchLine(cnv::unsint i){return MatchList.at(i).Line;}
+
+	private:
+	void Clear();
+	int Compile();
+	void SearchText(const cnv::byte*, cnv::qword, cnv::dword, std::vector<Match>&);
+	int SearchExpression(const cnv::byte*, cnv::qword, cnv::dword, std::vector<Match>&);
+	static std::string GetLine(const cnv::byte*, cnv::qword, cnv::qword);
+};
+#endif
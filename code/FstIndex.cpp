@@ -0,0 +1,577 @@
+/// \file
+/// \brief Fst path index module
+/// \author SpinelDusk
+/// \details Persistent index of paths of file-entries of many FST files with prefix, wildcard and substring queries
+
+#pragma GCC diagnostic ignored "-Wc++98-compat"					//Disable warning: 'nullptr' is incompatible with C++98
+#pragma GCC diagnostic ignored "-Wdisabled-macro-expansion"		//Disable warning: Disabled expansion of recursive macro
+#pragma GCC diagnostic ignored "-Wlanguage-extension-token"		//Disable warning: Extension used
+
+#pragma package(smart_init)//Ensures that packaged units are initialized in the order determined by their dependencies
+
+#include "FstIndex.h"
+
+/// \brief Macro makes it easy to write SendAlert function in the code
+#define SendAlert(a,b) SendAlert(__FILE__,__FUNCSIG__,__LINE__,a,3,b)
+
+/// \brief Signature of index file
+const char IndexSignature[4] = {'F', 'S', 'T', 'I'};
+/// \brief Version of index format
+const cnv::dword IndexVersion = 1;
+
+/// \brief Clearing instance fields (index instance)
+void FstIndex::Clear()
+{
+	RootPath.erase(RootPath.begin(), RootPath.end());
+	IndexPath.erase(IndexPath.begin(), IndexPath.end());
+	ArchiveList.erase(ArchiveList.begin(), ArchiveList.end());
+	RecordList.erase(RecordList.begin(), RecordList.end());
+	KeyList.erase(KeyList.begin(), KeyList.end());
+	GramList.erase(GramList.begin(), GramList.end());
+	PostingList.erase(PostingList.begin(), PostingList.end());
+	FoundList.erase(FoundList.begin(), FoundList.end());
+	SkipReport.erase(SkipReport.begin(), SkipReport.end());
+	AmountRead = 0;
+	AmountReused = 0;
+	AmountRemoved = 0;
+	IndexSize = 0;
+	Duration = 0;
+}
+/// \brief Building index of all archives under the root directory (or updating the existing index)
+/// \param[in] local_Input Path to the root directory
+/// \param[in] local_Output Path to the index file
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Archives are found by extension '.fst'. If the index file exists and was built for the same root directory,
+/// archives with unchanged size and time of last write are taken from it, only new and changed archives are read.
+/// Archives which can't be read are skipped and listed in the report
+int FstIndex::Build(char* local_Input, char* local_Output)
+{
+	EVENT_SCOPE(Event, "Build index", evt::NoArg);
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+
+	//Clearing the instance fields
+	Clear();
+	RootPath = local_Input;
+	while(RootPath.size() > 1 && chf::IsSeparator(RootPath.at(RootPath.size() - 1)))
+		RootPath.resize(RootPath.size() - 1);
+	IndexPath = local_Output;
+
+	//Previous index (damaged index or index of another root directory is built again from scratch)
+	FstIndex Previous;
+	cnv::qword Size = 0;
+	if(chf::GetFileStat(IndexPath, Size))
+	{
+		if(Previous.Load(local_Output) || GetKey(Previous.RootPath) != GetKey(RootPath))
+			Previous.Clear();
+		ClearError();
+	}
+
+	//Archives under the root directory (ordered by path)
+	FindArchives("", ArchiveList);
+	if(ArchiveList.empty())
+	{
+		SendAlert(8, RootPath);//No entries were received.
+		return 1;
+	}
+	std::sort(ArchiveList.begin(), ArchiveList.end(), [](const Archive& a, const Archive& b)
+	{
+		return GetKey(a.Path) < GetKey(b.Path);
+	});
+	ReadArchives(Previous);
+
+	//Table of paths ordered by comparable path and its trigrams
+	std::vector<std::string> Keys(RecordList.size());
+	std::vector<cnv::unsint> Order(RecordList.size());
+	for(cnv::unsint i = 0; i < RecordList.size(); i++)
+	{
+		Keys.at(i) = GetKey(RecordList.at(i).Path);
+		Order.at(i) = i;
+	}
+	std::stable_sort(Order.begin(), Order.end(), [&Keys](cnv::unsint a, cnv::unsint b)
+	{
+		return Keys.at(a) < Keys.at(b);
+	});
+	std::vector<Record> Sorted;
+	Sorted.reserve(RecordList.size());
+	KeyList.reserve(RecordList.size());
+	for(cnv::unsint i = 0; i < Order.size(); i++)
+	{
+		Sorted.push_back(RecordList.at(Order.at(i)));
+		KeyList.push_back(Keys.at(Order.at(i)));
+	}
+	RecordList.swap(Sorted);
+	BuildGrams();
+	if(Write())
+		return 1;
+	Duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	return 0;
+}
+/// \brief Finding archives in directory and its subdirectories
+/// \param[in] local_Input Path of directory relative to the root (empty or with trailing separator)
+/// \param[out] local_Output Found archives (sizes and times of last write are taken from the directory)
+/// \details Directories which are reparse points are listed in SkipReport and not searched
+void FstIndex::FindArchives(std::string local_Input, std::vector<Archive>& local_Output)
+{
+	WIN32_FIND_DATAA Data;
+	std::string Mask = RootPath + "\\" + local_Input + "*";
+	HANDLE Search = FindFirstFileA(Mask.data(), &Data);
+	if(Search == INVALID_HANDLE_VALUE)
+		return;
+	std::vector<std::string> Directories;
+	do
+	{
+		std::string Name = Data.cFileName;
+		if(Name == "." || Name == "..")
+			continue;
+		//Junctions and symbolic links to directories are not followed (they may form a loop or leave the root)
+		if((Data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && (Data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+		{
+			SkipReport.push_back("Link      : " + local_Input + Name);
+			continue;
+		}
+		if(Data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			Directories.push_back(local_Input + Name + "\\");
+			continue;
+		}
+		std::string Key = GetKey(Name);
+		if(Key.size() < 5 || Key.compare(Key.size() - 4, 4, ".fst") != 0)
+			continue;
+		Archive Item;
+		Item.Path = local_Input + Name;
+		Item.Size = (static_cast<cnv::qword>(Data.nFileSizeHigh) << 32) | Data.nFileSizeLow;
+		Item.Time = (static_cast<cnv::qword>(Data.ftLastWriteTime.dwHighDateTime) << 32) | Data.ftLastWriteTime.dwLowDateTime;
+		Item.AmountEntries = 0;
+		local_Output.push_back(Item);
+	}
+	while(FindNextFileA(Search, &Data));
+	FindClose(Search);
+	for(cnv::unsint i = 0; i < Directories.size(); i++)
+		FindArchives(Directories.at(i), local_Output);
+}
+/// \brief Filling table of paths from the previous index (unchanged archives) and from tables of contents (other archives)
+/// \param[in] Previous Previous index (empty - all archives are read)
+/// \details Tables of contents are read on worker threads, each worker loads its own archive
+void FstIndex::ReadArchives(FstIndex& Previous)
+{
+	//Paths of the previous index grouped by archive
+	std::map<std::string, cnv::unsint> Known;
+	for(cnv::unsint j = 0; j < Previous.ArchiveList.size(); j++)
+		Known[GetKey(Previous.ArchiveList.at(j).Path)] = j;
+	std::vector<std::vector<cnv::unsint>> PreviousRecords(Previous.ArchiveList.size());
+	for(cnv::unsint r = 0; r < Previous.RecordList.size(); r++)
+		PreviousRecords.at(Previous.RecordList.at(r).Archive).push_back(r);
+
+	//Unchanged archives are taken from the previous index
+	std::vector<cnv::unsint> Pending;
+	AmountRemoved = Previous.ArchiveList.size();
+	for(cnv::unsint i = 0; i < ArchiveList.size(); i++)
+	{
+		Archive& Item = ArchiveList.at(i);
+		std::map<std::string, cnv::unsint>::iterator Found = Known.find(GetKey(Item.Path));
+		if(Found != Known.end())
+		{
+			AmountRemoved--;
+			const Archive& Old = Previous.ArchiveList.at(Found->second);
+			if(Old.Size == Item.Size && Old.Time == Item.Time)
+			{
+				Item.AmountEntries = Old.AmountEntries;
+				for(cnv::unsint r : PreviousRecords.at(Found->second))
+				{
+					RecordList.push_back(Previous.RecordList.at(r));
+					RecordList.back().Archive = i;
+				}
+				AmountReused++;
+				continue;
+			}
+		}
+		Pending.push_back(i);
+	}
+
+	//New and changed archives are read on worker threads
+	std::vector<std::vector<Record>> Received(Pending.size());
+	std::vector<cnv::byte> Failed(Pending.size(), 0);
+	std::vector<cnv::unsint> FailedError(Pending.size(), 0);
+	chf::ParallelFor(Pending.size(), [&](cnv::unsint k, cnv::unsint)
+	{
+		FstUnpack Reader;
+		std::string Path = RootPath + "\\" + ArchiveList.at(Pending.at(k)).Path;
+		if(Reader.Load(&Path[0]))
+		{
+			Failed.at(k) = 1;
+			FailedError.at(k) = GetThreadError().ErrorIndex;
+			return;
+		}
+		Received.at(k).reserve(Reader.GetAmountEntries());
+		for(cnv::unsint i = 0; i < Reader.GetAmountEntries(); i++)
+			Received.at(k).push_back({Reader.GetPath(i), static_cast<cnv::dword>(Pending.at(k)), static_cast<cnv::dword>(i), Reader.GetUncompressSize(i)});
+	});
+	for(cnv::unsint k = 0; k < Pending.size(); k++)
+	{
+		if(Failed.at(k) != 0)
+		{
+			SkipReport.push_back("Not read  : " + ArchiveList.at(Pending.at(k)).Path + " (error " + INTtoSTRING(static_cast<int>(FailedError.at(k))) + ")");
+			continue;
+		}
+		ArchiveList.at(Pending.at(k)).AmountEntries = Received.at(k).size();
+		RecordList.insert(RecordList.end(), Received.at(k).begin(), Received.at(k).end());
+		AmountRead++;
+	}
+	if(std::find(Failed.begin(), Failed.end(), 1) == Failed.end())
+		return;
+	ClearError();
+
+	//Archives which couldn't be read are not kept, so the next build tries them again
+	std::vector<cnv::dword> Remap(ArchiveList.size(), 0);
+	cnv::unsint Kept = 0;
+	for(cnv::unsint k = 0, i = 0; i < ArchiveList.size(); i++)
+	{
+		if(k < Pending.size() && Pending.at(k) == i && Failed.at(k++) != 0)
+			continue;
+		Remap.at(i) = Kept;
+		ArchiveList.at(Kept++) = ArchiveList.at(i);
+	}
+	ArchiveList.resize(Kept);
+	for(cnv::unsint r = 0; r < RecordList.size(); r++)
+		RecordList.at(r).Archive = Remap.at(RecordList.at(r).Archive);
+}
+/// \brief Building lists of paths containing every trigram of comparable paths
+void FstIndex::BuildGrams()
+{
+	std::vector<std::pair<cnv::dword, cnv::dword>> Pairs;
+	for(cnv::unsint i = 0; i < KeyList.size(); i++)
+	{
+		const std::string& Key = KeyList.at(i);
+		for(cnv::unsint j = 0; j + 3 <= Key.size(); j++)
+		{
+			cnv::dword Gram = (static_cast<cnv::dword>(static_cast<cnv::byte>(Key.at(j))) << 16) |
+				(static_cast<cnv::dword>(static_cast<cnv::byte>(Key.at(j + 1))) << 8) | static_cast<cnv::byte>(Key.at(j + 2));
+			Pairs.push_back({Gram, i});
+		}
+	}
+	std::sort(Pairs.begin(), Pairs.end());
+	Pairs.erase(std::unique(Pairs.begin(), Pairs.end()), Pairs.end());
+	PostingList.reserve(Pairs.size());
+	for(cnv::unsint i = 0; i < Pairs.size(); i++)
+	{
+		if(GramList.empty() || GramList.back().Key != Pairs.at(i).first)
+			GramList.push_back({Pairs.at(i).first, static_cast<cnv::dword>(PostingList.size()), 0});
+		GramList.back().Amount++;
+		PostingList.push_back(Pairs.at(i).second);
+	}
+}
+/// \brief Writing the index file
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Paths are front-coded (length of prefix shared with the previous path and the rest of the path),
+/// lists of trigrams are stored as differences between neighbouring ordinal numbers (7 bits per byte)
+int FstIndex::Write()
+{
+	std::vector<cnv::byte> Data(IndexSignature, IndexSignature + 4);
+	chf::PutDword(Data, IndexVersion);
+	chf::PutDword(Data, RootPath.size());
+	Data.insert(Data.end(), RootPath.begin(), RootPath.end());
+
+	chf::PutDword(Data, ArchiveList.size());
+	for(cnv::unsint i = 0; i < ArchiveList.size(); i++)
+	{
+		const Archive& Item = ArchiveList.at(i);
+		chf::PutDword(Data, Item.Path.size());
+		Data.insert(Data.end(), Item.Path.begin(), Item.Path.end());
+		chf::PutQword(Data, Item.Size);
+		chf::PutQword(Data, Item.Time);
+		chf::PutDword(Data, Item.AmountEntries);
+	}
+
+	chf::PutDword(Data, RecordList.size());
+	const std::string* Last = nullptr;
+	for(cnv::unsint i = 0; i < RecordList.size(); i++)
+	{
+		const Record& Item = RecordList.at(i);
+		cnv::unsint Shared = 0;
+		while(Last != nullptr && Shared < Last->size() && Shared < Item.Path.size() && Shared < 0xFFFF && Last->at(Shared) == Item.Path.at(Shared))
+			Shared++;
+		cnv::unsint Rest = Item.Path.size() - Shared;
+		Data.push_back(static_cast<cnv::byte>(Shared));
+		Data.push_back(static_cast<cnv::byte>(Shared >> 8));
+		Data.push_back(static_cast<cnv::byte>(Rest));
+		Data.push_back(static_cast<cnv::byte>(Rest >> 8));
+		Data.insert(Data.end(), Item.Path.begin() + Shared, Item.Path.end());
+		chf::PutDword(Data, Item.Archive);
+		chf::PutDword(Data, Item.Entry);
+		chf::PutQword(Data, Item.Size);
+		Last = &Item.Path;
+	}
+
+	chf::PutDword(Data, GramList.size());
+	for(cnv::unsint i = 0; i < GramList.size(); i++)
+	{
+		chf::PutDword(Data, GramList.at(i).Key);
+		chf::PutDword(Data, GramList.at(i).Amount);
+		cnv::dword Previous = 0;
+		for(cnv::unsint j = GramList.at(i).First; j < GramList.at(i).First + GramList.at(i).Amount; j++)
+		{
+			cnv::dword Delta = PostingList.at(j) - Previous;
+			Previous = PostingList.at(j);
+			while(Delta >= 0x80)
+			{
+				Data.push_back(static_cast<cnv::byte>(Delta | 0x80));
+				Delta >>= 7;
+			}
+			Data.push_back(static_cast<cnv::byte>(Delta));
+		}
+	}
+
+	ofstream IndexFile(IndexPath, ios::out|ios::binary);
+	if(!IndexFile.is_open())
+	{
+		SendAlert(39, IndexPath);//Can't open output file.
+		return 1;
+	}
+	IndexFile.write(reinterpret_cast<const char*>(Data.data()), Data.size());
+	IndexFile.close();
+	if(!IndexFile.good())
+	{
+		SendAlert(39, IndexPath);//Can't open output file.
+		return 1;
+	}
+	IndexSize = Data.size();
+	return 0;
+}
+/// \brief Loading the index file
+/// \param[in] local_Input Path to the index file
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstIndex::Load(char* local_Input)
+{
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+
+	//Clearing the instance fields
+	Clear();
+	IndexPath = local_Input;
+	if(Read())
+		return 1;
+	KeyList.reserve(RecordList.size());
+	for(cnv::unsint i = 0; i < RecordList.size(); i++)
+		KeyList.push_back(GetKey(RecordList.at(i).Path));
+	Duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	return 0;
+}
+/// \brief Reading the index file (whole file is read by single request and decoded in memory)
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstIndex::Read()
+{
+	ifstream IndexFile(IndexPath, ios::in|ios::binary);
+	if(!IndexFile.is_open())
+	{
+		SendAlert(60, IndexPath);//Can't open index file.
+		return 1;
+	}
+	IndexSize = chf::GetFileSize(IndexFile);
+	std::vector<cnv::byte> Data(IndexSize);
+	if(StreamRead(IndexFile, reinterpret_cast<char*>(Data.data()), IndexSize))
+		return 1;
+	IndexFile.close();
+
+	//Reading of numbers and strings stops at the end of data (the index is damaged)
+	cnv::qword Position = 0;
+	bool Damaged = false;
+	auto Number = [&](cnv::unsint Size) -> cnv::qword
+	{
+		cnv::qword local_Output = 0;
+		if(Data.size() - Position < Size)
+		{
+			Damaged = true;
+			return 0;
+		}
+		for(cnv::unsint j = 0; j < Size; j++)
+			local_Output |= static_cast<cnv::qword>(Data.at(Position + j)) << 8 * j;
+		Position += Size;
+		return local_Output;
+	};
+	auto Text = [&](cnv::qword Size, std::string& local_Output)
+	{
+		if(Data.size() - Position < Size)
+		{
+			Damaged = true;
+			return;
+		}
+		local_Output.append(reinterpret_cast<const char*>(Data.data() + Position), Size);
+		Position += Size;
+	};
+
+	if(Data.size() < 8 || memcmp(Data.data(), IndexSignature, 4) != 0)
+	{
+		SendAlert(61, IndexPath);//The file is not a path index of FST archives, has unsupported version or is damaged.
+		return 1;
+	}
+	Position = 4;
+	if(Number(4) != IndexVersion)
+	{
+		SendAlert(61, IndexPath);//The file is not a path index of FST archives, has unsupported version or is damaged.
+		return 1;
+	}
+	Text(Number(4), RootPath);
+
+	cnv::qword Amount = Number(4);
+	for(cnv::qword i = 0; i < Amount && !Damaged; i++)
+	{
+		Archive Item;
+		Text(Number(4), Item.Path);
+		Item.Size = Number(8);
+		Item.Time = Number(8);
+		Item.AmountEntries = static_cast<cnv::dword>(Number(4));
+		ArchiveList.push_back(Item);
+	}
+
+	Amount = Number(4);
+	for(cnv::qword i = 0; i < Amount && !Damaged; i++)
+	{
+		Record Item;
+		cnv::unsint Shared = static_cast<cnv::unsint>(Number(2));
+		cnv::unsint Rest = static_cast<cnv::unsint>(Number(2));
+		if(Shared != 0 && (RecordList.empty() || Shared > RecordList.back().Path.size()))
+		{
+			Damaged = true;
+			break;
+		}
+		if(Shared != 0)
+			Item.Path = RecordList.back().Path.substr(0, Shared);
+		Text(Rest, Item.Path);
+		Item.Archive = static_cast<cnv::dword>(Number(4));
+		Item.Entry = static_cast<cnv::dword>(Number(4));
+		Item.Size = Number(8);
+		if(Item.Archive >= ArchiveList.size())
+			Damaged = true;
+		RecordList.push_back(Item);
+	}
+
+	Amount = Number(4);
+	for(cnv::qword i = 0; i < Amount && !Damaged; i++)
+	{
+		Gram Item;
+		Item.Key = static_cast<cnv::dword>(Number(4));
+		Item.Amount = static_cast<cnv::dword>(Number(4));
+		Item.First = PostingList.size();
+		cnv::dword Previous = 0;
+		for(cnv::dword j = 0; j < Item.Amount && !Damaged; j++)
+		{
+			cnv::dword Delta = 0;
+			for(cnv::unsint Shift = 0; ; Shift += 7)
+			{
+				if(Position >= Data.size() || Shift > 28)
+				{
+					Damaged = true;
+					break;
+				}
+				cnv::byte Next = Data.at(Position++);
+				Delta |= static_cast<cnv::dword>(Next & 0x7F) << Shift;
+				if(!(Next & 0x80))
+					break;
+			}
+			Previous += Delta;
+			if(Previous >= RecordList.size())
+				Damaged = true;
+			PostingList.push_back(Previous);
+		}
+		GramList.push_back(Item);
+	}
+	if(Damaged || Position != Data.size())
+	{
+		SendAlert(61, IndexPath);//The file is not a path index of FST archives, has unsupported version or is damaged.
+		return 1;
+	}
+	return 0;
+}
+/// \brief Finding paths by query
+/// \param[in] local_Input Query: path ending with separator - all paths under it (prefix), path with '*' or '?' - paths
+/// matching the wildcard pattern, other text - paths containing it. Case and kind of slash are not important
+/// \return Error code: 0 - no errors
+/// \details Prefix is found by binary search in the sorted table. Substring (and the longest part of pattern between
+/// wildcards) of three or more characters is looked up in lists of trigrams, so only paths from the shortest list are checked
+int FstIndex::Find(std::string local_Input)
+{
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+	FoundList.erase(FoundList.begin(), FoundList.end());
+	std::string Query = GetKey(local_Input);
+	std::string::size_type Wildcard = Query.find_first_of("*?");
+
+	//Prefix: all paths under the directory, or paths starting with the part of pattern before the first wildcard
+	if((Wildcard == std::string::npos && !Query.empty() && Query.at(Query.size() - 1) == '\\') || (Wildcard != std::string::npos && Wildcard != 0))
+	{
+		std::string Prefix = Query.substr(0, Wildcard);
+		for(std::vector<std::string>::iterator i = std::lower_bound(KeyList.begin(), KeyList.end(), Prefix);
+			i != KeyList.end() && i->compare(0, Prefix.size(), Prefix) == 0; i++)
+		{
+			if(Wildcard == std::string::npos || chf::MatchPattern(*i, Query))
+				FoundList.push_back(static_cast<cnv::dword>(i - KeyList.begin()));
+		}
+		Duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+		return 0;
+	}
+
+	//Substring or the longest part of pattern between wildcards
+	std::string Literal = Query;
+	if(Wildcard != std::string::npos)
+	{
+		Literal.erase(Literal.begin(), Literal.end());
+		std::string::size_type Begin = 0;
+		while(Begin <= Query.size())
+		{
+			std::string::size_type End = Query.find_first_of("*?", Begin);
+			if(End == std::string::npos)
+				End = Query.size();
+			if(End - Begin > Literal.size())
+				Literal = Query.substr(Begin, End - Begin);
+			Begin = End + 1;
+		}
+	}
+	std::vector<cnv::dword> Checked;
+	if(Literal.size() >= 3)
+	{
+		Candidates(Literal, Checked);
+	}
+	else
+	{
+		Checked.resize(KeyList.size());
+		for(cnv::unsint i = 0; i < KeyList.size(); i++)
+			Checked.at(i) = i;
+	}
+	for(cnv::unsint i = 0; i < Checked.size(); i++)
+	{
+		const std::string& Key = KeyList.at(Checked.at(i));
+		if((Wildcard == std::string::npos) ? (Key.find(Query) != std::string::npos) : chf::MatchPattern(Key, Query))
+			FoundList.push_back(Checked.at(i));
+	}
+	Duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	return 0;
+}
+/// \brief Getting paths which may contain the text (the shortest list among its trigrams)
+/// \param[in] local_Input Comparable text of three or more characters
+/// \param[out] local_Output Ordinal numbers of paths (ascending)
+void FstIndex::Candidates(const std::string& local_Input, std::vector<cnv::dword>& local_Output)
+{
+	const Gram* Shortest = nullptr;
+	for(cnv::unsint j = 0; j + 3 <= local_Input.size(); j++)
+	{
+		cnv::dword Key = (static_cast<cnv::dword>(static_cast<cnv::byte>(local_Input.at(j))) << 16) |
+			(static_cast<cnv::dword>(static_cast<cnv::byte>(local_Input.at(j + 1))) << 8) | static_cast<cnv::byte>(local_Input.at(j + 2));
+		std::vector<Gram>::iterator Found = std::lower_bound(GramList.begin(), GramList.end(), Key, [](const Gram& a, cnv::dword b)
+		{
+			return a.Key < b;
+		});
+		if(Found == GramList.end() || Found->Key != Key)
+			return;//No path contains this trigram
+		if(Shortest == nullptr || Found->Amount < Shortest->Amount)
+			Shortest = &*Found;
+	}
+	local_Output.assign(PostingList.begin() + Shortest->First, PostingList.begin() + Shortest->First + Shortest->Amount);
+}
+/// \brief Getting comparable form of path (lower case, backslashes as separators)
+/// \param[in] local_Input Path
+/// \return Comparable path
+std::string FstIndex::GetKey(const std::string& local_Input)
+{
+	std::string local_Output = local_Input;
+	for(cnv::unsint i = 0; i < local_Output.size(); i++)
+		local_Output.at(i) = (local_Output.at(i) == '/') ? '\\' : static_cast<char>(tolower(static_cast<cnv::byte>(local_Output.at(i))));
+	return local_Output;
+}
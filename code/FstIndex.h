@@ -0,0 +1,150 @@
+/// \file
+/// \brief Fst path index module (Header)
+/// \author SpinelDusk
+
+#pragma GCC diagnostic ignored "-Wpadded"						//Disable warning: Padding class -- with -- byte to align --
+
+#pragma once//This header guard directive designed to cause the current source file to be included only once in a single compilation
+#ifndef FstIndexH
+#define FstIndexH
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <map>
+#include <chrono>
+#pragma hdrstop//This directive terminates the list of header files eligible for precompilation (Using ONLY for <standard> headers, no "custom")
+
+#include "FstFile.h"
+
+/// \brief The class contains data and functions necessary for searching paths of file-entries in many FST files
+/// \details Index keeps table of contents of every archive under the root directory: sorted table of paths (front-coded
+/// in the index file) and lists of paths containing every trigram. Archives with the same size and time of last write
+/// are taken from the previous index without reading them
+class FstIndex
+{
+	private:
+	/// \brief Indexed archive
+	struct Archive
+	{
+		/// \brief Path relative to the root directory
+		std::string Path;
+		/// \brief File size in bytes
+		cnv::qword Size;
+		/// \brief Time of last write (FILETIME)
+		cnv::qword Time;
+		/// \brief Amount of entries in the archive
+		cnv::dword AmountEntries;
+	};
+	/// \brief Path of file-entry
+	struct Record
+	{
+		/// \brief Path of file-entry in the archive
+		std::string Path;
+		/// \brief Ordinal number of the archive in ArchiveList
+		cnv::dword Archive;
+		/// \brief Ordinal number of file-entry in the archive
+		cnv::dword Entry;
+		/// \brief Uncompressed size of file-entry
+		cnv::qword Size;
+	};
+	/// \brief Paths containing single trigram
+	struct Gram
+	{
+		/// \brief Three characters of comparable path
+		cnv::dword Key;
+		/// \brief First ordinal number of path in PostingList
+		cnv::dword First;
+		/// \brief Amount of paths
+		cnv::dword Amount;
+	};
+	/// \brief Root directory of indexed archives (full path without trailing separator)
+	std::string RootPath;
+	/// \brief Path of the index file
+	std::string IndexPath;
+	/// \brief Indexed archives (ordered by path)
+	std::vector<Archive> ArchiveList;
+	/// \brief Paths of file-entries of all archives (ordered by comparable path)
+	std::vector<Record> RecordList;
+	/// \brief Comparable paths (lower case, backslashes) of RecordList
+	std::vector<std::string> KeyList;
+	/// \brief Trigrams of comparable paths (ordered by key)
+	std::vector<Gram> GramList;
+	/// \brief Ordinal numbers of paths of every trigram (ascending for each trigram)
+	std::vector<cnv::dword> PostingList;
+	/// \brief Paths found by the last query (ordinal numbers in RecordList)
+	std::vector<cnv::dword> FoundList;
+	/// \brief Amount of archives read by the last build
+	cnv::unsint AmountRead;
+	/// \brief Amount of archives taken from the previous index by the last build
+	cnv::unsint AmountReused;
+	/// \brief Amount of archives of the previous index which don't exist anymore
+	cnv::unsint AmountRemoved;
+	/// \brief Archives which couldn't be read and linked directories which were not searched by the last build
+	std::vector<std::string> SkipReport;
+	/// \brief Size of the index file in bytes
+	cnv::qword IndexSize;
+	/// \brief Duration of the last operation (build, loading or query) in seconds
+	double Duration;
+
+	public:
+	FstIndex()
+	{
+		AmountRead = 0;
+		AmountReused = 0;
+		AmountRemoved = 0;
+		IndexSize = 0;
+		Duration = 0;
+	}
+	~FstIndex()
+	{
+
+	}
+
+	int Build(char*, char*);
+	int Load(char*);
+	int Find(std::string);
+
+	/// \brief Get root directory of indexed archives
+	std::string GetRootPath(){return RootPath;}
+	/// \brief Get path of the index file
+	std::string GetIndexPath(){return IndexPath;}
+	/// \brief Get amount of indexed archives
+	cnv::dword GetAmountArchives(){return ArchiveList.size();}
+	/// \brief Get amount of indexed paths
+	cnv::dword GetAmountPaths(){return RecordList.size();}
+	/// \brief Get amount of trigrams
+	cnv::dword GetAmountGrams(){return GramList.size();}
+	/// \brief Get amount of archives read by the last build
+	cnv::unsint GetAmountRead(){return AmountRead;}
+	/// \brief Get amount of archives taken from the previous index by the last build
+	cnv::unsint GetAmountReused(){return AmountReused;}
+	/// \brief Get amount of archives of the previous index which don't exist anymore
+	cnv::unsint GetAmountRemoved(){return AmountRemoved;}
+	/// \brief Get amount of lines of report about archives which couldn't be read
+	cnv::unsint GetAmountReport(){return SkipReport.size();}
+	/// \brief Get line of report about archives which couldn't be read
+	std::string GetReportLine(cnv::unsint i){return SkipReport.at(i);}
+	/// \brief Get size of the index file
+	cnv::qword GetIndexSize(){return IndexSize;}
+	/// \brief Get duration of the last operation in seconds
+	double GetDuration(){return Duration;}
+	/// \brief Get amount of paths found by the last query
+	cnv::dword GetAmountFound(){return FoundList.size();}
+	/// \brief Get path of found file-entry prefixed by path of its archive (ARCHIVES\A.FST\UNITS\MECH.TXT)
+	std::string GetFoundPath(cnv::unsint i){return ArchiveList.at(RecordList.at(FoundList.at(i)).Archive).Path + "\\" + RecordList.at(FoundList.at(i)).Path;}
+	/// \brief Get uncompressed size of found file-entry
+	cnv::qword GetFoundSize(cnv::unsint i){return RecordList.at(FoundList.at(i)).Size;}
+
+	private:
+	void Clear();
+	void FindArchives(std::string, std::vector<Archive>&);
+	void ReadArchives(FstIndex&);
+	void BuildGrams();
+	int Write();
+	int Read();
+	void Candidates(const std::string&, std::vector<cnv::dword>&);
+	static std::string GetKey(const std::string&);
+};
+#endif
@@ -0,0 +1,612 @@
+/// \file
+/// \brief Fst patch module
+/// \author SpinelDusk
+/// \details Creating binary patches between two versions of FST file and rebuilding the new version from the old one
+
+#pragma GCC diagnostic ignored "-Wc++98-compat"					//Disable warning: 'nullptr' is incompatible with C++98
+#pragma GCC diagnostic ignored "-Wdisabled-macro-expansion"		//Disable warning: Disabled expansion of recursive macro
+#pragma GCC diagnostic ignored "-Wlanguage-extension-token"		//Disable warning: Extension used
+
+#pragma package(smart_init)//Ensures that packaged units are initialized in the order determined by their dependencies
+
+#include "FstPatch.h"
+
+/// \brief Macro makes it easy to write SendAlert function in the code
+#define SendAlert(a,b) SendAlert(__FILE__,__FUNCSIG__,__LINE__,a,3,b)
+
+/// \brief Signature of patch file
+const char PatchSignature[4] = {'F', 'S', 'T', 'P'};
+/// \brief Version of patch format
+const cnv::dword PatchVersion = 1;
+/// \brief Size of block for streaming copy operations
+const cnv::dword PatchBlockSize = 1024*64;//64 KB
+/// \brief Amount of segments per worker which may be encoded ahead of the written part of the patch
+const cnv::unsint PatchLookahead = 2;
+
+/// \brief Clearing instance fields (patch instance)
+void FstPatch::Clear()
+{
+	SegmentList.erase(SegmentList.begin(), SegmentList.end());
+	AmountCopied = 0;
+	AmountDelta = 0;
+	AmountStored = 0;
+	PatchSize = 0;
+	TargetSize = 0;
+	PatchPath.erase(PatchPath.begin(), PatchPath.end());
+}
+/// \brief Creating patch from the old archive to the new one
+/// \param[in] local_Old Path to the old archive
+/// \param[in] local_New Path to the new archive
+/// \param[in] local_Output Path to the created patch
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstPatch::Create(char* local_Old, char* local_New, char* local_Output)
+{
+	//Clearing the instance fields
+	Clear();
+
+	//Loading tables of contents of both archives
+	FstUnpack OldArchive;
+	FstUnpack NewArchive;
+	if(OldArchive.Load(local_Old))
+		return 1;
+	if(NewArchive.Load(local_New))
+		return 1;
+	if(OldArchive.GetFileSize() > 0xFFFFFFFFULL || NewArchive.GetFileSize() > 0xFFFFFFFFULL)
+	{
+		SendAlert(53, local_New);//Patches are limited to archives smaller than 4 GB.
+		return 1;
+	}
+
+	//Checksums of both archives
+	ifstream OldStream(local_Old, ios::in|ios::binary);
+	ifstream NewStream(local_New, ios::in|ios::binary);
+	if(!OldStream.is_open() || !NewStream.is_open())
+	{
+		SendAlert(38, local_Old);//Can't open input archive file. File does not exist or is locked. (Or the file path contains Unicode characters.)
+		return 1;
+	}
+	cnv::qword OldHash = 0;
+	cnv::qword NewHash = 0;
+	cnv::dword OldSize = 0;
+	cnv::dword NewSize = 0;
+	if(FileHash(OldStream, OldHash, OldSize))
+		return 1;
+	if(FileHash(NewStream, NewHash, NewSize))
+		return 1;
+	OldStream.close();
+	NewStream.close();
+
+	//Splitting the new archive into segments
+	if(BuildSegments(OldArchive, NewArchive))
+		return 1;
+
+	//Creating the patch file
+	ofstream PatchFile(local_Output, ios::out|ios::binary);
+	if(!PatchFile.is_open())
+	{
+		SendAlert(39, local_Output);//Can't open output file.
+		return 1;
+	}
+	std::vector<cnv::byte> Head(PatchSignature, PatchSignature + 4);
+	chf::PutDword(Head, PatchVersion);
+	chf::PutDword(Head, OldSize);
+	chf::PutQword(Head, OldHash);
+	chf::PutDword(Head, NewSize);
+	chf::PutQword(Head, NewHash);
+	PatchFile.write(reinterpret_cast<const char*>(Head.data()), Head.size());
+
+	//Encoding segments on worker threads (each worker uses its own file streams). Encoded segments are written
+	//in order as soon as all previous ones are written, and workers don't run ahead of the written part by more
+	//than PatchLookahead segments, so only few encoded segments are held in memory
+	cnv::unsint Workers = chf::GetWorkerCount();
+	std::vector<ifstream> OldStreams(Workers);
+	std::vector<ifstream> NewStreams(Workers);
+	std::vector<bool> Encoded(SegmentList.size(), false);
+	cnv::unsint NextWrite = 0;
+	cnv::unsint Lookahead = Workers * PatchLookahead;
+	std::mutex WriteLock;
+	std::condition_variable WriteSignal;
+	ErrorBatch Errors;
+	chf::ParallelFor(SegmentList.size(), [&](cnv::unsint i, cnv::unsint w)
+	{
+		{
+			std::unique_lock<std::mutex> Lock(WriteLock);
+			WriteSignal.wait(Lock, [&]()
+			{
+				return Errors.GetAmount() != 0 || i < NextWrite + Lookahead;
+			});
+			if(Errors.GetAmount() != 0)
+				return;
+		}
+		ClearThreadError();
+		if(!OldStreams.at(w).is_open())
+			OldStreams.at(w).open(local_Old, ios::in|ios::binary);
+		if(!NewStreams.at(w).is_open())
+			NewStreams.at(w).open(local_New, ios::in|ios::binary);
+		int Result = 0;
+		if(!OldStreams.at(w).is_open() || !NewStreams.at(w).is_open())
+		{
+			SendAlert(38, OldStreams.at(w).is_open() ? local_New : local_Old);//Can't open input archive file. File does not exist or is locked. (Or the file path contains Unicode characters.)
+			Result = 1;
+		}
+		else
+			Result = EncodeSegment(SegmentList.at(i), OldStreams.at(w), NewStreams.at(w));
+
+		std::lock_guard<std::mutex> Lock(WriteLock);
+		if(Result)
+			Errors.AddThreadError();
+		Encoded.at(i) = true;
+		while(Errors.GetAmount() == 0 && NextWrite < SegmentList.size() && Encoded.at(NextWrite))
+		{
+			Segment& Item = SegmentList.at(NextWrite);
+			PatchFile.write(reinterpret_cast<const char*>(Item.Code.data()), Item.Code.size());
+			if(!PatchFile.good())
+			{
+				SendAlert(69, local_Output);//Can't write the archive file. File is read-only or locked, or disk is full.
+				Errors.AddThreadError();
+				break;
+			}
+			if(Item.IsEntry)
+			{
+				switch(Item.Kind)
+				{
+					case SK_COPY:
+						AmountCopied++;
+					break;
+					case SK_ADD:
+						AmountStored++;
+					break;
+					case SK_DELTA:
+						AmountDelta++;
+					break;
+				}
+			}
+			std::vector<cnv::byte>().swap(Item.Code);
+			NextWrite++;
+		}
+		WriteSignal.notify_all();
+	});
+	if(Errors.GetAmount() != 0)
+	{
+		PatchFile.close();
+		remove(local_Output);
+		Errors.Publish();
+		return 1;
+	}
+	PatchFile << static_cast<cnv::byte>(PC_END);
+	PatchSize = static_cast<cnv::dword>(PatchFile.tellp());
+	if(!PatchFile.good())
+	{
+		PatchFile.close();
+		remove(local_Output);
+		SendAlert(69, local_Output);//Can't write the archive file. File is read-only or locked, or disk is full.
+		return 1;
+	}
+	PatchFile.close();
+
+	PatchPath = local_Output;
+	TargetSize = NewSize;
+	return 0;
+}
+/// \brief Splitting the new archive into segments and finding base data for them in the old archive
+/// \param[in] OldArchive Loaded old archive
+/// \param[in] NewArchive Loaded new archive
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstPatch::BuildSegments(FstUnpack& OldArchive, FstUnpack& NewArchive)
+{
+	//Index of the old archive by path
+	std::map<std::string, cnv::unsint> OldIndex;
+	for(cnv::unsint i = 0; i < OldArchive.GetAmountEntries(); i++)
+	{
+		OldIndex[GetComparablePath(OldArchive.GetPath(i))] = i;
+	}
+
+	//Entries of the new archive in order of data offsets
+	std::vector<cnv::unsint> Order(NewArchive.GetAmountEntries());
+	for(cnv::unsint i = 0; i < Order.size(); i++)
+	{
+		Order.at(i) = i;
+	}
+	std::stable_sort(Order.begin(), Order.end(), [&NewArchive](cnv::unsint a, cnv::unsint b)
+	{
+		return NewArchive.GetDataOffset(a) < NewArchive.GetDataOffset(b);
+	});
+
+	//Header is encoded against header of the old archive (paths usually match, offsets differ)
+	cnv::qword NewHeadSize = NewArchive.GetHeadSize();
+	cnv::qword OldHeadSize = OldArchive.GetHeadSize();
+	if(NewHeadSize > NewArchive.GetFileSize())
+		NewHeadSize = NewArchive.GetFileSize();
+	if(OldHeadSize > OldArchive.GetFileSize())
+		OldHeadSize = OldArchive.GetFileSize();
+	SegmentList.push_back({0, static_cast<cnv::dword>(NewHeadSize), 0, static_cast<cnv::dword>(OldHeadSize), false, SK_ADD, {}});
+
+	cnv::qword Position = NewHeadSize;
+	for(cnv::unsint i = 0; i < Order.size(); i++)
+	{
+		cnv::unsint Count = Order.at(i);
+		cnv::qword Start = NewArchive.GetDataOffset(Count);
+		cnv::qword End = Start + NewArchive.GetCompressSize(Count);
+		if(End > NewArchive.GetFileSize())
+		{
+			SendAlert(36, NewArchive.GetPath(Count));//Data of file-entry lies outside the archive file. The file is corrupted.
+			return 1;
+		}
+
+		//Data is already covered by previous segments (shared data of several entries)
+		if(End <= Position)
+			continue;
+
+		//Bytes between entries
+		if(Start > Position)
+			SegmentList.push_back({static_cast<cnv::dword>(Position), static_cast<cnv::dword>(Start - Position), 0, 0, false, SK_ADD, {}});
+
+		//Data partially covered by previous segment is stored as is
+		if(Start < Position)
+		{
+			SegmentList.push_back({static_cast<cnv::dword>(Position), static_cast<cnv::dword>(End - Position), 0, 0, false, SK_ADD, {}});
+			Position = End;
+			continue;
+		}
+
+		//Base for the entry is the entry with the same path in the old archive
+		cnv::dword BaseOffset = 0;
+		cnv::dword BaseSize = 0;
+		std::map<std::string, cnv::unsint>::iterator Found = OldIndex.find(GetComparablePath(NewArchive.GetPath(Count)));
+		if(Found != OldIndex.end())
+		{
+			cnv::qword BaseEnd = static_cast<cnv::qword>(OldArchive.GetDataOffset(Found->second)) + OldArchive.GetCompressSize(Found->second);
+			if(BaseEnd <= OldArchive.GetFileSize())
+			{
+				BaseOffset = OldArchive.GetDataOffset(Found->second);
+				BaseSize = OldArchive.GetCompressSize(Found->second);
+			}
+		}
+		SegmentList.push_back({static_cast<cnv::dword>(Start), static_cast<cnv::dword>(End - Start), BaseOffset, BaseSize, true, SK_ADD, {}});
+		Position = End;
+	}
+
+	//Bytes after the last entry
+	if(Position < NewArchive.GetFileSize())
+		SegmentList.push_back({static_cast<cnv::dword>(Position), static_cast<cnv::dword>(NewArchive.GetFileSize() - Position), 0, 0, false, SK_ADD, {}});
+	return 0;
+}
+/// \brief Encoding single segment of the new archive
+/// \param[in,out] Item Segment (result is saved into Code and Kind fields)
+/// \param[in] OldStream File stream for the old archive
+/// \param[in] NewStream File stream for the new archive
+/// \return Error code: 0 - no errors, 1 - operation error
+int FstPatch::EncodeSegment(Segment& Item, ifstream& OldStream, ifstream& NewStream)
+{
+	//Data of both archives is held until the segment is encoded (worker waits while other workers hold the memory budget)
+	chf::MemoryLease Lease(static_cast<cnv::qword>(Item.Size) + Item.BaseSize);
+	std::vector<cnv::byte> Target;
+	if(BlockRead(NewStream, Item.Offset, Item.Size, Target))
+		return 1;
+
+	std::vector<cnv::byte> Base;
+	if(Item.BaseSize != 0)
+	{
+		if(BlockRead(OldStream, Item.BaseOffset, Item.BaseSize, Base))
+			return 1;
+	}
+
+	if(Item.BaseSize != 0 && Base == Target)
+	{
+		//Unchanged data - single reference to the old archive
+		Item.Code.push_back(PC_COPY);
+		chf::PutDword(Item.Code, Item.BaseOffset);
+		chf::PutDword(Item.Code, Item.BaseSize);
+		Item.Kind = SK_COPY;
+	}
+	else if(Item.BaseSize != 0)
+	{
+		//Changed data - delta against the old data
+		DeltaEncode(Base, Item.BaseOffset, Target, Item.Code);
+		Item.Kind = SK_DELTA;
+	}
+	else
+	{
+		//New data - stored as is
+		Item.Code.push_back(PC_ADD);
+		chf::PutDword(Item.Code, Item.Size);
+		Item.Code.insert(Item.Code.end(), Target.begin(), Target.end());
+		Item.Kind = SK_ADD;
+	}
+	return 0;
+}
+/// \brief Rebuilding the new archive from the old one and the patch
+/// \param[in] local_Old Path to the old archive
+/// \param[in] local_Patch Path to the patch
+/// \param[in] local_Output Path to the rebuilt archive
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Data is copied in blocks, so memory consumption doesn't depend on the size of archives
+int FstPatch::Apply(char* local_Old, char* local_Patch, char* local_Output)
+{
+	//Clearing the instance fields
+	Clear();
+
+	//Trying to open the patch
+	ifstream PatchFile(local_Patch, ios::in|ios::binary);
+	if(!PatchFile.is_open())
+	{
+		SendAlert(40, local_Patch);//Can't open patch file. File does not exist or is locked. (Or the file path contains Unicode characters.)
+		return 1;
+	}
+
+	//Reading the patch header
+	char Signature[4];
+	cnv::dword Version = 0;
+	cnv::dword OldSize = 0;
+	cnv::dword NewSize = 0;
+	cnv::dword HashPart[4];
+	if(StreamRead(PatchFile, Signature, 4))
+		return 1;
+	if(memcmp(Signature, PatchSignature, 4) || DwordRead(PatchFile, Version) || Version != PatchVersion)
+	{
+		SendAlert(41, local_Patch);//The file is not a patch for FST archives or has unsupported version.
+		return 1;
+	}
+	if(DwordRead(PatchFile, OldSize) || DwordRead(PatchFile, HashPart[0]) || DwordRead(PatchFile, HashPart[1]) ||
+		DwordRead(PatchFile, NewSize) || DwordRead(PatchFile, HashPart[2]) || DwordRead(PatchFile, HashPart[3]))
+		return 1;
+	cnv::qword OldHash = (static_cast<cnv::qword>(HashPart[1]) << 32) | HashPart[0];
+	cnv::qword NewHash = (static_cast<cnv::qword>(HashPart[3]) << 32) | HashPart[2];
+
+	//Checking that the patch is made for this archive
+	ifstream OldFile(local_Old, ios::in|ios::binary);
+	if(!OldFile.is_open())
+	{
+		SendAlert(38, local_Old);//Can't open input archive file. File does not exist or is locked. (Or the file path contains Unicode characters.)
+		return 1;
+	}
+	cnv::qword SourceHash = 0;
+	cnv::dword SourceSize = 0;
+	if(FileHash(OldFile, SourceHash, SourceSize))
+		return 1;
+	if(SourceHash != OldHash || SourceSize != OldSize)
+	{
+		SendAlert(42, local_Old);//The patch does not match the source archive (size or checksum differs).
+		return 1;
+	}
+
+	//Create an output file, the rebuilt archive
+	if(ClearEditJournal(local_Output))
+		return 1;
+	ofstream Receiver(local_Output, ios::out|ios::binary);
+	if(!Receiver.is_open())
+	{
+		SendAlert(39, local_Output);//Can't open output file.
+		return 1;
+	}
+
+	//Executing instructions
+	std::vector<cnv::byte> Block(PatchBlockSize);
+	cnv::qword WrittenHash = chf::HashData(nullptr, 0);
+	cnv::qword WrittenSize = 0;
+	for(bool Finished = false; !Finished; )
+	{
+		char Command = 0;
+		cnv::dword Offset = 0;
+		cnv::dword Length = 0;
+		if(StreamRead(PatchFile, &Command, 1))
+		{
+			Receiver.close();
+			remove(local_Output);
+			return 1;
+		}
+		switch(Command)
+		{
+			case PC_COPY:	//Copy block from the old archive
+				if(DwordRead(PatchFile, Offset) || DwordRead(PatchFile, Length))
+				{
+					Receiver.close();
+					remove(local_Output);
+					return 1;
+				}
+				if(static_cast<cnv::qword>(Offset) + Length > OldSize)
+				{
+					Receiver.close();
+					remove(local_Output);
+					SendAlert(43, local_Patch);//The patch contains invalid instruction. The file is corrupted.
+					return 1;
+				}
+				OldFile.seekg(Offset, std::ios_base::beg);
+				break;
+
+			case PC_ADD:	//Add block stored in the patch
+				if(DwordRead(PatchFile, Length))
+				{
+					Receiver.close();
+					remove(local_Output);
+					return 1;
+				}
+				break;
+
+			case PC_END:	//End of the patch
+				Finished = true;
+				break;
+
+			default:		//Unknown instruction
+				Receiver.close();
+				remove(local_Output);
+				SendAlert(43, local_Patch);//The patch contains invalid instruction. The file is corrupted.
+				return 1;
+		}
+
+		//Streaming copy of the block
+		ifstream& Source = (Command == PC_COPY) ? OldFile : PatchFile;
+		while(Length != 0)
+		{
+			cnv::dword Part = (Length > PatchBlockSize) ? PatchBlockSize : Length;
+			if(StreamRead(Source, reinterpret_cast<char*>(Block.data()), static_cast<int>(Part)))
+			{
+				Receiver.close();
+				remove(local_Output);
+				return 1;
+			}
+			Receiver.write(reinterpret_cast<const char*>(Block.data()), Part);
+			if(!Receiver.good())
+			{
+				Receiver.close();
+				remove(local_Output);
+				SendAlert(52, local_Output);//StreamCopy - Write error on output operation.
+				return 1;
+			}
+			WrittenHash = chf::HashData(Block.data(), Part, WrittenHash);
+			WrittenSize += Part;
+			Length -= Part;
+		}
+	}
+	Receiver.close();
+	if(Receiver.fail())
+	{
+		remove(local_Output);
+		SendAlert(52, local_Output);//StreamCopy - Write error on output operation.
+		return 1;
+	}
+
+	//Checking the result
+	if(WrittenSize != NewSize || WrittenHash != NewHash)
+	{
+		remove(local_Output);
+		SendAlert(44, local_Output);//The rebuilt archive does not match the patch checksum.
+		return 1;
+	}
+
+	PatchPath = local_Patch;
+	TargetSize = NewSize;
+	return 0;
+}
+
+
+/// \brief Calculating hash and size of entire file
+/// \param[in] local_Input File stream
+/// \param[out] Hash Hash of the file
+/// \param[out] Size Size of the file
+/// \return Error code: 0 - no errors, 1 - operation error
+int FileHash(ifstream& local_Input, cnv::qword& Hash, cnv::dword& Size)
+{
+	std::vector<cnv::byte> Block(PatchBlockSize);
+	Size = chf::GetFileSize(local_Input);
+	local_Input.seekg(0, std::ios_base::beg);
+	Hash = chf::HashData(nullptr, 0);
+	for(cnv::dword Left = Size; Left != 0; )
+	{
+		cnv::dword Part = (Left > PatchBlockSize) ? PatchBlockSize : Left;
+		if(StreamRead(local_Input, reinterpret_cast<char*>(Block.data()), static_cast<int>(Part)))
+			return 1;
+		Hash = chf::HashData(Block.data(), Part, Hash);
+		Left -= Part;
+	}
+	return 0;
+}
+/// \brief Read block of data from the specified position of file
+/// \param[in] local_Input File stream
+/// \param[in] Offset Position of block in the file
+/// \param[in] Size Size of block
+/// \param[out] local_Output Buffer for block (resized to size of block)
+/// \return Error code: 0 - no errors, 1 - operation error
+int BlockRead(ifstream& local_Input, cnv::dword Offset, cnv::dword Size, std::vector<cnv::byte>& local_Output)
+{
+	local_Output.resize(Size);
+	local_Input.clear();
+	local_Input.seekg(Offset, std::ios_base::beg);
+	return StreamRead(local_Input, reinterpret_cast<char*>(local_Output.data()), Size);
+}
+/// \brief Encoding data as delta against base data
+/// \param[in] Base Base data
+/// \param[in] BaseOffset Position of base data in the old archive (copy instructions use absolute positions)
+/// \param[in] Target Data to encode
+/// \param[out] Code Buffer for encoded instructions (instructions are appended)
+/// \details Base is indexed by blocks of fixed size, target is scanned with rolling hash.
+/// Found matches are extended in both directions and become copy instructions, the rest is stored as is
+void DeltaEncode(const std::vector<cnv::byte>& Base, cnv::dword BaseOffset, const std::vector<cnv::byte>& Target, std::vector<cnv::byte>& Code)
+{
+	const cnv::unsint BlockSize = 16;
+	const cnv::unsint Multiplier = 0x01000193;
+	cnv::unsint Literal = 0;//Beginning of data not yet encoded
+
+	auto FlushLiteral = [&](cnv::unsint End)
+	{
+		if(End > Literal)
+		{
+			Code.push_back(PC_ADD);
+			chf::PutDword(Code, End - Literal);
+			Code.insert(Code.end(), Target.begin() + Literal, Target.begin() + End);
+		}
+	};
+	auto BlockHash = [&](const cnv::byte* Data)
+	{
+		cnv::unsint Hash = 0;
+		for(cnv::unsint j = 0; j < BlockSize; j++)
+		{
+			Hash = Hash * Multiplier + Data[j];
+		}
+		return Hash;
+	};
+
+	if(Base.size() < BlockSize || Target.size() < BlockSize)
+	{
+		FlushLiteral(static_cast<cnv::unsint>(Target.size()));
+		return;
+	}
+
+	//Index of base blocks (first occurrence is kept)
+	std::unordered_map<cnv::unsint, cnv::unsint> Index;
+	Index.reserve(Base.size() / BlockSize + 1);
+	for(cnv::unsint i = 0; i + BlockSize <= Base.size(); i += BlockSize)
+	{
+		Index.emplace(BlockHash(&Base.at(i)), i);
+	}
+
+	//Multiplier for the byte leaving the rolling window
+	cnv::unsint Power = 1;
+	for(cnv::unsint j = 1; j < BlockSize; j++)
+	{
+		Power *= Multiplier;
+	}
+
+	cnv::unsint i = 0;
+	cnv::unsint Hash = BlockHash(&Target.at(0));
+	while(i + BlockSize <= Target.size())
+	{
+		std::unordered_map<cnv::unsint, cnv::unsint>::iterator Found = Index.find(Hash);
+		if(Found != Index.end() && !memcmp(&Base.at(Found->second), &Target.at(i), BlockSize))
+		{
+			cnv::unsint BasePos = Found->second;
+			cnv::unsint TargetPos = i;
+			cnv::unsint Length = BlockSize;
+
+			//Extending match backward (only over data not yet encoded)
+			while(TargetPos > Literal && BasePos > 0 && Base.at(BasePos - 1) == Target.at(TargetPos - 1))
+			{
+				BasePos--;
+				TargetPos--;
+				Length++;
+			}
+			//Extending match forward
+			while(TargetPos + Length < Target.size() && BasePos + Length < Base.size() && Base.at(BasePos + Length) == Target.at(TargetPos + Length))
+			{
+				Length++;
+			}
+
+			FlushLiteral(TargetPos);
+			Code.push_back(PC_COPY);
+			chf::PutDword(Code, BaseOffset + BasePos);
+			chf::PutDword(Code, Length);
+
+			i = TargetPos + Length;
+			Literal = i;
+			if(i + BlockSize <= Target.size())
+				Hash = BlockHash(&Target.at(i));
+			continue;
+		}
+
+		//Rolling the window by one byte
+		if(i + BlockSize < Target.size())
+			Hash = (Hash - Target.at(i) * Power) * Multiplier + Target.at(i + BlockSize);
+		i++;
+	}
+	FlushLiteral(static_cast<cnv::unsint>(Target.size()));
+}
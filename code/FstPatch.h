@@ -0,0 +1,114 @@
+/// \file
+/// \brief Fst patch module (Header)
+/// \author SpinelDusk
+
+#pragma GCC diagnostic ignored "-Wpadded"						//Disable warning: Padding class -- with -- byte to align --
+
+#pragma once//This header guard directive designed to cause the current source file to be included only once in a single compilation
+#ifndef FstPatchH
+#define FstPatchH
+
+#include <map>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#pragma hdrstop//This directive terminates the list of header files eligible for precompilation (Using ONLY for <standard> headers, no "custom")
+
+#include "FstFile.h"
+#include "FstDiff.h"
+
+/// \brief Enumeration of patch instructions
+enum PatchCommand
+{
+	PC_COPY = 'C',	///< Copy block from the old archive (offset, length)
+	PC_ADD = 'A',	///< Add block stored in the patch (length, data)
+	PC_END = 'E'	///< End of the patch
+};
+
+/// \brief Enumeration of encoding results of patch segments
+enum SegmentKind
+{
+	SK_COPY = 'C',	///< Segment is copied from the old archive as is (single copy instruction)
+	SK_ADD = 'A',	///< Segment is stored in the patch as is
+	SK_DELTA = 'D'	///< Segment is encoded as delta against data of the old archive
+};
+
+/// \brief The class contains data and functions necessary for creating and applying patches for FST files
+/// \details Patch is a sequence of instructions building the new archive from the old one byte by byte.
+/// Segments of the new archive (header, data of file-entries, gaps) are encoded independently:
+/// unchanged entries become single copy instruction, changed entries - binary delta against the old entry with the same path,
+/// new entries and gaps are stored as is
+class FstPatch
+{
+	private:
+	/// \brief Segment of the new archive
+	struct Segment
+	{
+		/// \brief Offset of segment in the new archive
+		cnv::dword Offset;
+		/// \brief Size of segment
+		cnv::dword Size;
+		/// \brief Offset of base data in the old archive
+		cnv::dword BaseOffset;
+		/// \brief Size of base data (0 - no base, segment is stored as is)
+		cnv::dword BaseSize;
+		/// \brief True - segment is data of file-entry
+		bool IsEntry;
+		/// \brief Encoding result (SegmentKind)
+		char Kind;
+		/// \brief Encoded instructions for segment
+		std::vector<cnv::byte> Code;
+	};
+	/// \brief Segments of the new archive in order of offsets
+	std::vector<Segment> SegmentList;
+
+	/// \brief Amount of entries copied from the old archive
+	cnv::dword AmountCopied;
+	/// \brief Amount of entries encoded as delta
+	cnv::dword AmountDelta;
+	/// \brief Amount of entries stored as is
+	cnv::dword AmountStored;
+	/// \brief Size of the patch in bytes
+	cnv::dword PatchSize;
+	/// \brief Size of the target archive in bytes
+	cnv::dword TargetSize;
+	/// \brief Patch path
+	std::string PatchPath;
+
+	public:
+	FstPatch()
+	{
+
+	}
+	~FstPatch()
+	{
+
+	}
+
+	int Create(char*, char*, char*);
+	int Apply(char*, char*, char*);
+
+	/// \brief Get patch path
+	std::string GetPatchPath(){return PatchPath;}
+	/// \brief Get amount of entries copied from the old archive
+	cnv::dword GetAmountCopied(){return AmountCopied;}
+	/// \brief Get amount of entries encoded as delta
+	cnv::dword GetAmountDelta(){return AmountDelta;}
+	/// \brief Get amount of entries stored as is
+	cnv::dword GetAmountStored(){return AmountStored;}
+	/// \brief Get size of the patch
+	cnv::dword GetPatchSize(){return PatchSize;}
+	/// \brief Get size of the target archive
+	cnv::dword GetTargetSize(){return TargetSize;}
+
+	private:
+	void Clear();
+	int BuildSegments(FstUnpack&, FstUnpack&);
+	int EncodeSegment(Segment&, ifstream&, ifstream&);
+};
+
+int FileHash(ifstream&, cnv::qword&, cnv::dword&);
+int BlockRead(ifstream&, cnv::dword, cnv::dword, std::vector<cnv::byte>&);
+void DeltaEncode(const std::vector<cnv::byte>&, cnv::dword, const std::vector<cnv::byte>&, std::vector<cnv::byte>&);
+#endif
@@ -0,0 +1,333 @@
+/// \file
+/// \brief Listing module
+/// \author SpinelDusk
+/// \details Formatting table of contents of FST file for the console and for scripts (CSV, JSON Lines, binary)
+
+#pragma GCC diagnostic ignored "-Wc++98-compat"					//Disable warning: 'nullptr' is incompatible with C++98
+
+#pragma package(smart_init)//Ensures that packaged units are initialized in the order determined by their dependencies
+
+#include "Listing.h"
+
+/// \brief Version of binary listing format
+const cnv::dword ListingVersion = 1;
+/// \brief Size of single record of binary listing format
+const cnv::dword ListingRecordSize = 5 * 4 + 250;
+
+/// \brief Formatting archive header (or header of the listing for machine-readable formats)
+/// \param[in] Archive Loaded archive
+void FstListing::WriteHead(FstUnpack& Archive)
+{
+	switch(Format)
+	{
+		case LF_TABLE:
+			//Archive path
+			Buffer += "ArchivePath    : ";
+			Buffer += Archive.GetArchivePath();
+			Buffer += '\n';
+
+			//Amount of entries
+			Buffer += "AmountEntries  : ";
+			AppendDec(Archive.GetAmountEntries(), 15);
+			Buffer += "0x";
+			AppendHex(Archive.GetAmountEntries(), 0);
+			Buffer += '\n';
+
+			//File size
+			Buffer += "FileSize       : ";
+			AppendDec(Archive.GetFileSize(), 15);
+			Buffer += "0x";
+			AppendHex(Archive.GetFileSize(), 15);
+			AppendSize(Archive.GetFileSize());
+			Buffer += '\n';
+
+			//Container variant (shown only for extended archives)
+			if(Archive.GetFormat() == AF_FST64)
+				Buffer += "Format         : FST64 (extended)\n";
+
+			//Shared dictionary (shown only when it is stored in the archive)
+			if(Archive.GetDictionarySize() != 0)
+			{
+				Buffer += "Dictionary     : ";
+				AppendDec(Archive.GetDictionarySize(), 0);
+				Buffer += " bytes\n";
+			}
+			Buffer += '\n';
+
+			//Description string for data table
+			Buffer += "Indx Extn DataOffset   (hex)        Uncomp.Size  (hex)        CompressSize (hex)        CompressFlag       Path\n";
+		break;
+
+		case LF_CSV:
+			Buffer += "Index,Extension,DataOffset,UncompressSize,CompressSize,CompressFlag,Path\n";
+		break;
+
+		case LF_JSONL:
+		break;
+
+		case LF_BINARY:
+			//Console output must not translate line feeds in binary data
+			Flush();
+			_setmode(_fileno(stdout), _O_BINARY);
+			Buffer += "FSTL";
+			AppendDword(ListingVersion);
+			AppendDword(Archive.GetAmountEntries());
+			AppendDword(ListingRecordSize);
+		break;
+	}
+	CheckLimit();
+}
+/// \brief Formatting single archive entry
+/// \param[in] Archive Loaded archive
+/// \param[in] i Ordinal number of entry in file
+void FstListing::WriteEntry(FstUnpack& Archive, cnv::unsint i)
+{
+	const char FlagLetter[3] = {'U', 'C', 'E'};
+	char Flag = (Archive.GetCompressFlag(i) < 3) ? FlagLetter[Archive.GetCompressFlag(i)] : '?';
+	cnv::unsint Basis = 12;
+	cnv::unsint HexBasis = Basis - 2;
+
+	switch(Format)
+	{
+		case LF_TABLE:
+			//Index
+			AppendDec(i, 4);
+
+			//Extn
+			Buffer += GetExtFromPath(Archive.GetPath(i));
+			Buffer += "  ";
+
+			//DataOffset
+			AppendDec(Archive.GetDataOffset(i), Basis);
+			Buffer += "0x";
+			AppendHex(Archive.GetDataOffset(i), HexBasis);
+
+			//Uncomp.Size
+			if(Archive.GetUncompressSize(i) == 0)
+				Buffer += "-                         ";
+			else
+			{
+				AppendDec(Archive.GetUncompressSize(i), Basis);
+				Buffer += "0x";
+				AppendHex(Archive.GetUncompressSize(i), HexBasis);
+			}
+
+			//CompressSize
+			if(Archive.GetCompressFlag(i) == CF_UNCOMPRESS || Archive.GetCompressFlag(i) == CF_EMPTY)
+				Buffer += "-                         ";
+			else
+			{
+				AppendDec(Archive.GetCompressSize(i), Basis);
+				Buffer += "0x";
+				AppendHex(Archive.GetCompressSize(i), HexBasis);
+			}
+
+			//CompressFlag
+			if(Archive.GetCompressFlag(i) == CF_UNCOMPRESS)
+				Buffer += "U - uncompressed   ";
+			else if(Archive.GetCompressFlag(i) == CF_COMPRESS)
+				Buffer += "C - compressed     ";
+			else if(Archive.GetCompressFlag(i) == CF_EMPTY)
+				Buffer += "E - empty          ";
+
+			//Path
+			Buffer += Archive.GetPath(i);
+			Buffer += '\n';
+		break;
+
+		case LF_CSV:
+			AppendDec(i, 0);
+			Buffer += ',';
+			Buffer += GetExtFromPath(Archive.GetPath(i));
+			Buffer += ',';
+			AppendDec(Archive.GetDataOffset(i), 0);
+			Buffer += ',';
+			AppendDec(Archive.GetUncompressSize(i), 0);
+			Buffer += ',';
+			AppendDec(Archive.GetCompressSize(i), 0);
+			Buffer += ',';
+			Buffer += Flag;
+			Buffer += ',';
+			AppendQuoted(Archive.GetNestedPath() + Archive.GetPath(i), LF_CSV);
+			Buffer += '\n';
+		break;
+
+		case LF_JSONL:
+			Buffer += "{\"index\":";
+			AppendDec(i, 0);
+			Buffer += ",\"extension\":";
+			AppendQuoted(GetExtFromPath(Archive.GetPath(i)), LF_JSONL);
+			Buffer += ",\"offset\":";
+			AppendDec(Archive.GetDataOffset(i), 0);
+			Buffer += ",\"uncompressed\":";
+			AppendDec(Archive.GetUncompressSize(i), 0);
+			Buffer += ",\"compressed\":";
+			AppendDec(Archive.GetCompressSize(i), 0);
+			Buffer += ",\"flag\":\"";
+			Buffer += Flag;
+			Buffer += "\",\"path\":";
+			AppendQuoted(Archive.GetNestedPath() + Archive.GetPath(i), LF_JSONL);
+			Buffer += "}\n";
+		break;
+
+		case LF_BINARY:
+		{
+			AppendDword(i);
+			AppendDword(Archive.GetDataOffset(i));
+			AppendDword(Archive.GetCompressSize(i));
+			AppendDword(Archive.GetUncompressSize(i));
+			AppendDword(Archive.GetCompressFlag(i));
+			std::string Path = Archive.GetPath(i);
+			Path.resize(250);
+			Buffer += Path;
+		}
+		break;
+	}
+	CheckLimit();
+}
+/// \brief Adding arbitrary text to the listing (keeps order with the rest of output)
+/// \param[in] local_Input Text
+void FstListing::WriteText(std::string local_Input)
+{
+	Buffer += local_Input;
+	CheckLimit();
+}
+/// \brief Writing formatted data to the console
+void FstListing::Flush()
+{
+	if(Buffer.empty())
+		return;
+	std::cout.write(Buffer.data(), static_cast<std::streamsize>(Buffer.size()));
+	std::cout.flush();
+	Buffer.erase(Buffer.begin(), Buffer.end());
+}
+/// \brief Writing formatted data to the console if buffer is full
+void FstListing::CheckLimit()
+{
+	if(Buffer.size() >= BufferLimit)
+		Flush();
+}
+/// \brief Adding decimal number followed by gap (same as Gap function)
+/// \param[in] local_Input Number
+/// \param[in] Size Size of gap (0 - no gap)
+void FstListing::AppendDec(cnv::qword local_Input, cnv::unsint Size)
+{
+	char Digits[24];
+	cnv::unsint j = 0;
+	do
+	{
+		Digits[j++] = static_cast<char>('0' + local_Input % 10);
+		local_Input /= 10;
+	}
+	while(local_Input != 0);
+	for(cnv::unsint k = j; k != 0; k--)
+	{
+		Buffer += Digits[k - 1];
+	}
+	if(Size != 0 && Size + 1 > j)
+		Buffer.append(Size + 1 - j, ' ');
+}
+/// \brief Adding hexadecimal number followed by gap (same as Gap16 function)
+/// \param[in] local_Input Number
+/// \param[in] Size Size of gap (0 - no gap)
+void FstListing::AppendHex(cnv::qword local_Input, cnv::unsint Size)
+{
+	const char HexDigits[] = "0123456789abcdef";
+	char Digits[24];
+	cnv::unsint j = 0;
+	do
+	{
+		Digits[j++] = HexDigits[local_Input % 16];
+		local_Input /= 16;
+	}
+	while(local_Input != 0);
+	for(cnv::unsint k = j; k != 0; k--)
+	{
+		Buffer += Digits[k - 1];
+	}
+	if(Size != 0 && Size + 1 > j)
+		Buffer.append(Size + 1 - j, ' ');
+}
+/// \brief Adding DWORD as 4 bytes (little-endian)
+/// \param[in] local_Input Value (values of extended archives larger than DWORD are written as 0xFFFFFFFF)
+void FstListing::AppendDword(cnv::qword local_Input)
+{
+	if(local_Input > 0xFFFFFFFFULL)
+		local_Input = 0xFFFFFFFFULL;
+	for(int j = 0; j < 4; j++)
+	{
+		Buffer += static_cast<char>(static_cast<cnv::byte>(local_Input >> 8 * j));
+	}
+}
+/// \brief Adding string in quotes with escaping for the format
+/// \param[in] local_Input String
+/// \param[in] Mode LF_CSV or LF_JSONL
+void FstListing::AppendQuoted(std::string local_Input, char Mode)
+{
+	const char HexDigits[] = "0123456789abcdef";
+	Buffer += '"';
+	for(cnv::unsint i = 0; i < local_Input.size(); i++)
+	{
+		char Symbol = local_Input.at(i);
+		if(Mode == LF_CSV)
+		{
+			if(Symbol == '"')
+				Buffer += '"';
+			Buffer += Symbol;
+		}
+		else if(Symbol == '"' || Symbol == '\\')
+		{
+			Buffer += '\\';
+			Buffer += Symbol;
+		}
+		else if(static_cast<cnv::byte>(Symbol) < 0x20)
+		{
+			Buffer += "\\u00";
+			Buffer += HexDigits[static_cast<cnv::byte>(Symbol) >> 4];
+			Buffer += HexDigits[static_cast<cnv::byte>(Symbol) & 0x0F];
+		}
+		else
+		{
+			Buffer += Symbol;
+		}
+	}
+	Buffer += '"';
+}
+/// \brief Adding size in kilobytes or megabytes (if size is more than 1 KB)
+/// \param[in] local_Input Size in bytes
+void FstListing::AppendSize(cnv::qword local_Input)
+{
+	char Text[32];
+	float kbytes = local_Input/1024.0f;
+	float mbytes = kbytes/1024.0f;
+	if(mbytes > 1)
+	{
+		snprintf(Text, sizeof(Text), "%g MB", static_cast<double>(mbytes));
+		Buffer += Text;
+	}
+	else if(kbytes > 1)
+	{
+		snprintf(Text, sizeof(Text), "%g KB", static_cast<double>(kbytes));
+		Buffer += Text;
+	}
+}
+
+
+/// \brief Get listing format from its name
+/// \param[in] local_Input Name of format (table, csv, jsonl, bin)
+/// \return Listing format (ListFormat) or -1 if name is unknown
+int GetFormatFromName(std::string local_Input)
+{
+	std::transform(local_Input.begin(), local_Input.end(), local_Input.begin(), ::tolower);
+	const int Formats = 4;
+	std::string NameArray[Formats] = {"table", "csv", "jsonl", "bin"};
+	int ModeArray[Formats] = {LF_TABLE, LF_CSV, LF_JSONL, LF_BINARY};
+	for(int i = 0; i < Formats; i++)
+	{
+		if(local_Input == NameArray[i])
+		{
+			return ModeArray[i];
+		}
+	}
+	return -1;
+}
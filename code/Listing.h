@@ -0,0 +1,74 @@
+/// \file
+/// \brief Listing module (Header)
+/// \author SpinelDusk
+
+#pragma GCC diagnostic ignored "-Wpadded"						//Disable warning: Padding class -- with -- byte to align --
+
+#pragma once//This header guard directive designed to cause the current source file to be included only once in a single compilation
+#ifndef ListingH
+#define ListingH
+
+#include <string>
+#include <iostream>
+#include <fcntl.h>		// _O_BINARY
+#include <io.h>			// _setmode
+#pragma hdrstop//This directive terminates the list of header files eligible for precompilation (Using ONLY for <standard> headers, no "custom")
+
+#include "FstFile.h"
+
+/// \brief Enumeration of listing formats
+enum ListFormat
+{
+	LF_TABLE = 0,	///< Human readable table (console)
+	LF_CSV = 1,		///< Comma separated values, one row per entry
+	LF_JSONL = 2,	///< JSON Lines, one object per entry
+	LF_BINARY = 3	///< Fixed-width binary records
+};
+
+/// \brief The class formats table of contents of FST file into a memory buffer and writes it to the console in large blocks
+/// \details Binary format: signature "FSTL", DWORD version, DWORD amount of entries, DWORD record size,
+/// then records of DWORD index, DWORD data offset, DWORD compressed size, DWORD uncompressed size, DWORD compression flag and 250 bytes of path.
+/// All numbers are little-endian
+class FstListing
+{
+	private:
+	/// \brief Active listing format (ListFormat)
+	cnv::unsint Format;
+	/// \brief Formatted data which is not yet written
+	std::string Buffer;
+
+	public:
+	FstListing()
+	{
+		Format = LF_TABLE;
+		Buffer.reserve(BufferLimit * 2);
+	}
+	~FstListing()
+	{
+		Flush();
+	}
+
+	/// \brief Size of buffer after which data is written to the console
+	static const cnv::unsint BufferLimit = 1024*256;//256 KB
+
+	/// \brief Set listing format (ListFormat)
+	void SetFormat(cnv::unsint local_Input){Format = local_Input;}
+	/// \brief Get listing format (ListFormat)
+	cnv::unsint GetFormat(){return Format;}
+
+	void WriteHead(FstUnpack&);
+	void WriteEntry(FstUnpack&, cnv::unsint);
+	void WriteText(std::string);
+	void Flush();
+
+	private:
+	void AppendDec(cnv::qword, cnv::unsint);
+	void AppendHex(cnv::qword, cnv::unsint);
+	void AppendDword(cnv::qword);
+	void AppendQuoted(std::string, char);
+	void AppendSize(cnv::qword);
+	void CheckLimit();
+};
+
+int GetFormatFromName(std::string);
+#endif
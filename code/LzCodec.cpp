@@ -0,0 +1,596 @@
+/// \file
+/// \brief LZ codec module
+/// \author SpinelDusk
+/// \details Native implementation of LZ compression with shared dictionary support. It is used only for entries compressed
+/// with shared dictionary, other entries are compressed and decoded by LzSubroutine.dll
+
+#pragma GCC diagnostic ignored "-Wc++98-compat"					//Disable warning: 'nullptr' is incompatible with C++98
+
+#pragma package(smart_init)//Ensures that packaged units are initialized in the order determined by their dependencies
+
+#include "LzCodec.h"
+
+/// \brief Code which resets table of codes
+const cnv::unsint ClearCode = 0x100;
+/// \brief Code which marks end of stream
+const cnv::unsint EndCode = 0x101;
+/// \brief First code which is free for strings
+const cnv::unsint FirstCode = 0x102;
+/// \brief Size of table of codes (maximum width of code - 12 bits)
+const cnv::unsint TableSize = 0x1000;
+/// \brief Maximum width of code in bits
+const cnv::unsint MaxBits = 12;
+/// \brief Limit of codes filled by dictionary (rest of table is left to data of entry)
+const cnv::unsint PrimeLimit = 0xC00;
+/// \brief Size of hash table of encoder (power of two, greater than table of codes)
+const cnv::unsint HashSize = 0x2000;
+/// \brief Size of block of compressed data read by range decoding
+const cnv::unsint RangeBlockSize = 0x10000;
+
+/// \brief Table of codes of encoder (searching code of string by prefix code and last character)
+struct EncoderTable
+{
+	cnv::dword Key[HashSize];///< Prefix code and character of string (plus one, 0 - empty slot)
+	cnv::word Code[HashSize];///< Code of string
+	cnv::unsint NextFree;///< First free code
+	void Reset(const lzc::Dictionary* Dict)
+	{
+		memset(Key, 0, sizeof(Key));
+		NextFree = FirstCode;
+		if(Dict != nullptr)
+		{
+			for(cnv::unsint i = FirstCode; i < Dict->Primed; i++)
+			{
+				Add(Dict->Prefix.at(i), Dict->Suffix.at(i));
+			}
+		}
+	}
+	cnv::unsint Slot(cnv::dword local_Key) const
+	{
+		cnv::unsint local_Output = (local_Key * 2654435761u) & (HashSize - 1);
+		while(Key[local_Output] != 0 && Key[local_Output] != local_Key)
+		{
+			local_Output = (local_Output + 1) & (HashSize - 1);
+		}
+		return local_Output;
+	}
+	bool Find(cnv::unsint Prefix, cnv::byte Character, cnv::unsint& local_Output) const
+	{
+		cnv::unsint Index = Slot(((static_cast<cnv::dword>(Prefix) << 8) | Character) + 1);
+		if(Key[Index] == 0)
+		{
+			return false;
+		}
+		local_Output = Code[Index];
+		return true;
+	}
+	void Add(cnv::unsint Prefix, cnv::byte Character)
+	{
+		cnv::dword local_Key = ((static_cast<cnv::dword>(Prefix) << 8) | Character) + 1;
+		cnv::unsint Index = Slot(local_Key);
+		Key[Index] = local_Key;
+		Code[Index] = static_cast<cnv::word>(NextFree);
+		NextFree++;
+	}
+};
+
+
+/// \brief Get width of codes for first free code of table (width grows when free code reaches its limit)
+/// \param[in] NextFree First free code
+/// \param[out] Limit Limit of codes of this width
+/// \return Width of codes in bits
+static cnv::unsint GetCodeBits(cnv::unsint NextFree, cnv::unsint& Limit)
+{
+	cnv::unsint local_Output = 9;
+	Limit = 0x200;
+	while(NextFree >= Limit && local_Output < MaxBits)
+	{
+		local_Output++;
+		Limit *= 2;
+	}
+	return local_Output;
+}
+/// \brief Get maximum size of compressed data
+/// \param[in] Size Size of uncompressed data
+/// \return Maximum size of compressed data (every byte may take up to 12 bits)
+cnv::qword lzc::CompressBound(cnv::qword Size)
+{
+	return Size * 3 / 2 + 16;
+}
+/// \brief Compress data
+/// \param[in] local_Input Uncompressed data
+/// \param[in] Size Size of uncompressed data
+/// \param[out] local_Output Compressed data
+/// \param[in] Dict Shared dictionary (or nullptr - no dictionary: native stream, not read by the library)
+/// \details Encoder follows width of codes of decoder, which adds string to table one code later than encoder
+void lzc::Compress(const cnv::byte* local_Input, cnv::qword Size, std::vector<cnv::byte>& local_Output, const Dictionary* Dict)
+{
+	EncoderTable* Table = new EncoderTable;
+	cnv::unsint Primed = Dict != nullptr ? Dict->Primed : FirstCode;
+	cnv::qword Buffer = 0;
+	cnv::unsint BufferBits = 0;
+	cnv::unsint DecoderFree = Primed;
+	cnv::unsint Limit = 0;
+	cnv::unsint Bits = GetCodeBits(DecoderFree, Limit);
+	bool FirstAfterClear = true;
+	local_Output.clear();
+	local_Output.reserve(static_cast<size_t>(CompressBound(Size)));
+	auto PutCode = [&](cnv::unsint Code)
+	{
+		Buffer |= static_cast<cnv::qword>(Code) << BufferBits;
+		BufferBits += Bits;
+		while(BufferBits >= 8)
+		{
+			local_Output.push_back(static_cast<cnv::byte>(Buffer));
+			Buffer >>= 8;
+			BufferBits -= 8;
+		}
+	};
+	auto PutString = [&](cnv::unsint Code)
+	{
+		PutCode(Code);
+		if(!FirstAfterClear)
+		{
+			DecoderFree++;
+			if(DecoderFree >= Limit && Bits < MaxBits)
+			{
+				Bits++;
+				Limit *= 2;
+			}
+		}
+		FirstAfterClear = false;
+	};
+	auto PutClear = [&]()
+	{
+		PutCode(ClearCode);
+		Table->Reset(Dict);
+		DecoderFree = Primed;
+		Bits = GetCodeBits(DecoderFree, Limit);
+		FirstAfterClear = true;
+	};
+	PutClear();
+	if(Size > 0)
+	{
+		cnv::unsint Prefix = local_Input[0];
+		for(cnv::qword i = 1; i < Size; i++)
+		{
+			cnv::unsint Code = 0;
+			if(Table->Find(Prefix, local_Input[i], Code))
+			{
+				Prefix = Code;
+				continue;
+			}
+			PutString(Prefix);
+			Table->Add(Prefix, local_Input[i]);
+			Prefix = local_Input[i];
+			if(Table->NextFree >= TableSize)
+			{
+				PutClear();
+			}
+		}
+		PutString(Prefix);
+	}
+	PutCode(EndCode);
+	if(BufferBits > 0)
+	{
+		local_Output.push_back(static_cast<cnv::byte>(Buffer));
+	}
+	delete Table; Table = nullptr;
+}
+/// \brief Table of codes of decoder (every code is string: prefix code plus last character)
+struct DecoderTable
+{
+	std::vector<cnv::word> Prefix;///< Prefix code of every code
+	std::vector<cnv::byte> Suffix;///< Last character of every code
+	std::vector<cnv::byte> First;///< First character of string of every code
+	std::vector<cnv::word> Length;///< Length of string of every code
+	cnv::unsint Primed;///< First free code after clear code
+	DecoderTable(const lzc::Dictionary* Dict) : Prefix(TableSize), Suffix(TableSize), First(TableSize), Length(TableSize)
+	{
+		for(cnv::unsint i = 0; i < ClearCode; i++)
+		{
+			Suffix.at(i) = static_cast<cnv::byte>(i);
+			First.at(i) = static_cast<cnv::byte>(i);
+			Length.at(i) = 1;
+		}
+		Primed = FirstCode;
+		if(Dict != nullptr)
+		{
+			Primed = Dict->Primed;
+			for(cnv::unsint i = FirstCode; i < Primed; i++)
+			{
+				Prefix.at(i) = Dict->Prefix.at(i);
+				Suffix.at(i) = Dict->Suffix.at(i);
+				First.at(i) = First.at(Prefix.at(i));
+				Length.at(i) = static_cast<cnv::word>(Length.at(Prefix.at(i)) + 1);
+			}
+		}
+	}
+};
+/// \brief Result of writing decoded string: 0 - continue, 1 - error, 2 - all needed data is written (decoding stops)
+enum PutResult {PR_CONTINUE = 0, PR_ERROR = 1, PR_DONE = 2};
+
+/// \brief Input of decoder from compressed data in memory
+struct ArrayReader
+{
+	const cnv::byte* Input;///< Compressed data
+	cnv::qword Size;///< Size of compressed data
+	cnv::qword Position;///< Position of next byte
+	bool Next(cnv::byte& local_Output)
+	{
+		if(Position >= Size)
+		{
+			return false;
+		}
+		local_Output = Input[Position++];
+		return true;
+	}
+};
+/// \brief Input of decoder read by blocks on demand (data after the needed range is never read)
+struct BlockReader
+{
+	std::function<cnv::qword(cnv::byte*, cnv::qword)> Read;///< Function filling block (returns 0 at the end of data)
+	std::vector<cnv::byte> Block;///< Current block
+	cnv::qword Filled;///< Bytes in current block
+	cnv::qword Position;///< Position of next byte in block
+	bool Next(cnv::byte& local_Output)
+	{
+		if(Position == Filled)
+		{
+			Filled = Read(Block.data(), Block.size());
+			Position = 0;
+			if(Filled == 0)
+			{
+				return false;
+			}
+		}
+		local_Output = Block[Position++];
+		return true;
+	}
+};
+/// \brief Output of decoder into buffer of whole uncompressed data
+struct BufferWriter
+{
+	cnv::byte* Output;///< Buffer for uncompressed data
+	cnv::qword Size;///< Size of buffer (nothing is written past it)
+	cnv::qword Decoded;///< Size of written data
+	int Put(const DecoderTable& Table, cnv::unsint Code)
+	{
+		if(Table.Length[Code] > Size - Decoded)
+		{
+			return PR_ERROR;
+		}
+		//Copy string of code to output (from last character to first)
+		Decoded += Table.Length[Code];
+		cnv::qword Position = Decoded;
+		while(Code >= ClearCode)
+		{
+			Output[--Position] = Table.Suffix[Code];
+			Code = Table.Prefix[Code];
+		}
+		Output[--Position] = static_cast<cnv::byte>(Code);
+		return PR_CONTINUE;
+	}
+	int PutByte(cnv::byte Character)
+	{
+		if(Decoded == Size)
+		{
+			return PR_ERROR;
+		}
+		Output[Decoded++] = Character;
+		return PR_CONTINUE;
+	}
+};
+/// \brief Output of decoder passed to receiver by blocks (only one block of uncompressed data is kept in memory)
+struct StreamWriter
+{
+	std::function<bool(const cnv::byte*, cnv::qword)> Write;///< Receiver of filled block (returns false on error)
+	std::vector<cnv::byte> Block;///< Current block (longer than the longest string of the table)
+	cnv::qword Filled;///< Bytes in current block
+	cnv::qword Size;///< Size of uncompressed data (nothing is written past it)
+	cnv::qword Decoded;///< Size of decoded data (written or waiting in current block)
+	bool Flush()
+	{
+		if(Filled == 0)
+		{
+			return true;
+		}
+		cnv::qword Part = Filled;
+		Filled = 0;
+		return Write(Block.data(), Part);
+	}
+	int Put(const DecoderTable& Table, cnv::unsint Code)
+	{
+		cnv::qword Length = Table.Length[Code];
+		if(Length > Size - Decoded)
+		{
+			return PR_ERROR;
+		}
+		if(Length > Block.size() - Filled && !Flush())
+		{
+			return PR_ERROR;
+		}
+		//Copy string of code to block (from last character to first)
+		Decoded += Length;
+		Filled += Length;
+		cnv::qword Position = Filled;
+		while(Code >= ClearCode)
+		{
+			Block[--Position] = Table.Suffix[Code];
+			Code = Table.Prefix[Code];
+		}
+		Block[--Position] = static_cast<cnv::byte>(Code);
+		return PR_CONTINUE;
+	}
+	int PutByte(cnv::byte Character)
+	{
+		if(Decoded == Size || (Filled == Block.size() && !Flush()))
+		{
+			return PR_ERROR;
+		}
+		Block[Filled++] = Character;
+		Decoded++;
+		return PR_CONTINUE;
+	}
+};
+/// \brief Output of decoder keeping only range [Offset, Offset + Size) of uncompressed data
+struct RangeWriter
+{
+	cnv::byte* Output;///< Buffer for the range
+	cnv::qword Offset;///< Offset of the range in uncompressed data
+	cnv::qword Size;///< Size of the range
+	cnv::qword Position;///< Size of decoded data (written or skipped)
+	int Put(const DecoderTable& Table, cnv::unsint Code)
+	{
+		cnv::qword Begin = Position;
+		Position += Table.Length[Code];
+		//Strings before the range are skipped without walking their chain of codes
+		if(Position <= Offset)
+		{
+			return PR_CONTINUE;
+		}
+		cnv::qword Index = Position;
+		while(true)
+		{
+			cnv::byte Character = (Code >= ClearCode) ? Table.Suffix[Code] : static_cast<cnv::byte>(Code);
+			Index--;
+			if(Index >= Offset && Index - Offset < Size)
+			{
+				Output[Index - Offset] = Character;
+			}
+			if(Code < ClearCode || Index <= Offset || Index == Begin)
+			{
+				break;
+			}
+			Code = Table.Prefix[Code];
+		}
+		return (Position - Offset >= Size) ? PR_DONE : PR_CONTINUE;
+	}
+	int PutByte(cnv::byte Character)
+	{
+		if(Position >= Offset && Position - Offset < Size)
+		{
+			Output[Position - Offset] = Character;
+		}
+		Position++;
+		return (Position > Offset && Position - Offset >= Size) ? PR_DONE : PR_CONTINUE;
+	}
+};
+/// \brief Decoding stream of codes
+/// \param[in,out] Input Source of compressed bytes (ArrayReader or BlockReader)
+/// \param[in,out] Output Receiver of decoded strings (BufferWriter or RangeWriter)
+/// \param[in,out] Table Table of codes (initialized for the dictionary)
+/// \return Error code: 0 - no errors (end of stream or receiver is done), 1 - operation error (damaged stream)
+template<class Reader, class Writer> static int DecodeStream(Reader& Input, Writer& Output, DecoderTable& Table)
+{
+	cnv::qword Buffer = 0;
+	cnv::unsint BufferBits = 0;
+	cnv::unsint NextFree = Table.Primed;
+	cnv::unsint Limit = 0;
+	cnv::unsint Bits = GetCodeBits(NextFree, Limit);
+	cnv::unsint OldCode = 0;
+	bool FirstAfterClear = true;
+	while(true)
+	{
+		cnv::byte Next = 0;
+		while(BufferBits < Bits && Input.Next(Next))
+		{
+			Buffer |= static_cast<cnv::qword>(Next) << BufferBits;
+			BufferBits += 8;
+		}
+		if(BufferBits < Bits)
+		{
+			break;//Stream without end code
+		}
+		cnv::unsint Code = static_cast<cnv::unsint>(Buffer & ((1u << Bits) - 1));
+		Buffer >>= Bits;
+		BufferBits -= Bits;
+		if(Code == EndCode)
+		{
+			break;
+		}
+		if(Code == ClearCode)
+		{
+			NextFree = Table.Primed;
+			Bits = GetCodeBits(NextFree, Limit);
+			FirstAfterClear = true;
+			continue;
+		}
+		int Result = PR_CONTINUE;
+		if(FirstAfterClear)
+		{
+			if(Code >= NextFree)
+			{
+				return 1;
+			}
+			Result = Output.Put(Table, Code);
+			if(Result != PR_CONTINUE)
+			{
+				return (Result == PR_DONE) ? 0 : 1;
+			}
+			OldCode = Code;
+			FirstAfterClear = false;
+			continue;
+		}
+		if(Code > NextFree)
+		{
+			return 1;
+		}
+		cnv::byte Character = 0;
+		if(Code == NextFree)
+		{
+			//String of previous code plus its first character
+			Character = Table.First.at(OldCode);
+			Result = Output.Put(Table, OldCode);
+			if(Result == PR_CONTINUE)
+			{
+				Result = Output.PutByte(Character);
+			}
+		}
+		else
+		{
+			Character = Table.First.at(Code);
+			Result = Output.Put(Table, Code);
+		}
+		if(Result != PR_CONTINUE)
+		{
+			return (Result == PR_DONE) ? 0 : 1;
+		}
+		if(NextFree < TableSize)
+		{
+			Table.Prefix.at(NextFree) = static_cast<cnv::word>(OldCode);
+			Table.Suffix.at(NextFree) = Character;
+			Table.First.at(NextFree) = Table.First.at(OldCode);
+			Table.Length.at(NextFree) = static_cast<cnv::word>(Table.Length.at(OldCode) + 1);
+			NextFree++;
+			if(NextFree >= Limit && Bits < MaxBits)
+			{
+				Bits++;
+				Limit *= 2;
+			}
+		}
+		OldCode = Code;
+	}
+	return 0;
+}
+/// \brief Decompress data into buffer of known size
+/// \param[in] local_Input Compressed data
+/// \param[in] InputSize Size of compressed data
+/// \param[out] local_Output Buffer for uncompressed data
+/// \param[in] OutputSize Size of buffer for uncompressed data (nothing is written past it)
+/// \param[out] Decoded Size of uncompressed data
+/// \param[in] Dict Shared dictionary (or nullptr - no dictionary: native stream, not read by the library)
+/// \return Error code: 0 - no errors, 1 - operation error (damaged stream or data doesn't fit into buffer)
+int lzc::Decompress(const cnv::byte* local_Input, cnv::qword InputSize, cnv::byte* local_Output, cnv::qword OutputSize, cnv::qword& Decoded, const Dictionary* Dict)
+{
+	DecoderTable Table(Dict);
+	ArrayReader Input = {local_Input, InputSize, 0};
+	BufferWriter Output = {local_Output, OutputSize, 0};
+	int Result = DecodeStream(Input, Output, Table);
+	Decoded = Output.Decoded;
+	return Result;
+}
+/// \brief Decompress range of uncompressed data, reading compressed data on demand
+/// \param[in] Read Function filling buffer with next compressed data (returns number of bytes, 0 - end of data)
+/// \param[in] Offset Offset of the range in uncompressed data
+/// \param[out] local_Output Buffer for the range
+/// \param[in] OutputSize Size of the range
+/// \param[out] Decoded Size of written part of the range (less than OutputSize - if stream ended before)
+/// \param[in] Dict Shared dictionary (or nullptr - no dictionary: native stream, not read by the library)
+/// \return Error code: 0 - no errors, 1 - operation error (damaged stream)
+/// \details Data before the range is decoded and discarded; decoding (and reading) stops as soon as the range is complete
+int lzc::DecompressRange(std::function<cnv::qword(cnv::byte*, cnv::qword)> Read, cnv::qword Offset, cnv::byte* local_Output, cnv::qword OutputSize, cnv::qword& Decoded, const Dictionary* Dict)
+{
+	Decoded = 0;
+	if(OutputSize == 0)
+	{
+		return 0;
+	}
+	DecoderTable Table(Dict);
+	BlockReader Input;
+	Input.Read = Read;
+	Input.Block.resize(RangeBlockSize);
+	Input.Filled = 0;
+	Input.Position = 0;
+	RangeWriter Output = {local_Output, Offset, OutputSize, 0};
+	int Result = DecodeStream(Input, Output, Table);
+	if(Output.Position > Offset)
+	{
+		Decoded = (Output.Position - Offset < OutputSize) ? Output.Position - Offset : OutputSize;
+	}
+	return Result;
+}
+/// \brief Decompress data by blocks, reading compressed data and passing uncompressed data on demand
+/// \param[in] Read Function filling buffer with next compressed data (returns number of bytes, 0 - end of data)
+/// \param[in] Write Function receiving next block of uncompressed data (returns false on error)
+/// \param[in] OutputSize Size of uncompressed data (nothing is passed past it)
+/// \param[out] Decoded Size of passed uncompressed data
+/// \param[in] Dict Shared dictionary (or nullptr - no dictionary: native stream, not read by the library)
+/// \return Error code: 0 - no errors, 1 - operation error (damaged stream, data larger than OutputSize or error of receiver)
+/// \details Memory use doesn't depend on size of data: one block of compressed and one block of uncompressed data
+int lzc::DecompressStream(std::function<cnv::qword(cnv::byte*, cnv::qword)> Read, std::function<bool(const cnv::byte*, cnv::qword)> Write, cnv::qword OutputSize, cnv::qword& Decoded, const Dictionary* Dict)
+{
+	DecoderTable Table(Dict);
+	BlockReader Input;
+	Input.Read = Read;
+	Input.Block.resize(RangeBlockSize);
+	Input.Filled = 0;
+	Input.Position = 0;
+	StreamWriter Output;
+	Output.Write = Write;
+	Output.Block.resize(RangeBlockSize);
+	Output.Filled = 0;
+	Output.Size = OutputSize;
+	Output.Decoded = 0;
+	int Result = DecodeStream(Input, Output, Table);
+	if(!Output.Flush())
+	{
+		Result = 1;
+	}
+	Decoded = Output.Decoded;
+	return Result;
+}
+/// \brief Prime table of codes of dictionary with its data
+/// \param[in,out] Dict Dictionary (data is used, table is filled)
+/// \details Table is built the same way as encoder builds it, up to PrimeLimit codes (rest of data is ignored)
+void lzc::Prime(Dictionary& Dict)
+{
+	EncoderTable* Table = new EncoderTable;
+	Table->Reset(nullptr);
+	Dict.Prefix.assign(PrimeLimit, 0);
+	Dict.Suffix.assign(PrimeLimit, 0);
+	if(!Dict.Data.empty())
+	{
+		cnv::unsint Prefix = Dict.Data.at(0);
+		for(size_t i = 1; i < Dict.Data.size() && Table->NextFree < PrimeLimit; i++)
+		{
+			cnv::unsint Code = 0;
+			if(Table->Find(Prefix, Dict.Data.at(i), Code))
+			{
+				Prefix = Code;
+				continue;
+			}
+			Dict.Prefix.at(Table->NextFree) = static_cast<cnv::word>(Prefix);
+			Dict.Suffix.at(Table->NextFree) = Dict.Data.at(i);
+			Table->Add(Prefix, Dict.Data.at(i));
+			Prefix = Dict.Data.at(i);
+		}
+	}
+	Dict.Primed = Table->NextFree;
+	delete Table; Table = nullptr;
+}
+/// \brief Check that data looks like text
+/// \param[in] local_Input Data
+/// \param[in] Size Size of data
+/// \return true - data has no null characters
+bool lzc::IsText(const cnv::byte* local_Input, cnv::qword Size)
+{
+	for(cnv::qword i = 0; i < Size; i++)
+	{
+		if(local_Input[i] == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,43 @@
+/// \file
+/// \brief LZ codec module (Header)
+/// \author SpinelDusk
+
+#pragma GCC diagnostic ignored "-Wdocumentation-unknown-command"//Disable warning: Unknown command tag name
+#pragma GCC diagnostic ignored "-Wpadded"						//Disable warning: Padding class -- with -- byte to align --
+
+#pragma once//This header guard directive designed to cause the current source file to be included only once in a single compilation
+#ifndef LzCodecH
+#define LzCodecH
+
+#include <cstring>
+#include <vector>
+#include <functional>
+#pragma hdrstop//This directive terminates the list of header files eligible for precompilation (Using ONLY for <standard> headers, no "custom")
+
+#include "Conversion.h"
+
+namespace lzc
+{
+	/// \brief Shared dictionary: table of codes primed with sample data
+	/// \details Encoder and decoder build the same table from the same data, so only data is stored in the archive
+	struct Dictionary
+	{
+		/// \brief Sample data of the dictionary (as stored in the archive)
+		std::vector<cnv::byte> Data;
+		/// \brief First free code after priming
+		cnv::unsint Primed;
+		/// \brief Prefix code of every code of the table
+		std::vector<cnv::word> Prefix;
+		/// \brief Last character of every code of the table
+		std::vector<cnv::byte> Suffix;
+	};
+
+	cnv::qword	CompressBound(cnv::qword);
+	void		Compress(const cnv::byte*, cnv::qword, std::vector<cnv::byte>&, const Dictionary* = nullptr);
+	int			Decompress(const cnv::byte*, cnv::qword, cnv::byte*, cnv::qword, cnv::qword&, const Dictionary* = nullptr);
+	int			DecompressRange(std::function<cnv::qword(cnv::byte*, cnv::qword)>, cnv::qword, cnv::byte*, cnv::qword, cnv::qword&, const Dictionary* = nullptr);
+	int			DecompressStream(std::function<cnv::qword(cnv::byte*, cnv::qword)>, std::function<bool(const cnv::byte*, cnv::qword)>, cnv::qword, cnv::qword&, const Dictionary* = nullptr);
+	void		Prime(Dictionary&);
+	bool		IsText(const cnv::byte*, cnv::qword);
+}
+#endif
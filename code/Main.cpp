@@ -19,19 +19,47 @@ bool IgnorePause = 0;
 bool IgnoreInfo = 0;
 /// \brief Program flag responsible for storing the value of modifier setting error
 bool InvalidMod = 0;
+/// \brief Program flag responsible for machine-readable output (exit message is skipped on success)
+bool ScriptOutput = 0;
+/// \brief Program flag responsible for traversal of archives nested into the archive (--nested option)
+bool NestedMode = 0;
 /// \brief Program build number (date of compilation in format YYMMDD)
 int  Build = 220718;
 /// \brief Program version number (sequence version)
-std::string Version = "1.0.0";
+std::string Version = "1.1.0";
 /// \brief Instance of class that handles all processes for unpacking an archive
 FstUnpack FstUObject;
 /// \brief Instance of class that handles all processes for packing into an archive
 FstPack   FstPObject;
+/// \brief Instance of class that handles all processes for comparing two archives
+FstDiff   FstDObject;
+/// \brief Instance of class that handles all processes for creating and applying patches
+FstPatch  FstTObject;
+/// \brief Instance of class that handles all processes for classifying contents of an archive
+FstCensus FstNObject;
+/// \brief Instance of class that handles all processes for indexing paths of many archives
+FstIndex  FstIObject;
+/// \brief Instance of class that handles all processes for searching contents of an archive
+FstGrep   FstGObject;
+/// \brief Instance of class that handles all processes for analysis of data layout and compaction of an archive
+FstCompact FstKObject;
+/// \brief Instance of class that handles all processes for editing single entry of an archive in place
+FstEdit   FstJObject;
+/// \brief Instance of class that formats table of contents for output
+FstListing Listing;
+/// \brief Long options of the command line (--name or --name=value), removed from the list of arguments
+std::vector<std::string> OptionList;
+/// \brief File stream for access trace of the unpacking instance (--trace option)
+ofstream TraceFile;
+/// \brief Path to event trace file (--events option)
+std::string EventsPath;
+/// \brief Flag of showing peak memory at the end of the run (memory budget is set)
+bool MemoryReport = 0;
 
 /// \brief Gap setting for correct display of output information. Decimal numbers
 /// \param[in] local_Input Number on which the gap is based
 /// \param[in] Size Size of gap
-void Gap(cnv::dword local_Input, cnv::unsint Size)
+void Gap(cnv::qword local_Input, cnv::unsint Size)
 {
 	if(Size == 0 || Size > 250)
 	{
@@ -40,19 +68,19 @@ void Gap(cnv::dword local_Input, cnv::unsint Size)
 	cnv::unsint j = 0;
 	while(local_Input >= 10)
 	{
-		local_Input = static_cast<cnv::dword>(local_Input / 10);
+		local_Input = local_Input / 10;
 		j++;
 	}
-	for(cnv::unsint i = j; i < Size; i++)
+	if(j < Size)
 	{
-		std::cout << " ";
+		std::cout << std::string(Size - j, ' ');
 	}
 	return;
 }
 /// \brief Gap setting for correct display of output information. Hexadecimal numbers
 /// \param[in] local_Input Number on which the gap is based
 /// \param[in] Size Size of gap
-void Gap16(cnv::dword local_Input, cnv::unsint Size)
+void Gap16(cnv::qword local_Input, cnv::unsint Size)
 {
 	if(Size == 0 || Size > 250)
 	{
@@ -61,32 +89,311 @@ void Gap16(cnv::dword local_Input, cnv::unsint Size)
 	cnv::unsint j = 0;
 	while(local_Input >= 16)
 	{
-		local_Input = static_cast<cnv::dword>(local_Input / 16);
+		local_Input = local_Input / 16;
 		j++;
 	}
-	for(cnv::unsint i = j; i < Size; i++)
+	if(j < Size)
 	{
-		std::cout << " ";
+		std::cout << std::string(Size - j, ' ');
 	}
 	return;
 }
 /// \brief Displaying information about archive header
 void ArchiveHead()
 {
+	Listing.WriteHead(FstUObject);
+}
+/// \brief Displaying information about archive entry
+/// \param[in] i Ordinal number of entry in file
+void ArchiveEntry(cnv::unsint i)
+{
+	Listing.WriteEntry(FstUObject, i);
+}
+/// \brief Displaying information about archive header and all entries
+void ArchiveTable()
+{
+	ArchiveHead();
+	for(cnv::unsint i = 0; i < FstUObject.GetAmountEntries(); i++)
+	{
+		ArchiveEntry(i);
+	}
+	Listing.Flush();
+}
+/// \brief Displaying tables of all archives nested into the loaded archive
+/// \return Error code: 0 - no errors, 1 - operation error
+/// \details Table shows header of every nested archive, CSV and JSON Lines continue the list of entries with paths
+/// prefixed by path of nested archive. Binary listing keeps only entries of the loaded archive (their amount is in its header)
+int NestedTable()
+{
+	if(Listing.GetFormat() == LF_BINARY)
+	{
+		return 0;
+	}
+	int Result = FstUObject.ForEachNested([](FstUnpack& Nested) -> int
+	{
+		if(Listing.GetFormat() == LF_TABLE)
+		{
+			Listing.WriteText("\n");
+			Listing.WriteHead(Nested);
+		}
+		for(cnv::unsint i = 0; i < Nested.GetAmountEntries(); i++)
+		{
+			Listing.WriteEntry(Nested, i);
+		}
+		return 0;
+	});
+	Listing.Flush();
+	NestedReport();
+	return Result;
+}
+/// \brief Unpacking all archives nested into the loaded archive (each into output directory beside its file-entry)
+/// \return Error code: 0 - no errors, 1 - operation error
+int UnpackNested()
+{
+	int Result = FstUObject.ForEachNested([](FstUnpack& Nested) -> int
+	{
+		if(IgnoreInfo)
+		{
+			std::cout << std::endl << "NestedArchive  : " << Nested.GetArchivePath();
+		}
+		return Nested.UnpackEntireArchive();
+	});
+	NestedReport();
+	return Result;
+}
+/// \brief Displaying nested archives skipped by the last traversal (damaged or failed ones)
+void NestedReport()
+{
+	for(cnv::unsint i = 0; i < FstUObject.GetAmountNestedReport(); i++)
+	{
+		std::cout << std::endl << FstUObject.GetNestedReportLine(i);
+	}
+	if(FstUObject.GetAmountNestedReport() != 0)
+	{
+		std::cout << std::endl;
+	}
+}
+/// \brief Displaying all information about archive
+/// \param[in] local_Input Path to archive to be read
+/// \return Error code: 0 - no errors, 1 - operation error
+int Show(char* local_Input)
+{
+	if(FstUObject.Load(local_Input))
+	{
+		return 1;
+	}
+	ArchiveTable();
+	if(NestedMode && NestedTable())
+	{
+		return 1;
+	}
+	return 0;
+}
+/// \brief Show amount of file-entries skipped by unpacking (completed by previous run or unchanged)
+void SkippedInfo()
+{
+	if(!IgnoreInfo && (FstUObject.GetResume() || FstUObject.GetIncremental() != IM_NONE))
+	{
+		std::cout << std::endl << "Skipped        : " << FstUObject.GetAmountSkipped() << " of " << FstUObject.GetAmountEntries()
+			<< " entries (" << (FstUObject.GetIncremental() != IM_NONE ? "unchanged files" : "completed by previous run") << ")" << std::endl;
+	}
+}
+/// \brief Unpack entire archive
+/// \param[in] local_Input Path to archive to be unpacked
+/// \return Error code: 0 - no errors, 1 - operation error
+int Unpack(char* local_Input)
+{
+	if(FstUObject.Load(local_Input))
+	{
+		return 1;
+	}
+	if(!IgnoreInfo)
+	{
+		ArchiveTable();
+		if(NestedMode && NestedTable())
+		{
+			return 1;
+		}
+	}
+	else
+	{
+		std::cout << "ArchivePath    : " << FstUObject.GetArchivePath();
+	}
+	if(FstUObject.UnpackEntireArchive() == 1)
+	{
+		return 1;
+	}
+	if(NestedMode && UnpackNested())
+	{
+		return 1;
+	}
+	SkippedInfo();
+	return 0;
+}
+/// \brief Extract single file from archive
+/// \param[in] local_Input Path to archive to be unpacked
+/// \param[in] i Ordinal number of entry in file
+/// \return Error code: 0 - no errors, 1 - operation error, 2 - invalid ordinal number
+int Extract(char* local_Input, cnv::unsint i)
+{
+	if(FstUObject.Load(local_Input))
+	{
+		return 1;
+	}
+	if(i < FstUObject.GetAmountEntries() && FstUObject.GetCompressFlag(i) != 2)
+	{
+		if(!IgnoreInfo)
+		{
+			ArchiveHead();
+			ArchiveEntry(i);
+			Listing.Flush();
+		}
+		else
+		{
+			std::cout << "ArchivePath    : " << FstUObject.GetArchivePath();
+		}
+		if(FstUObject.ExtractFromArchive(i) == 1)
+		{
+			return 1;
+		}
+	}
+	else
+	{
+		std::cout << "Error. Invalid input value." << std::endl;
+		return 2;
+	}
+	return 0;
+}
+/// \brief Extract range of bytes of a file-entry into a separate file
+/// \param[in] local_Input Path to archive
+/// \param[in] i Ordinal number of the file-entry
+/// \param[in] local_Range Range in form OFFSET:LENGTH (length is cut at the end of file-entry)
+/// \param[in] local_Output Path to output file
+/// \return Error code: 0 - no errors, 1 - operation error, 2 - invalid input value
+int Range(char* local_Input, cnv::unsint i, std::string local_Range, char* local_Output)
+{
+	std::string::size_type Position = local_Range.find(':');
+	if(Position == std::string::npos || Position == 0 || Position + 1 == local_Range.size() ||
+		local_Range.find_first_not_of("0123456789:") != std::string::npos || local_Range.find(':', Position + 1) != std::string::npos)
+	{
+		std::cout << "Error. Invalid range (OFFSET:LENGTH expected): " << local_Range << std::endl;
+		return 2;
+	}
+	cnv::qword Offset = strtoull(local_Range.data(), nullptr, 10);
+	cnv::qword Length = strtoull(local_Range.data() + Position + 1, nullptr, 10);
+	if(FstUObject.Load(local_Input))
+	{
+		return 1;
+	}
+	if(i >= FstUObject.GetAmountEntries() || Offset > FstUObject.GetUncompressSize(i))
+	{
+		std::cout << "Error. Invalid input value." << std::endl;
+		return 2;
+	}
+	if(!IgnoreInfo)
+	{
+		ArchiveHead();
+		ArchiveEntry(i);
+		Listing.Flush();
+	}
+	ifstream Archive(FstUObject.GetArchivePath(), ios::in|ios::binary);
+	std::vector<cnv::byte> Data;
+	if(FstUObject.ReadRange(Archive, i, Offset, Length, Data))
+	{
+		return 1;
+	}
+	Archive.close();
+	ofstream Output(local_Output, ios::out|ios::binary);
+	if(!Output.is_open())
+	{
+		std::cout << "Error. Can't open output file: " << local_Output << std::endl;
+		return 2;
+	}
+	Output.write(reinterpret_cast<const char*>(Data.data()), Data.size());
+	Output.close();
+	if(!IgnoreInfo)
+	{
+		std::cout << std::endl << "Range          : " << Data.size() << " bytes from offset " << Offset << std::endl;
+	}
+	return 0;
+}
+/// \brief Create list-file for archive
+/// \param[in] local_Input Path to archive to be listed
+/// \return Error code: 0 - no errors, 1 - operation error
+int List(char* local_Input)
+{
+	if(FstUObject.Load(local_Input))
+	{
+		return 1;
+	}
+	if(!IgnoreInfo)
+	{
+		ArchiveTable();
+	}
+	else
+	{
+		std::cout << "ArchivePath    : " << FstUObject.GetArchivePath();
+	}
+	FstUObject.CreateListFile();
+    return 0;
+}
+/// \brief Pack files into a new archive
+/// \param[in] local_Input Path to list-file for packing
+/// \param[in] local_Output Path to new created archive
+/// \return Error code: 0 - no errors, 1 - operation error
+int Pack(char* local_Input, char* local_Output)
+{
+	if(FstPObject.Pack(local_Input, local_Output))
+	{
+		//All problems found in the list-file
+		for(cnv::unsint i = 0; i < FstPObject.GetAmountReport(); i++)
+		{
+			std::cout << FstPObject.GetReportLine(i) << std::endl;
+		}
+		return 1;
+	}
+	if(FstPObject.GetDryRun())
+	{
+		DryRunInfo();
+	}
+	else if(!IgnoreInfo)
+	{
+		PackInfo(local_Output);
+	}
+	else
+	{
+        std::cout 	<< "ListPath       : " << FstPObject.GetListPath();
+    }
+	return 0;
+}
+/// \brief Information about new created archive
+/// \param[in] local_Output Path to new created archive
+void PackInfo(char* local_Output)
+{
+	//Root directory path (directory packing)
+	if(!FstPObject.GetRootPath().empty())
+		std::cout 	<< "RootPath       : " << FstPObject.GetRootPath() << std::endl;
+
+	//List Path
+	if(!FstPObject.GetListPath().empty())
+		std::cout 	<< "ListPath       : " << FstPObject.GetListPath() << std::endl;
+
 	//Archive path
-	std::cout << "ArchivePath    : " << FstUObject.GetArchivePath() << std::endl;
+	std::cout 	<< "ArchivePath    : " << FstPObject.GetArchivePath() << std::endl;
 
 	//Amount of entries
-	std::cout << "AmountEntries  : " << std::dec << FstUObject.GetAmountEntries();
-	Gap(FstUObject.GetAmountEntries(), 15);
-	std::cout << "0x" << std::hex << FstUObject.GetAmountEntries() << std::endl;
+	std::cout	<< "AmountEntries  : " << std::dec << static_cast<int>(FstPObject.GetAmountEntries());
+	Gap(FstPObject.GetAmountEntries(), 15);
+	std::cout << "0x" << std::hex << static_cast<int>(FstPObject.GetAmountEntries()) << std::endl;
 
 	//File size
-	std::cout << "FileSize       : " << std::dec << FstUObject.GetFileSize();
-	Gap(FstUObject.GetFileSize(), 15);
-	std::cout << "0x" << std::hex << FstUObject.GetFileSize() << std::dec;
-	Gap16(FstUObject.GetFileSize(), 15);
-	float kbytes = FstUObject.GetFileSize()/1024.0f;
+	std::string OutputString = local_Output;
+	cnv::qword OutputSize = chf::GetFileSize(OutputString);
+	std::cout	<< "FileSize       : " << std::dec << OutputSize;
+	Gap(OutputSize, 15);
+	std::cout << "0x" << std::hex << OutputSize << std::dec;
+	Gap16(OutputSize, 15);
+	float kbytes = OutputSize/1024.0f;
 	float mbytes = kbytes/1024.0f;
 	if(mbytes > 1)
 	{
@@ -96,249 +403,712 @@ void ArchiveHead()
 	{
 		std::cout << kbytes << " KB";
 	}
-	std::cout << std::endl << std::endl;
+	std::cout << std::endl;
+
+	//Container variant (shown only for extended archives)
+	if(FstPObject.GetFormat() == AF_FST64)
+		std::cout	<< "Format         : FST64 (extended)" << std::endl;
+
+	//Shared dictionary (shown only when it is stored in the archive)
+	if(FstPObject.GetDictionarySize() != 0)
+		std::cout	<< "Dictionary     : " << std::dec << FstPObject.GetDictionarySize() << " bytes, " << FstPObject.GetAmountDictionary()
+					<< " entries compressed with shared dictionary" << std::endl;
+
+	//Data placement by access trace (shown only when trace is set)
+	if(!FstPObject.GetTracePath().empty())
+		std::cout	<< "Placement      : " << std::dec << FstPObject.GetAmountTraced() << " of " << FstPObject.GetAmountEntries()
+					<< " entries ordered by access trace" << std::endl;
+
+	//Padding overhead (shown only when alignment is set)
+	if(FstPObject.GetAlignment() > 1)
+	{
+		std::cout	<< "Padding        : " << std::dec << FstPObject.GetPadding();
+		Gap(FstPObject.GetPadding(), 15);
+		std::cout	<< "(" << ((OutputSize != 0) ? FstPObject.GetPadding() * 100.0 / OutputSize : 0.0) << "% of file size, alignment "
+					<< FstPObject.GetAlignment() << " bytes)" << std::endl;
+	}
+	std::cout << std::endl;
 
 	//Description string for data table
-	std::cout << "Indx Extn DataOffset   (hex)        Uncomp.Size  (hex)        CompressSize (hex)        CompressFlag       Path" << std::endl;
+	std::cout	<< "Indx CF File path" << std::endl;
+
+	//Data table
+	for(cnv::dword i = 0; i < FstPObject.GetAmountEntries(); i++)
+	{
+		std::cout << std::dec << i; Gap(i, 4);
+		switch(FstPObject.GetCompressFlag(i))
+		{
+			case 0:
+				std::cout << "u  ";
+			break;
+			case 1:
+				std::cout << "c  ";
+			break;
+		}
+	   std::cout << FstPObject.GetEntryPath(i) << std::endl;
+	}
 }
-/// \brief Displaying information about archive entry
-/// \param[in] i Ordinal number of entry in file
-void ArchiveEntry(cnv::unsint i)
+/// \brief Projected result of packing (dry run)
+void DryRunInfo()
 {
-	cnv::unsint Basis = 12;
-	cnv::unsint HexBasis = Basis - 2;
+	char Buffer[64];
 
-	//Index
-	std::cout << std::dec << i; Gap(i, 4);
+	//List Path
+	std::cout 	<< "ListPath       : " << FstPObject.GetListPath() << std::endl;
 
-	//Extn
-	std::cout << GetExtFromPath(FstUObject.GetPath(i)) << "  ";
+	//Archive path
+	std::cout 	<< "ArchivePath    : " << FstPObject.GetArchivePath() << " (not created, dry run)" << std::endl;
 
-	//DataOffset
-	std::cout << std::dec << FstUObject.GetDataOffset(i); Gap(FstUObject.GetDataOffset(i), Basis);
-	std::cout << std::hex << "0x" << FstUObject.GetDataOffset(i); Gap16(FstUObject.GetDataOffset(i), HexBasis);
+	//Amount of entries
+	std::cout	<< "AmountEntries  : " << std::dec << static_cast<int>(FstPObject.GetAmountEntries());
+	Gap(FstPObject.GetAmountEntries(), 15);
+	std::cout << "0x" << std::hex << static_cast<int>(FstPObject.GetAmountEntries()) << std::dec << std::endl;
 
-	//Uncomp.Size
-	if(FstUObject.GetUncompressSize(i) == 0)
-		std::cout << "-                         ";
-	else
+	//Total size of files and projected size of the archive
+	cnv::qword SourceSize = 0;
+	for(cnv::unsint i = 0; i < FstPObject.GetAmountEntries(); i++)
+		SourceSize += FstPObject.GetUncompressSize(i);
+	std::cout	<< "SourceSize     : " << SourceSize << std::endl;
+	snprintf(Buffer, sizeof(Buffer), "%.2f", (SourceSize != 0) ? FstPObject.GetProjectedSize() * 100.0 / SourceSize : 0.0);
+	std::cout	<< "ProjectedSize  : " << FstPObject.GetProjectedSize();
+	Gap(FstPObject.GetProjectedSize(), 15);
+	std::cout	<< "(" << Buffer << "% of source size)" << std::endl;
+
+	//Shared dictionary and padding (shown only when they are used)
+	if(FstPObject.GetDictionarySize() != 0)
+		std::cout	<< "Dictionary     : " << FstPObject.GetDictionarySize() << " bytes, " << FstPObject.GetAmountDictionary()
+					<< " entries compressed with shared dictionary" << std::endl;
+	if(FstPObject.GetAlignment() > 1)
+		std::cout	<< "Padding        : " << FstPObject.GetPadding() << " (alignment " << FstPObject.GetAlignment() << " bytes)" << std::endl;
+
+	//Sampling and time
+	cnv::unsint AmountCompressed = 0;
+	for(cnv::unsint i = 0; i < FstPObject.GetAmountEntries(); i++)
+		AmountCompressed += (FstPObject.GetCompressFlag(i) == CF_COMPRESS);
+	std::cout	<< "Sampled        : " << FstPObject.GetAmountSampled() << " of " << AmountCompressed << " compressed entries" << std::endl;
+	snprintf(Buffer, sizeof(Buffer), "%.3f s (dry run took %.3f s)", FstPObject.GetEstimatedTime(), FstPObject.GetDryRunTime());
+	std::cout	<< "EstimatedTime  : " << Buffer << std::endl;
+	if(IgnoreInfo)
+		return;
+	std::cout << std::endl;
+
+	//Description string for data table ('~' - compressed size estimated by ratio of sampled entries)
+	std::cout	<< "Indx CF Uncomp.Size     Projected       Ratio   File path" << std::endl;
+
+	//Data table
+	for(cnv::unsint i = 0; i < FstPObject.GetAmountEntries(); i++)
 	{
-		std::cout << std::dec << FstUObject.GetUncompressSize(i); Gap(FstUObject.GetUncompressSize(i), Basis);
-		std::cout << std::hex << "0x" << FstUObject.GetUncompressSize(i); Gap16(FstUObject.GetUncompressSize(i), HexBasis);
+		std::cout << std::dec << i; Gap(i, 4);
+		std::cout << ((FstPObject.GetCompressFlag(i) == CF_COMPRESS) ? "c  " : "u  ");
+		std::cout << FstPObject.GetUncompressSize(i); Gap(FstPObject.GetUncompressSize(i), 15);
+		std::cout << (FstPObject.IsEstimated(i) ? "~" : " ") << FstPObject.GetCompressSize(i); Gap(FstPObject.GetCompressSize(i), 14);
+		snprintf(Buffer, sizeof(Buffer), "%.3f", (FstPObject.GetUncompressSize(i) != 0) ? static_cast<double>(FstPObject.GetCompressSize(i)) / FstPObject.GetUncompressSize(i) : 0.0);
+		std::cout << Buffer << "   " << FstPObject.GetEntryPath(i) << std::endl;
 	}
+}
+/// \brief Pack directory tree into a new archive
+/// \param[in] local_Input Path to root directory
+/// \param[in] local_Output Path to new created archive
+/// \param[in] local_Rules Path to rules file (nullptr - pack all files compressed)
+/// \return Error code: 0 - no errors, 1 - operation error
+int PackDirectory(char* local_Input, char* local_Output, char* local_Rules)
+{
+	int Result = FstPObject.PackDirectory(local_Input, local_Output, local_Rules);
 
-	//CompressSize
-	if(FstUObject.GetCompressFlag(i) == 0 || FstUObject.GetCompressFlag(i) == 2)
-		std::cout << "-                         ";
+	//Skipped files (empty files can't be stored in the archive)
+	for(cnv::unsint i = 0; i < FstPObject.GetAmountReport(); i++)
+	{
+		std::cout << FstPObject.GetReportLine(i) << std::endl;
+	}
+	if(Result)
+		return 1;
+	if(!IgnoreInfo)
+	{
+		PackInfo(local_Output);
+	}
+	return 0;
+}
+/// \brief Unpack entire archive and create list-file
+/// \param[in] local_Input Path to archive to be unpacked and listed
+/// \return Error code: 0 - no errors, 1 - operation error
+int Complex(char* local_Input)
+{
+	if(FstUObject.Load(local_Input))
+	{
+		return 1;
+	}
+	if(!IgnoreInfo)
+	{
+		ArchiveTable();
+		if(NestedMode && NestedTable())
+		{
+			return 1;
+		}
+	}
 	else
 	{
-		std::cout << std::dec << FstUObject.GetCompressSize(i); Gap(FstUObject.GetCompressSize(i), Basis);
-		std::cout << std::hex << "0x" << FstUObject.GetCompressSize(i); Gap16(FstUObject.GetCompressSize(i), HexBasis);
+		std::cout << "ArchivePath    : " << FstUObject.GetArchivePath();
+	}
+	if(FstUObject.UnpackEntireArchive() == 1)
+	{
+		return 1;
+	}
+	if(NestedMode && UnpackNested())
+	{
+		return 1;
+	}
+	SkippedInfo();
+	FstUObject.CreateListFile();
+	return 0;
+}
+/// \brief Compare two archives
+/// \param[in] local_Old Path to the old archive
+/// \param[in] local_New Path to the new archive
+/// \return Error code: 0 - no errors, 1 - operation error
+int Diff(char* local_Old, char* local_New)
+{
+	if(FstDObject.Compare(local_Old, local_New))
+	{
+		return 1;
+	}
+
+	//Repeated paths (entries with such path are aligned by order of occurrence)
+	for(cnv::unsint i = 0; i < FstDObject.GetAmountReport(); i++)
+	{
+		std::cout << FstDObject.GetReportLine(i) << std::endl;
 	}
 
-	//CompressFlag
-	if(FstUObject.GetCompressFlag(i) == 0)
-		std::cout << "U - uncompressed   ";
-	else if(FstUObject.GetCompressFlag(i) == 1)
-		std::cout << "C - compressed     ";
-	else if(FstUObject.GetCompressFlag(i) == 2)
-		std::cout << "E - empty          ";
+	//Archive paths
+	std::cout << "OldArchive     : " << FstDObject.GetOldArchivePath() << std::endl;
+	std::cout << "NewArchive     : " << FstDObject.GetNewArchivePath() << std::endl;
+
+	//Summary
+	std::cout << std::dec;
+	std::cout << "Added          : " << FstDObject.CountState(DS_ADDED) << std::endl;
+	std::cout << "Removed        : " << FstDObject.CountState(DS_REMOVED) << std::endl;
+	std::cout << "Modified       : " << FstDObject.CountState(DS_MODIFIED) << std::endl;
+	std::cout << "Unchanged      : " << FstDObject.GetAmountUnchanged();
+	Gap(FstDObject.GetAmountUnchanged(), 15);
+	std::cout << "(repacked: " << FstDObject.GetAmountRepacked() << ")" << std::endl;
+
+	if(!IgnoreInfo && FstDObject.GetAmountChanges() != 0)
+	{
+		//Description string for data table
+		std::cout << std::endl << "S  Old.Size     New.Size     Path" << std::endl;
 
-	//Path
-	std::cout << FstUObject.GetPath(i) << std::endl;
+		//Data table
+		for(cnv::unsint i = 0; i < FstDObject.GetAmountChanges(); i++)
+		{
+			std::cout << FstDObject.GetState(i) << "  ";
+			if(FstDObject.GetState(i) == DS_ADDED)
+				std::cout << "-            ";
+			else
+			{
+				std::cout << FstDObject.GetOldSize(i); Gap(FstDObject.GetOldSize(i), 12);
+			}
+			if(FstDObject.GetState(i) == DS_REMOVED)
+				std::cout << "-            ";
+			else
+			{
+				std::cout << FstDObject.GetNewSize(i); Gap(FstDObject.GetNewSize(i), 12);
+			}
+			std::cout << FstDObject.GetPath(i) << std::endl;
+		}
+	}
+	return 0;
 }
-/// \brief Displaying all information about archive
-/// \param[in] local_Input Path to archive to be read
+/// \brief Create patch from the old archive to the new one
+/// \param[in] local_Old Path to the old archive
+/// \param[in] local_New Path to the new archive
+/// \param[in] local_Output Path to the created patch
 /// \return Error code: 0 - no errors, 1 - operation error
-int Show(char* local_Input)
+int MakePatch(char* local_Old, char* local_New, char* local_Output)
 {
-	if(FstUObject.Load(local_Input))
+	if(FstTObject.Create(local_Old, local_New, local_Output))
 	{
 		return 1;
 	}
-	ArchiveHead();
-	for(cnv::unsint i = 0; i < FstUObject.GetAmountEntries(); i++)
+	std::cout << "PatchPath      : " << FstTObject.GetPatchPath() << std::endl;
+	if(!IgnoreInfo)
+	{
+		std::cout << std::dec;
+		std::cout << "Copied entries : " << FstTObject.GetAmountCopied() << std::endl;
+		std::cout << "Delta entries  : " << FstTObject.GetAmountDelta() << std::endl;
+		std::cout << "Stored entries : " << FstTObject.GetAmountStored() << std::endl;
+		std::cout << "PatchSize      : " << FstTObject.GetPatchSize();
+		Gap(FstTObject.GetPatchSize(), 15);
+		std::cout << "(target size: " << FstTObject.GetTargetSize() << ")" << std::endl;
+	}
+	return 0;
+}
+/// \brief Rebuild the new archive from the old one and the patch
+/// \param[in] local_Old Path to the old archive
+/// \param[in] local_Patch Path to the patch
+/// \param[in] local_Output Path to the rebuilt archive
+/// \return Error code: 0 - no errors, 1 - operation error
+int ApplyPatch(char* local_Old, char* local_Patch, char* local_Output)
+{
+	if(FstTObject.Apply(local_Old, local_Patch, local_Output))
+	{
+		return 1;
+	}
+	std::cout << "PatchPath      : " << FstTObject.GetPatchPath() << std::endl;
+	if(!IgnoreInfo)
+	{
+		std::cout << "ArchivePath    : " << local_Output << std::endl;
+		std::cout << "FileSize       : " << std::dec << FstTObject.GetTargetSize() << std::endl;
+	}
+	return 0;
+}
+/// \brief Classify contents of archive by signatures of file-entries
+/// \param[in] local_Input Path to archive to be classified
+/// \return Error code: 0 - no errors, 1 - operation error
+int Census(char* local_Input)
+{
+	if(FstNObject.Collect(local_Input))
+	{
+		return 1;
+	}
+
+	//File-entries which couldn't be decoded (they are not counted in totals)
+	for(cnv::unsint i = 0; i < FstNObject.GetAmountReport(); i++)
+	{
+		std::cout << FstNObject.GetReportLine(i) << std::endl;
+	}
+	std::cout << "ArchivePath    : " << FstNObject.GetArchivePath() << std::endl;
+	std::cout << "AmountEntries  : " << std::dec << FstNObject.GetAmountEntries() << std::endl << std::endl;
+
+	//Totals by type ('-' - empty entries, 'unk' - unknown signature)
+	std::cout << "Type  Entries     Uncomp.Size     CompressSize    Ratio   Ext.mismatch" << std::endl;
+	for(cnv::unsint i = 0; i < FstNObject.GetAmountTypes(); i++)
+	{
+		std::string Name = (FstNObject.GetType(i) == FM_NOTYPE) ? "-" : GetExtFromFileType(FstNObject.GetType(i));
+		std::cout << Name << std::string(6 - Name.size(), ' ');
+		std::cout << FstNObject.GetAmount(i); Gap(FstNObject.GetAmount(i), 11);
+		std::cout << FstNObject.GetUncompressSize(i); Gap(FstNObject.GetUncompressSize(i), 15);
+		std::cout << FstNObject.GetCompressSize(i); Gap(FstNObject.GetCompressSize(i), 15);
+		char Ratio[16] = "-       ";
+		if(FstNObject.GetUncompressSize(i) != 0)
+		{
+			snprintf(Ratio, sizeof(Ratio), "%5.1f%%  ", 100.0 * FstNObject.GetCompressSize(i) / FstNObject.GetUncompressSize(i));
+		}
+		std::cout << Ratio << FstNObject.GetMismatched(i) << std::endl;
+	}
+
+	//File-entries whose extension doesn't match the signature
+	if(!IgnoreInfo)
+	{
+		bool Head = false;
+		for(cnv::unsint i = 0; i < FstNObject.GetAmountEntries(); i++)
+		{
+			if(!FstNObject.IsMismatched(i))
+			{
+				continue;
+			}
+			if(!Head)
+			{
+				std::cout << std::endl << "Indx Type  Path (extension doesn't match signature)" << std::endl;
+				Head = true;
+			}
+			std::cout << i; Gap(i, 4);
+			std::string Name = GetExtFromFileType(FstNObject.GetEntryType(i));
+			std::cout << Name << std::string(6 - Name.size(), ' ') << FstNObject.GetPath(i) << std::endl;
+		}
+	}
+	return 0;
+}
+/// \brief Build or update path index of all archives under the root directory
+/// \param[in] local_Input Path to the root directory
+/// \param[in] local_Output Path to the index file
+/// \return Error code: 0 - no errors, 1 - operation error
+int BuildIndex(char* local_Input, char* local_Output)
+{
+	int Result = FstIObject.Build(local_Input, local_Output);
+
+	//Archives which couldn't be read are not indexed
+	for(cnv::unsint i = 0; i < FstIObject.GetAmountReport(); i++)
+	{
+		std::cout << FstIObject.GetReportLine(i) << std::endl;
+	}
+	if(Result)
+	{
+		return 1;
+	}
+	if(!IgnoreInfo)
+	{
+		char Buffer[32];
+		snprintf(Buffer, sizeof(Buffer), "%.3f s", FstIObject.GetDuration());
+		std::cout	<< "RootPath       : " << FstIObject.GetRootPath() << std::endl;
+		std::cout	<< "IndexPath      : " << FstIObject.GetIndexPath() << std::endl;
+		std::cout	<< "Archives       : " << std::dec << FstIObject.GetAmountArchives() << " (" << FstIObject.GetAmountRead() << " read, "
+					<< FstIObject.GetAmountReused() << " unchanged, " << FstIObject.GetAmountRemoved() << " removed)" << std::endl;
+		std::cout	<< "Paths          : " << FstIObject.GetAmountPaths() << " (" << FstIObject.GetAmountGrams() << " trigrams)" << std::endl;
+		std::cout	<< "IndexSize      : " << FstIObject.GetIndexSize() << std::endl;
+		std::cout	<< "Time           : " << Buffer << std::endl;
+	}
+	return 0;
+}
+/// \brief Find paths of file-entries in the path index
+/// \param[in] local_Input Path to the index file
+/// \param[in] local_Query Query: 'DIR\' - prefix, pattern with '*' or '?' - wildcard, other text - substring
+/// \return Error code: 0 - no errors, 1 - operation error
+int FindPath(char* local_Input, char* local_Query)
+{
+	if(FstIObject.Load(local_Input))
+	{
+		return 1;
+	}
+	double Loading = FstIObject.GetDuration();
+	FstIObject.Find(local_Query);
+
+	//Found paths prefixed by paths of their archives (relative to the root directory of the index)
+	std::cout << "Uncomp.Size     Path" << std::endl;
+	for(cnv::unsint i = 0; i < FstIObject.GetAmountFound(); i++)
+	{
+		std::cout << std::dec << FstIObject.GetFoundSize(i); Gap(FstIObject.GetFoundSize(i), 15);
+		std::cout << FstIObject.GetFoundPath(i) << std::endl;
+	}
+	if(!IgnoreInfo)
+	{
+		char Buffer[64];
+		snprintf(Buffer, sizeof(Buffer), "(query %.3f ms, loading %.3f ms)", FstIObject.GetDuration() * 1000, Loading * 1000);
+		std::cout	<< std::endl << "Found          : " << FstIObject.GetAmountFound() << " of " << FstIObject.GetAmountPaths() << " paths in "
+					<< FstIObject.GetAmountArchives() << " archives " << Buffer << std::endl;
+		std::cout	<< "RootPath       : " << FstIObject.GetRootPath() << std::endl;
+	}
+	return 0;
+}
+/// \brief Search text in contents of file-entries of archive
+/// \param[in] local_Input Path to archive
+/// \param[in] local_Pattern Searched text (regular expression with '--regex' option)
+/// \param[in] local_Mask Pattern of paths of searched file-entries (nullptr - all file-entries)
+/// \return Error code: 0 - no errors, 1 - operation error
+int Grep(char* local_Input, char* local_Pattern, char* local_Mask)
+{
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+	if(FstGObject.Search(local_Input, local_Pattern, (local_Mask == nullptr) ? "" : local_Mask))
+	{
+		return 1;
+	}
+	double Duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	//File-entries which couldn't be decoded (occurrences in other file-entries are shown)
+	for(cnv::unsint i = 0; i < FstGObject.GetAmountReport(); i++)
+	{
+		std::cout << FstGObject.GetReportLine(i) << std::endl;
+	}
+
+	//Occurrences as in 'grep -b': path of file-entry, offset in its uncompressed data and line around the occurrence
+	for(cnv::unsint i = 0; i < FstGObject.GetAmountMatches(); i++)
+	{
+		std::cout << FstGObject.GetMatchPath(i) << ":" << std::dec << FstGObject.GetMatchOffset(i) << ": " << FstGObject.GetMatchLine(i) << std::endl;
+	}
+	if(!IgnoreInfo)
+	{
+		char Buffer[32];
+		snprintf(Buffer, sizeof(Buffer), "%.3f s", Duration);
+		std::cout	<< std::endl << "ArchivePath    : " << FstGObject.GetArchivePath() << std::endl;
+		std::cout	<< "Matches        : " << std::dec << FstGObject.GetAmountMatches() << " in " << FstGObject.GetAmountMatched() << " entries" << std::endl;
+		std::cout	<< "Searched       : " << FstGObject.GetAmountSearched() << " of " << FstGObject.GetAmountEntries() << " entries ("
+					<< FstGObject.GetSearchedSize() << " bytes)" << std::endl;
+		if(FstGObject.GetAmountBinary() != 0)
+		{
+			std::cout	<< "Binary         : " << FstGObject.GetAmountBinary() << " entries (not searched by regular expression)" << std::endl;
+		}
+		std::cout	<< "Time           : " << Buffer << std::endl;
+	}
+	return 0;
+}
+/// \brief Output of data layout of archive (analysis of compaction)
+void LayoutInfo()
+{
+	char Buffer[32] = "-";
+	if(FstKObject.GetAmountTransitions() != 0)
+	{
+		snprintf(Buffer, sizeof(Buffer), "%.1f%%", 100.0 * FstKObject.GetAmountBreaks() / FstKObject.GetAmountTransitions());
+	}
+	std::cout	<< "ArchivePath    : " << FstKObject.GetArchivePath() << std::endl;
+	std::cout	<< "AmountEntries  : " << std::dec << FstKObject.GetAmountEntries() << std::endl;
+	std::cout	<< "FileSize       : " << FstKObject.GetFileSize() << std::endl;
+	std::cout	<< "HeadSize       : " << FstKObject.GetHeadSize() << std::endl;
+	std::cout	<< "Referenced     : " << FstKObject.GetReferencedSize() << std::endl;
+	std::cout	<< "Unreferenced   : " << FstKObject.GetUnreferencedSize() << " in " << FstKObject.GetAmountGaps() << " gaps (largest "
+				<< FstKObject.GetLargestGap() << ")" << std::endl;
+	std::cout	<< "Shared         : " << FstKObject.GetAmountShared() << " entries (" << FstKObject.GetSharedSize() << " bytes)" << std::endl;
+	std::cout	<< "Overlapping    : " << FstKObject.GetAmountOverlaps() << " entries (" << FstKObject.GetOverlapSize() << " bytes)" << std::endl;
+	std::cout	<< "Outside        : " << FstKObject.GetAmountOutside() << " entries" << std::endl;
+	std::cout	<< "Fragmentation  : " << FstKObject.GetAmountBreaks() << " of " << FstKObject.GetAmountTransitions() << " transitions ("
+				<< Buffer << ")" << std::endl;
+	std::cout	<< "CompactSize    : " << FstKObject.GetTargetSize() << std::endl;
+}
+/// \brief Analyze data layout of archive
+/// \param[in] local_Input Path to archive
+/// \return Error code: 0 - no errors, 1 - operation error
+int Layout(char* local_Input)
+{
+	if(FstKObject.Analyze(local_Input))
 	{
-		ArchiveEntry(i);
+		return 1;
 	}
+	LayoutInfo();
 	return 0;
 }
-/// \brief Unpack entire archive
-/// \param[in] local_Input Path to archive to be unpacked
+/// \brief Rewrite archive without unreferenced data
+/// \param[in] local_Input Path to the source archive
+/// \param[in] local_Output Path to the compacted archive
 /// \return Error code: 0 - no errors, 1 - operation error
-int Unpack(char* local_Input)
+int Rebuild(char* local_Input, char* local_Output)
 {
-	if(FstUObject.Load(local_Input))
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+	if(FstKObject.Compact(local_Input, local_Output))
 	{
 		return 1;
 	}
+	double Duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
 	if(!IgnoreInfo)
 	{
-		ArchiveHead();
-		for(cnv::unsint i = 0; i < FstUObject.GetAmountEntries(); i++)
-		{
-			ArchiveEntry(i);
-		}
+		char Buffer[32];
+		snprintf(Buffer, sizeof(Buffer), "%.3f s", Duration);
+		LayoutInfo();
+		std::cout	<< std::endl << "TargetPath     : " << FstKObject.GetTargetPath() << std::endl;
+		std::cout	<< "Saved          : " << std::dec << (FstKObject.GetFileSize() - FstKObject.GetTargetSize()) << std::endl;
+		std::cout	<< "ReadRequests   : " << FstKObject.GetAmountCopies() << std::endl;
+		std::cout	<< "Time           : " << Buffer << std::endl;
 	}
-	else
+	return 0;
+}
+/// \brief Change single file-entry of archive in place
+/// \param[in] local_Input Path to archive
+/// \param[in] local_Action Name of action (replace, delete, rename)
+/// \param[in] local_Entry Path of file-entry in the archive (or its ordinal number)
+/// \param[in] local_Value Path to file with new data (replace), new path of file-entry (rename) or nullptr (delete)
+/// \return Error code: 0 - no errors, 1 - operation error, 2 - invalid action or number of parameters
+int Adjust(char* local_Input, std::string local_Action, std::string local_Entry, char* local_Value)
+{
+	std::transform(local_Action.begin(), local_Action.end(), local_Action.begin(), ::tolower);
+	bool Delete = (local_Action == "delete");
+	if((local_Action != "replace" && local_Action != "rename" && !Delete) || Delete != (local_Value == nullptr))
 	{
-		std::cout << "ArchivePath    : " << FstUObject.GetArchivePath();
+		std::cout << "Error. Unknown edit action or wrong number of its parameters: " << local_Action << std::endl;
+		return 2;
 	}
-	if(FstUObject.UnpackEntireArchive() == 1)
+
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+	int Result = 0;
+	if(local_Action == "replace")
+		Result = FstJObject.Replace(local_Input, local_Entry, local_Value);
+	else if(local_Action == "rename")
+		Result = FstJObject.Rename(local_Input, local_Entry, local_Value);
+	else
+		Result = FstJObject.Remove(local_Input, local_Entry);
+	double Duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	//Interrupted edit is completed even if the requested one fails
+	if(FstJObject.IsRecovered())
 	{
-		return 1;
+		std::cout << "Interrupted edit of the archive is completed from its journal." << std::endl;
 	}
-	return 0;
-}
-/// \brief Extract single file from archive
-/// \param[in] local_Input Path to archive to be unpacked
-/// \param[in] i Ordinal number of entry in file
-/// \return Error code: 0 - no errors, 1 - operation error, 2 - invalid ordinal number
-int Extract(char* local_Input, cnv::unsint i)
-{
-	if(FstUObject.Load(local_Input))
+	if(Result)
 	{
 		return 1;
 	}
-	if(i < FstUObject.GetAmountEntries() && FstUObject.GetCompressFlag(i) != 2)
+	if(!IgnoreInfo)
 	{
-		if(!IgnoreInfo)
-		{
-			ArchiveHead();
-			ArchiveEntry(i);
-		}
-		else
+		char Buffer[32];
+		snprintf(Buffer, sizeof(Buffer), "%.3f ms", Duration * 1000);
+		std::cout	<< "ArchivePath    : " << FstJObject.GetArchivePath() << std::endl;
+		std::cout	<< "Entry          : " << std::dec << FstJObject.GetEntry() << " " << FstJObject.GetEntryPath() << std::endl;
+		if(local_Action == "replace")
 		{
-			std::cout << "ArchivePath    : " << FstUObject.GetArchivePath();
+			std::cout	<< "Uncomp.Size    : " << FstJObject.GetOldSize() << " -> " << FstJObject.GetNewSize() << std::endl;
+			std::cout	<< "Appended       : " << FstJObject.GetAppendedSize() << std::endl;
 		}
-		if(FstUObject.ExtractFromArchive(i) == 1)
+		if(local_Action == "rename")
 		{
-			return 1;
+			std::cout	<< "NewPath        : " << FstJObject.GetNewPath() << std::endl;
 		}
-	}
-	else
-	{
-		std::cout << "Error. Invalid input value." << std::endl;
-		return 2;
+		std::cout	<< "HeaderWritten  : " << FstJObject.GetWrittenSize() << std::endl;
+		std::cout	<< "AmountEntries  : " << FstJObject.GetAmountEntries() << std::endl;
+		std::cout	<< "Time           : " << Buffer << std::endl;
 	}
 	return 0;
 }
-/// \brief Create list-file for archive
+/// \brief Output table of contents in the specified format (for scripts)
 /// \param[in] local_Input Path to archive to be listed
-/// \return Error code: 0 - no errors, 1 - operation error
-int List(char* local_Input)
+/// \param[in] local_Format Name of format (table, csv, jsonl, bin)
+/// \return Error code: 0 - no errors, 1 - operation error, 2 - invalid format name
+int Output(char* local_Input, char* local_Format)
 {
-	if(FstUObject.Load(local_Input))
+	int Format = GetFormatFromName(local_Format);
+	if(Format < 0)
 	{
-		return 1;
+		std::cout << "Error. Unknown listing format: " << local_Format << std::endl;
+		return 2;
 	}
-	if(!IgnoreInfo)
+	if(FstUObject.Load(local_Input))
 	{
-		ArchiveHead();
-		for(cnv::unsint i = 0; i < FstUObject.GetAmountEntries(); i++)
-		{
-			ArchiveEntry(i);
-		}
+		return 1;
 	}
-	else
+	Listing.SetFormat(static_cast<cnv::unsint>(Format));
+	ArchiveTable();
+	int Result = (NestedMode) ? NestedTable() : 0;
+	Listing.SetFormat(LF_TABLE);
+	if(Result)
 	{
-		std::cout << "ArchivePath    : " << FstUObject.GetArchivePath();
+		return 1;
 	}
-	FstUObject.CreateListFile();
-    return 0;
+	return 0;
 }
-/// \brief Pack files into a new archive
-/// \param[in] local_Input Path to list-file for packing
-/// \param[in] local_Output Path to new created archive
-/// \return Error code: 0 - no errors, 1 - operation error
-int Pack(char* local_Input, char* local_Output)
+/// \brief Peak memory of the run compared with the memory budget
+void MemoryInfo()
 {
-	if(FstPObject.Pack(local_Input, local_Output))
-		return 1;
-	if(!IgnoreInfo)
+	char Buffer[128];
+	snprintf(Buffer, sizeof(Buffer), "%.1f MB (budget %.1f MB, leased at most %.1f MB)", chf::GetPeakMemory() / 1048576.0,
+		chf::GetMemoryLimit() / 1048576.0, chf::GetPeakLeased() / 1048576.0);
+	std::cout << std::endl << "PeakMemory     : " << Buffer << std::endl;
+}
+/// \brief Writing recorded events to the event trace file (called at exit of the program)
+void ExportEvents()
+{
+	if(evt::Export(EventsPath))
+		std::cout << "Error. Can't write event trace file: " << EventsPath << std::endl;
+}
+/// \brief Applying long option of the command line
+/// \param[in] local_Input Option with leading dashes (--name or --name=value)
+/// \return Error code: 0 - no errors, 2 - unknown option or invalid value
+int ApplyOption(std::string local_Input)
+{
+	std::string Name = local_Input.substr(2);
+	std::string Value;
+	std::string::size_type Position = Name.find('=');
+	if(Position != std::string::npos)
 	{
-		//List Path
-		std::cout 	<< "ListPath       : " << FstPObject.GetListPath() << std::endl;
-
-		//Archive path
-		std::cout 	<< "ArchivePath    : " << FstPObject.GetArchivePath() << std::endl;
-
-		//Amount of entries
-		std::cout	<< "AmountEntries  : " << std::dec << static_cast<int>(FstPObject.GetAmountEntries());
-		Gap(FstPObject.GetAmountEntries(), 15);
-		std::cout << "0x" << std::hex << static_cast<int>(FstPObject.GetAmountEntries()) << std::endl;
+		Value = Name.substr(Position + 1);
+		Name.resize(Position);
+	}
+	std::transform(Name.begin(), Name.end(), Name.begin(), ::tolower);
 
-		//File size
-		std::string OutputString = local_Output;
-		cnv::dword OutputSize = chf::GetFileSize(OutputString);
-		std::cout	<< "FileSize       : " << std::dec << OutputSize;
-		Gap(OutputSize, 15);
-		std::cout << "0x" << std::hex << OutputSize << std::dec;
-		Gap16(OutputSize, 15);
-		float kbytes = OutputSize/1024.0f;
-		float mbytes = kbytes/1024.0f;
-		if(mbytes > 1)
+	if(Name == "fst64" && Value.empty())
+	{
+		FstPObject.SetFormat(AF_FST64);
+		return 0;
+	}
+	if(Name == "dictionary" && Value.empty())
+	{
+		//Shared dictionary is stored in extended archive only
+		FstPObject.SetDictionary(true);
+		FstPObject.SetFormat(AF_FST64);
+		return 0;
+	}
+	if(Name == "nested" && Value.empty())
+	{
+		//Entries which are archives themselves are listed and unpacked recursively
+		NestedMode = 1;
+		return 0;
+	}
+	if(Name == "resume" && Value.empty())
+	{
+		FstUObject.SetResume(true);
+		return 0;
+	}
+	if(Name == "incremental" && (Value.empty() || Value == "content"))
+	{
+		//Existing output files are compared by size, or by size and content
+		FstUObject.SetIncremental(Value.empty() ? IM_SIZE : IM_CONTENT);
+		return 0;
+	}
+	if(Name == "align" && !Value.empty())
+	{
+		//Boundary in bytes (power of two up to 1 MB), optionally only for uncompressed entries
+		bool StoredOnly = false;
+		Position = Value.find(':');
+		if(Position != std::string::npos)
 		{
-			std::cout << mbytes << " MB";
+			StoredOnly = (Value.substr(Position + 1) == "stored");
+			if(!StoredOnly)
+			{
+				std::cout << "Error. Invalid option value: " << local_Input << std::endl;
+				return 2;
+			}
+			Value.resize(Position);
 		}
-		else if(kbytes > 1)
+		cnv::dword Boundary = static_cast<cnv::dword>(strtoul(Value.data(), nullptr, 10));
+		if(Boundary < 2 || Boundary > 1024*1024 || (Boundary & (Boundary - 1)) != 0)
 		{
-			std::cout << kbytes << " KB";
+			std::cout << "Error. Invalid option value: " << local_Input << std::endl;
+			return 2;
 		}
-		std::cout << std::endl << std::endl;
-
-		//Description string for data table
-		std::cout	<< "Indx CF File path" << std::endl;
-
-		//Data table
-		for(cnv::dword i = 0; i < FstPObject.GetAmountEntries(); i++)
+		FstPObject.SetAlignment(Boundary, StoredOnly);
+		FstKObject.SetAlignment(Boundary, StoredOnly);
+		return 0;
+	}
+	if(Name == "trace" && !Value.empty())
+	{
+		//Paths of entries read by unpacking modes are appended to the file, one per line
+		Value = chf::GetFullPath(Value);
+		TraceFile.open(Value, ios::out|ios::app);
+		if(!TraceFile.is_open())
 		{
-			std::cout << std::dec << i; Gap(i, 4);
-			switch(FstPObject.GetCompressFlag(i))
-			{
-				case 0:
-					std::cout << "u  ";
-				break;
-				case 1:
-					std::cout << "c  ";
-				break;
-			}
-		   std::cout << FstPObject.GetEntryPath(i) << std::endl;
+			std::cout << "Error. Can't open trace file: " << Value << std::endl;
+			return 2;
 		}
+		FstUObject.SetTraceHook([](const std::string& Path)
+		{
+			TraceFile << Path << '\n';
+		});
+		return 0;
 	}
-	else
+	if(Name == "toc-order" && Value.empty())
 	{
-        std::cout 	<< "ListPath       : " << FstPObject.GetListPath();
-    }
-	return 0;
-}
-/// \brief Unpack entire archive and create list-file
-/// \param[in] local_Input Path to archive to be unpacked and listed
-/// \return Error code: 0 - no errors, 1 - operation error
-int Complex(char* local_Input)
-{
-	if(FstUObject.Load(local_Input))
+		//Rebuild mode places data of entries in order of table of contents
+		FstKObject.SetTocOrder(true);
+		return 0;
+	}
+	if(Name == "regex" && Value.empty())
 	{
-		return 1;
+		//Grep mode takes the pattern as regular expression (ECMAScript) instead of plain text
+		FstGObject.SetRegex(true);
+		return 0;
 	}
-	if(!IgnoreInfo)
+	if(Name == "dry-run" && Value.empty())
 	{
-		ArchiveHead();
-		for(cnv::unsint i = 0; i < FstUObject.GetAmountEntries(); i++)
+		//Pack mode estimates the archive without creating it
+		FstPObject.SetDryRun(true);
+		return 0;
+	}
+	if(Name == "memory" && !Value.empty())
+	{
+		//Budget in megabytes for buffers and work in flight, peak memory is shown at the end of the run
+		cnv::qword Megabytes = strtoull(Value.data(), nullptr, 10);
+		if(Megabytes == 0 || Megabytes > 1024*1024)
 		{
-			ArchiveEntry(i);
+			std::cout << "Error. Invalid option value: " << local_Input << std::endl;
+			return 2;
 		}
+		chf::SetMemoryLimit(Megabytes * 1024 * 1024);
+		MemoryReport = 1;
+		return 0;
 	}
-	else
+	if(Name == "order" && !Value.empty())
 	{
-		std::cout << "ArchivePath    : " << FstUObject.GetArchivePath();
+		FstPObject.SetTracePath(chf::GetFullPath(Value));
+		return 0;
 	}
-	if(FstUObject.UnpackEntireArchive() == 1)
+	if(Name == "events" && !Value.empty())
 	{
-		return 1;
+#ifdef FSTFILE_EVENT_TRACE
+		//Events are recorded from this moment and written when the program exits
+		EventsPath = chf::GetFullPath(Value);
+		evt::Start();
+		atexit(ExportEvents);
+		return 0;
+#else
+		std::cout << "Error. Event tracing is not compiled in: " << local_Input << std::endl;
+		return 2;
+#endif
 	}
-	FstUObject.CreateListFile();
-	return 0;
+	std::cout << "Error. Unknown option: " << local_Input << std::endl;
+	return 2;
 }
 /// \brief Main function
 /// \param[in] argc Amount of command line arguments
@@ -348,6 +1118,21 @@ int _tmain(int argc, _TCHAR* argv[])
 {
 	std::string Title = "title FstFile " + Version;
 	system(Title.data());
+
+	//Long options may follow the command in any position, they don't count as parameters
+	int AmountArguments = 0;
+	for(int i = 0; i < argc; i++)
+	{
+		std::wstring wso(argv[i]);
+		if(i > 1 && wso.size() > 2 && wso.at(0) == '-' && wso.at(1) == '-')
+		{
+			OptionList.push_back(std::string(wso.begin(), wso.end()));
+			continue;
+		}
+		argv[AmountArguments++] = argv[i];
+	}
+	argc = AmountArguments;
+
 	if(argc == 2)
 	{
 		std::wstring ws(argv[1]);
@@ -364,16 +1149,58 @@ int _tmain(int argc, _TCHAR* argv[])
 						<< "will for file paths involved in operations. Commands and modifiers are written together. Use of space is not allowed" << std::endl
 						<< "and be interpreted by the program as invalid parameter. The command must be preceded by a dash character. It is" << std::endl
 						<< "possible to open a file for viewing by adding path to the file as first parameter." << std::endl << std::endl
-						<< "FstFile <command+modificator> <first parameter> <second parameter>" << std::endl << std::endl
+						<< "FstFile <command+modificator> <first parameter> <second parameter> <third parameter> [--options]" << std::endl << std::endl
 						<< "* Operating modes:" << std::endl
 						<< "Command        Symbol Mods Parameters                  Result" << std::endl
 						<< "Show info      s       p   <Source arc.>               The program will show all contents of archive." << std::endl
 						<< "Unpack all     u      api  <Source arc.>               Unpack contents of archive into a separate folder." << std::endl
 						<< "Extract single e      api  <Source arc.> <EntryNumber> Single extraction of a file from archive." << std::endl
+						<< "Read range     r      api  <Source arc.> <EntryNumber> <Offset:Length> <Target file>" << std::endl
+						<< "                                                       Extraction of bytes [Offset, Offset+Length) of a file. Stored" << std::endl
+						<< "                                                       data is read directly. Only entries compressed with shared" << std::endl
+						<< "                                                       dictionary stop decoding at the end of the range; others are" << std::endl
+						<< "                                                       decoded whole." << std::endl
 						<< "create List    l      api  <Source arc.>               Listing contents of archive in a list-file." << std::endl
 						<< "Pack           p      api  <Source list> <Target arc.> Packing files into a new archive by list-file." << std::endl
 						<< "Complex        c      api  <Source arc.>               Complex unpacking of archive simultaneously with creation of" << std::endl
-						<< "                                                       list-file (Unpack all + create List)." << std::endl << std::endl
+						<< "                                                       list-file (Unpack all + create List)." << std::endl
+						<< "pack Whole dir w      api  <Root dir> <Target arc.> [<Rules>]" << std::endl
+						<< "                                                       Packing directory tree into a new archive without list-file." << std::endl
+						<< "Diff           d      api  <Old arc.> <New arc.>       Comparing two archives: added, removed and modified entries." << std::endl
+						<< "Make patch     m      api  <Old arc.> <New arc.> <Patch>" << std::endl
+						<< "                                                       Creating patch which rebuilds the new archive from the old one." << std::endl
+						<< "paTch          t      api  <Old arc.> <Patch> <Target arc.>" << std::endl
+						<< "                                                       Rebuilding the new archive from the old one and the patch." << std::endl
+						<< "Output list    o      -    <Source arc.> <Format>      Output of table of contents for scripts. Format: table, csv," << std::endl
+						<< "                                                       jsonl, bin. Exit message and pause are skipped." << std::endl
+						<< "ceNsus         n      api  <Source arc.>               Classifying entries by signatures of their data: amount, sizes" << std::endl
+						<< "                                                       and compression ratio of every type, entries whose extension" << std::endl
+						<< "                                                       doesn't match. Only beginning of each entry is decoded." << std::endl
+						<< "indeX          x      api  <Root dir> <Index>          Building path index of all archives (*.fst) under the root" << std::endl
+						<< "                                                       directory. Existing index is updated: only archives with other" << std::endl
+						<< "                                                       size or time of last write are read again." << std::endl
+						<< "Find           f      api  <Index> <Query>             Finding entries in the path index. Query 'DIR\\' gives all" << std::endl
+						<< "                                                       paths under DIR, query with '*' or '?' - paths matching the" << std::endl
+						<< "                                                       pattern, other query - paths containing it." << std::endl
+						<< "Grep           g      api  <Source arc.> <Text> [Mask] Searching text in contents of entries (whose paths match the" << std::endl
+						<< "                                                       mask). Entries are decoded in memory on several threads." << std::endl
+						<< "                                                       Each occurrence is shown with path of entry, offset in it" << std::endl
+						<< "                                                       and line around it." << std::endl
+						<< "laYout         y      api  <Source arc.>               Analysis of data layout: bytes not referenced by table of" << std::endl
+						<< "                                                       contents, shared and overlapping data, fragmentation." << std::endl
+						<< "reBuild        b      api  <Source arc.> <Target arc.> Rewriting the archive without unreferenced bytes. Data of" << std::endl
+						<< "                                                       entries is copied as is (not compressed again) by blocks." << std::endl
+						<< "adJust         j      api  <Source arc.> replace <Entry> <File>" << std::endl
+						<< "                           <Source arc.> delete <Entry>" << std::endl
+						<< "                           <Source arc.> rename <Entry> <New path>" << std::endl
+						<< "                                                       Changing single entry (path or number) in place. New data" << std::endl
+						<< "                                                       is appended at the end of the archive, only the record of" << std::endl
+						<< "                                                       the entry is rewritten (delete rewrites the header). Old" << std::endl
+						<< "                                                       data stays as unreferenced space (see 'reBuild'). Changes" << std::endl
+						<< "                                                       of header go through journal <archive>.edit, interrupted" << std::endl
+						<< "                                                       edit is completed by the next edit of the archive (only if" << std::endl
+						<< "                                                       size and header of the archive match the journal). Modes" << std::endl
+						<< "                                                       writing a new archive remove its old journal." << std::endl << std::endl
 						<< "* Display modifiers:" << std::endl
 						<< "Modifier       Symbol Result" << std::endl
 						<< "ignore All     a      This modifier uses the following two at the same time. (Cannot be used with 'Show info' mode)." << std::endl
@@ -381,6 +1208,44 @@ int _tmain(int argc, _TCHAR* argv[])
 						<< "                      terminate its work. This parameter is useful for batch operation of the utility." << std::endl
 						<< "ignore Info    i      All information output while the program is running will be skipped, only the exit message" << std::endl
 						<< "                      (and errors) will be shown. This modifier does not work with 'Show info' mode." << std::endl << std::endl
+						<< "* Options:" << std::endl
+						<< "Option         Result" << std::endl
+						<< "--fst64        Packing modes create extended archive (FST64) with 64-bit offsets and sizes. Such archives may be" << std::endl
+						<< "               larger than 4 GB. Reading modes detect the format automatically." << std::endl
+						<< "--align=N      Packing modes start data of each entry at offset divisible by N (power of two up to 1048576)." << std::endl
+						<< "               'N:stored' aligns only uncompressed entries. Padding is filled with zeros and reported after" << std::endl
+						<< "               packing. Archive stays readable by any version of the utility. Rebuild mode pads data of" << std::endl
+						<< "               entries by the same rule, so compaction keeps the archive aligned." << std::endl
+						<< "--trace=FILE   Unpacking modes append paths of entries to FILE in order of reading (access trace)." << std::endl
+						<< "--order=FILE   Packing modes place data of entries in order of their first appearance in access trace FILE," << std::endl
+						<< "               so entries read together lie next to each other. Order of table of contents is not changed." << std::endl
+						<< "--memory=N     Limit memory of buffers and of work in flight to N megabytes. Worker threads wait while the" << std::endl
+						<< "               budget is used by others; compressed entries which don't fit are unpacked by blocks straight" << std::endl
+						<< "               into the file; data of neighbouring entries is read together only when it fits. Entry larger" << std::endl
+						<< "               than the whole budget is still packed, but alone. Peak memory is shown at the end of the run." << std::endl
+						<< "--dry-run      Pack mode doesn't create the archive, but shows its projected size, compression ratio of each entry" << std::endl
+						<< "               and estimated time of packing. Compressed entries are compressed in parallel and discarded; if" << std::endl
+						<< "               they are larger than 256 MB in total, only evenly spaced sample is compressed and the rest is" << std::endl
+						<< "               estimated by ratio of sampled entries with the same extension ('~' in the table)." << std::endl
+						<< "--dictionary   Packing modes build shared dictionary from sample of small text entries (up to 16 KB) and store it" << std::endl
+						<< "               once in the archive. Each small entry is compressed with the dictionary, if it gives smaller data," << std::endl
+						<< "               and still can be read alone. Implies --fst64." << std::endl
+						<< "--events=FILE  Record begin and end of loading, reading, decompressing, compressing and writing of each entry" << std::endl
+						<< "               and creating directories. Events are written to FILE at exit in Chrome trace format (JSON), it" << std::endl
+						<< "               can be opened in Perfetto or chrome://tracing." << std::endl
+						<< "--resume       Unpacking modes record completed entries in journal <archive>_unpack.journal (flushed to disk" << std::endl
+						<< "               every 64 entries). Next run skips recorded entries whose files have the same size and unpacks" << std::endl
+						<< "               the rest. Journal is removed when unpacking is completed." << std::endl
+						<< "--incremental  Unpacking modes skip existing output files of the same size as entry, nothing is decompressed" << std::endl
+						<< "               or written for them. '--incremental=content' also compares content of files of the same size." << std::endl
+						<< "--nested       Entries which are archives themselves are shown ('Show info', 'Output list', except 'bin') and" << std::endl
+						<< "               unpacked ('Unpack all', 'Complex') recursively into folders <entry>_unpack beside them. Nested" << std::endl
+						<< "               archives are decoded in memory, no intermediate files are written." << std::endl
+						<< "--regex        Grep mode takes the text as regular expression (ECMAScript syntax). Each line of entry is" << std::endl
+						<< "               searched separately, so occurrence can't span several lines. Lines longer than 64 KB are" << std::endl
+						<< "               searched by parts, binary entries (with zero bytes) are not searched." << std::endl
+						<< "--toc-order    Rebuild mode places data of entries in order of table of contents (by default order of data in" << std::endl
+						<< "               the source archive is kept). Entries sharing data keep sharing it." << std::endl << std::endl
 						<< "Absence of modifiers will display all information available for the mode and the program will wait for any key to be" << std::endl
 						<< "pressed after end of work for its completion." << std::endl << std::endl
 						<< "The case of the command and modifier characters is not important. Running the utility without parameters displays" << std::endl
@@ -392,17 +1257,47 @@ int _tmain(int argc, _TCHAR* argv[])
 						<< "                                    to console." << std::endl
 						<< "FstFile -ep EXAMPLE.FST 0           The first entry will be extracted (numbering starts from zero). The program will" << std::endl
 						<< "                                    terminate immediately after the task is completed." << std::endl
+						<< "FstFile -r GAME.FST 5 0:64 HEAD.BIN First 64 bytes of entry 5 are written to HEAD.BIN. Only entries compressed" << std::endl
+						<< "                                    with shared dictionary stop decoding after 64 bytes; others are decoded whole." << std::endl
 						<< "FstFile -p EXAMPLE.LIST TARGET.FST  EXAMPLE.LIST is used as source for new archive - TARGET.FST. After completion of" << std::endl
 						<< "                                    work, you can view information and manually close program." << std::endl
 						<< "FstFile -ca EXAMPLE.FST             Unpacking the archive and creating list-file. No information output and no pause at" << std::endl
-						<< "                                    end of the work." << std::endl << std::endl;
+						<< "                                    end of the work." << std::endl
+						<< "FstFile -d OLD.FST NEW.FST          Comparing two versions of the archive. Entries are matched by path, data is" << std::endl
+						<< "                                    decompressed only when stored data of entries differs." << std::endl
+						<< "FstFile -m OLD.FST NEW.FST UPD.FSTP Creating patch UPD.FSTP. Unchanged entries are referenced, changed entries are" << std::endl
+						<< "                                    stored as binary delta against the old entry with the same path." << std::endl
+						<< "FstFile -t OLD.FST UPD.FSTP NEW.FST Rebuilding NEW.FST from OLD.FST and patch. The result is checked by checksum." << std::endl
+						<< "FstFile -o EXAMPLE.FST csv          Table of contents as CSV (one row per entry). 'jsonl' gives JSON object per line," << std::endl
+						<< "                                    'bin' gives fixed-width records of 270 bytes after 16-byte header." << std::endl
+						<< "FstFile -w DATA TARGET.FST RULES    Packing all files of DATA folder (paths in the archive are relative to DATA)." << std::endl
+						<< "                                    RULES lines: '+ mask' include, '- mask' exclude, 'c mask' compress, 'u mask' store," << std::endl
+						<< "                                    'l' create list-file for Pack mode. Masks use '*' and '?', the last match wins." << std::endl
+						<< "FstFile -p A.LIST BIG.FST --fst64   Packing into extended archive. Classic readers see single marker entry and can't" << std::endl
+						<< "                                    extract it." << std::endl
+						<< "FstFile -w DATA B.FST --dictionary  Packing many small text files with shared dictionary. Each entry is still read" << std::endl
+						<< "                                    alone, the dictionary is read once when the archive is loaded." << std::endl
+						<< "FstFile -ua GAME.FST --resume       Unpacking which may be interrupted. Repeat the same command to continue it." << std::endl
+						<< "FstFile -ua GAME.FST --incremental  Repeated unpacking into the same folder writes only files which differ in size." << std::endl
+						<< "FstFile -o GAME.FST csv --nested    Table of contents of the archive and of all archives inside it, paths of nested" << std::endl
+						<< "                                    entries start with path of their archive (MAPS\\A.FST\\...)." << std::endl
+						<< "FstFile -x D:\\GAME GAME.FSTI        Building path index of all archives of the game. Repeat it after update of the" << std::endl
+						<< "                                    game, only changed archives are read again." << std::endl
+						<< "FstFile -f GAME.FSTI *.FIT          Finding all FIT-files in all archives of the game. 'MAPS\\' gives all paths" << std::endl
+						<< "                                    under MAPS folder, 'desert' gives all paths containing this word." << std::endl
+						<< "FstFile -ga GAME.FST Atlas *.SCR    Finding all mission scripts mentioning Atlas." << std::endl
+						<< "FstFile -g GAME.FST ATL\\d+ --regex Finding all unit codes like ATL7 or ATL12 in all entries." << std::endl
+						<< "FstFile -b OLD.FST NEW.FST          Rewriting patched archive without dead space, see 'laYout' mode for its amount." << std::endl
+						<< "FstFile -j GAME.FST replace UNITS\\ATLAS.MEC ATLAS.MEC" << std::endl
+						<< "                                    Putting changed file into the archive without repacking it." << std::endl
+						<< "FstFile -j GAME.FST rename 12 UNITS\\ATLAS2.MEC  Renaming entry 12." << std::endl << std::endl;
 			std::cout << std::endl << "Press any key to exit..." << std::endl;
 			getch();
 			return 0;
 		}
 		if(Path.at(0) != '-')
 		{
-			Path = chf::GetFullPath(Path.data());
+			Path = chf::GetFullPath(Path);
 			ifstream Check(Path.data(), ios::in);
 			if(!Check.is_open())
 			{
@@ -443,6 +1338,8 @@ int _tmain(int argc, _TCHAR* argv[])
 				std::cout << "Module name: " << LastError.File << std::endl;
 				std::cout << "Function   : " << LastError.Function << std::endl;
 				std::cout << "Line number: " << LastError.Line << std::endl;
+				if(LastError.EntryIndex != ErrorNoEntry)
+					std::cout << "Entry index: " << LastError.EntryIndex << std::endl;
 				std::cout << "Additional : " << LastError.Additional << std::endl << std::endl;
 			}
 		}
@@ -454,19 +1351,17 @@ int _tmain(int argc, _TCHAR* argv[])
 			return 0;
 		}
 	}
-	else if(argc > 2 && argc < 5)
+	else if(argc > 2 && argc < 6)
 	{
 		int ErrorFeedBack = 0;
 
-		LastError.Function = nullptr;
-		LastError.ErrorIndex = 0;
-		LastError.Additional = nullptr;
+		ClearError();
 
 		std::wstring wsp(argv[2]);
 		std::string Path(wsp.begin(), wsp.end());
-		Path = chf::GetFullPath(Path.data());
+		Path = chf::GetFullPath(Path);
 		ifstream Check(Path.data(), ios::in);
-		if(!Check.is_open())
+		if(!Check.is_open() && !chf::IsDirectoryExists(Path))
 		{
 			std::cout << "Error. Can't open input file: " << Path << std::endl;
 			if(!IgnorePause)
@@ -487,6 +1382,10 @@ int _tmain(int argc, _TCHAR* argv[])
 			ErrorFeedBack = 2;
 			std::cout << "Error. Invalid command - Can't find the dash character." << std::endl;
 		}
+		for(cnv::unsint i = 0; i < OptionList.size() && ErrorFeedBack != 2; i++)
+		{
+			ErrorFeedBack = ApplyOption(OptionList.at(i));
+		}
 		if(ErrorFeedBack != 2)
 		{
 			switch(tolower(Command[2]))
@@ -527,6 +1426,47 @@ int _tmain(int argc, _TCHAR* argv[])
 						std::cout << "Error. Wrong number of arguments. Argc: " << argc << std::endl;
 					}
 				break;
+				case 'r':
+					if(argc == 6)
+					{
+						cnv::unsint Value = static_cast<cnv::unsint>(_wtoi(argv[3]));
+						std::wstring wspr(argv[4]);
+						std::string RangeValue(wspr.begin(), wspr.end());
+						std::wstring wspo(argv[5]);
+						std::string PathOut(wspo.begin(), wspo.end());
+						PathOut = chf::GetFullPath(PathOut);
+						ErrorFeedBack = Range(Path.data(), Value, RangeValue, PathOut.data());
+					}
+					else
+					{
+						ErrorFeedBack = 2;
+						std::cout << "Error. Wrong number of arguments. Argc: " << argc << std::endl;
+					}
+				break;
+				case 'j':
+					if(argc == 5 || argc == 6)
+					{
+						std::wstring wspa(argv[3]);
+						std::string Action(wspa.begin(), wspa.end());
+						std::wstring wspe(argv[4]);
+						std::string EntryPath(wspe.begin(), wspe.end());
+						std::string Value;
+						if(argc == 6)
+						{
+							std::wstring wspv(argv[5]);
+							Value.assign(wspv.begin(), wspv.end());
+							std::transform(Action.begin(), Action.end(), Action.begin(), ::tolower);
+							if(Action == "replace")
+								Value = chf::GetFullPath(Value);
+						}
+						ErrorFeedBack = Adjust(Path.data(), Action, EntryPath, (argc == 6) ? &Value[0] : nullptr);
+					}
+					else
+					{
+						ErrorFeedBack = 2;
+						std::cout << "Error. Wrong number of arguments. Argc: " << argc << std::endl;
+					}
+				break;
 				case 'l':
 					ErrorFeedBack = List(Path.data());
 				break;
@@ -535,7 +1475,7 @@ int _tmain(int argc, _TCHAR* argv[])
 					{
 						std::wstring wspa(argv[3]);
 						std::string PathAdd(wspa.begin(), wspa.end());
-						PathAdd = chf::GetFullPath(PathAdd.data());
+						PathAdd = chf::GetFullPath(PathAdd);
 						ErrorFeedBack = Pack(Path.data(), PathAdd.data());
 					}
 					else
@@ -547,6 +1487,159 @@ int _tmain(int argc, _TCHAR* argv[])
 				case 'c':
 					ErrorFeedBack = Complex(Path.data());
 				break;
+				case 'w':
+					if(argc == 4 || argc == 5)
+					{
+						std::wstring wspa(argv[3]);
+						std::string PathAdd(wspa.begin(), wspa.end());
+						PathAdd = chf::GetFullPath(PathAdd);
+						std::string PathRules;
+						if(argc == 5)
+						{
+							std::wstring wspr(argv[4]);
+							PathRules.assign(wspr.begin(), wspr.end());
+							PathRules = chf::GetFullPath(PathRules);
+						}
+						ErrorFeedBack = PackDirectory(Path.data(), PathAdd.data(), (argc == 5) ? &PathRules[0] : nullptr);
+					}
+					else
+					{
+						ErrorFeedBack = 2;
+						std::cout << "Error. Wrong number of arguments. Argc: " << argc << std::endl;
+					}
+				break;
+				case 'd':
+					if(argc == 4)
+					{
+						std::wstring wspa(argv[3]);
+						std::string PathAdd(wspa.begin(), wspa.end());
+						PathAdd = chf::GetFullPath(PathAdd);
+						ErrorFeedBack = Diff(Path.data(), PathAdd.data());
+					}
+					else
+					{
+						ErrorFeedBack = 2;
+						std::cout << "Error. Wrong number of arguments. Argc: " << argc << std::endl;
+					}
+				break;
+				case 'y':
+					if(argc == 3)
+					{
+						ErrorFeedBack = Layout(Path.data());
+					}
+					else
+					{
+						ErrorFeedBack = 2;
+						std::cout << "Error. Wrong number of arguments. Argc: " << argc << std::endl;
+					}
+				break;
+				case 'b':
+					if(argc == 4)
+					{
+						std::wstring wspo(argv[3]);
+						std::string PathOut(wspo.begin(), wspo.end());
+						PathOut = chf::GetFullPath(PathOut);
+						ErrorFeedBack = Rebuild(Path.data(), PathOut.data());
+					}
+					else
+					{
+						ErrorFeedBack = 2;
+						std::cout << "Error. Wrong number of arguments. Argc: " << argc << std::endl;
+					}
+				break;
+				case 'n':
+					if(argc == 3)
+					{
+						ErrorFeedBack = Census(Path.data());
+					}
+					else
+					{
+						ErrorFeedBack = 2;
+						std::cout << "Error. Wrong number of arguments. Argc: " << argc << std::endl;
+					}
+				break;
+				case 'x':
+					if(argc == 4)
+					{
+						std::wstring wspo(argv[3]);
+						std::string PathOut(wspo.begin(), wspo.end());
+						PathOut = chf::GetFullPath(PathOut);
+						ErrorFeedBack = BuildIndex(Path.data(), PathOut.data());
+					}
+					else
+					{
+						ErrorFeedBack = 2;
+						std::cout << "Error. Wrong number of arguments. Argc: " << argc << std::endl;
+					}
+				break;
+				case 'f':
+					if(argc == 4)
+					{
+						std::wstring wspq(argv[3]);
+						std::string Query(wspq.begin(), wspq.end());
+						ErrorFeedBack = FindPath(Path.data(), &Query[0]);
+					}
+					else
+					{
+						ErrorFeedBack = 2;
+						std::cout << "Error. Wrong number of arguments. Argc: " << argc << std::endl;
+					}
+				break;
+				case 'g':
+					if(argc == 4 || argc == 5)
+					{
+						std::wstring wspq(argv[3]);
+						std::string Query(wspq.begin(), wspq.end());
+						std::string Mask;
+						if(argc == 5)
+						{
+							std::wstring wspm(argv[4]);
+							Mask.assign(wspm.begin(), wspm.end());
+						}
+						ErrorFeedBack = Grep(Path.data(), &Query[0], (argc == 5) ? &Mask[0] : nullptr);
+					}
+					else
+					{
+						ErrorFeedBack = 2;
+						std::cout << "Error. Wrong number of arguments. Argc: " << argc << std::endl;
+					}
+				break;
+				case 'o':
+					if(argc == 4)
+					{
+						std::wstring wspf(argv[3]);
+						std::string Format(wspf.begin(), wspf.end());
+						IgnorePause = 1;
+						ScriptOutput = 1;
+						ErrorFeedBack = Output(Path.data(), Format.data());
+					}
+					else
+					{
+						ErrorFeedBack = 2;
+						std::cout << "Error. Wrong number of arguments. Argc: " << argc << std::endl;
+					}
+				break;
+				case 'm':
+				case 't':
+					if(argc == 5)
+					{
+						std::wstring wspa(argv[3]);
+						std::string PathAdd(wspa.begin(), wspa.end());
+						PathAdd = chf::GetFullPath(PathAdd);
+						std::wstring wspo(argv[4]);
+						std::string PathOut(wspo.begin(), wspo.end());
+						PathOut = chf::GetFullPath(PathOut);
+						if(tolower(Command[1]) == 'm')
+							ErrorFeedBack = MakePatch(Path.data(), PathAdd.data(), PathOut.data());
+						else
+							ErrorFeedBack = ApplyPatch(Path.data(), PathAdd.data(), PathOut.data());
+					}
+					else
+					{
+						ErrorFeedBack = 2;
+						std::cout << "Error. Wrong number of arguments. Argc: " << argc << std::endl;
+					}
+				break;
 				default:
 					ErrorFeedBack = 2;
 					std::cout << "Error. Invalid command: " << Command[1] << std::endl;
@@ -562,6 +1655,15 @@ int _tmain(int argc, _TCHAR* argv[])
 			}
 		}
 
+		if(ScriptOutput && ErrorFeedBack == 0)
+		{
+			delete[] Command; Command = nullptr;
+			return 0;
+		}
+		if(MemoryReport)
+		{
+			MemoryInfo();
+		}
 		std::cout << std::endl << "Process is over. Result: " << ErrorFeedBack;
 		switch(ErrorFeedBack)
 		{
@@ -587,6 +1689,8 @@ int _tmain(int argc, _TCHAR* argv[])
 			std::cout << "Module name: " << LastError.File << std::endl;
 			std::cout << "Function   : " << LastError.Function << std::endl;
 			std::cout << "Line number: " << LastError.Line << std::endl;
+			if(LastError.EntryIndex != ErrorNoEntry)
+				std::cout << "Entry index: " << LastError.EntryIndex << std::endl;
 			std::cout << "Additional : " << LastError.Additional << std::endl << std::endl;
 		}
 		delete[] Command; Command = nullptr;
@@ -596,21 +1700,53 @@ int _tmain(int argc, _TCHAR* argv[])
 		std::cout 	<< "FSTFILE    (build " << Version << " " << Build << " by SpinelDusk)" << std::endl << std::endl
 					<< "FstFile is console utility for working with MechCommander game archives -- FST, DPK formats." << std::endl << std::endl
 					<< "* Syntax:" << std::endl
-					<< "FstFile <command+modificator> <first parameter> <second parameter>" << std::endl << std::endl
+					<< "FstFile <command+modificator> <first parameter> <second parameter> <third parameter> [--options]" << std::endl << std::endl
 					<< "* Operating modes:" << std::endl
 					<< "Command        Symbol Mods Parameters                  Result" << std::endl
 					<< "Show info      s       p   <Source arc.>               The program will show all contents of archive." << std::endl
 					<< "Unpack all     u      api  <Source arc.>               Unpack contents of archive into a separate folder." << std::endl
 					<< "Extract single e      api  <Source arc.> <EntryNumber> Single extraction of a file from archive." << std::endl
+					<< "Read range     r      api  <Source arc.> <EntryNumber> <Offset:Length> <Target file>" << std::endl
+					<< "                                                       Extraction of bytes [Offset, Offset+Length) of a file." << std::endl
 					<< "create List    l      api  <Source arc.>               Listing contents of archive in a list-file." << std::endl
 					<< "Pack           p      api  <Source list> <Target arc.> Packing files into a new archive by list-file." << std::endl
 					<< "Complex        c      api  <Source arc.>               Complex unpacking of archive simultaneously with creation of" << std::endl
-					<< "                                                       list-file (Unpack all + create List)." << std::endl << std::endl
+					<< "                                                       list-file (Unpack all + create List)." << std::endl
+					<< "pack Whole dir w      api  <Root dir> <Target arc.> [<Rules>]" << std::endl
+					<< "                                                       Packing directory tree into a new archive without list-file." << std::endl
+					<< "Diff           d      api  <Old arc.> <New arc.>       Comparing two archives: added, removed and modified entries." << std::endl
+					<< "Make patch     m      api  <Old arc.> <New arc.> <Patch>" << std::endl
+					<< "                                                       Creating patch which rebuilds the new archive from the old one." << std::endl
+					<< "paTch          t      api  <Old arc.> <Patch> <Target arc.>" << std::endl
+					<< "                                                       Rebuilding the new archive from the old one and the patch." << std::endl
+					<< "Output list    o      -    <Source arc.> <Format>      Output of table of contents for scripts. Format: table, csv," << std::endl
+					<< "                                                       jsonl, bin. Exit message and pause are skipped." << std::endl
+					<< "ceNsus         n      api  <Source arc.>               Classifying entries by signatures of their data." << std::endl
+					<< "indeX          x      api  <Root dir> <Index>          Building or updating path index of all archives under directory." << std::endl
+					<< "Find           f      api  <Index> <Query>             Finding entries by prefix, wildcard pattern or substring." << std::endl
+					<< "Grep           g      api  <Source arc.> <Text> [Mask] Searching text in contents of entries without unpacking." << std::endl
+					<< "laYout         y      api  <Source arc.>               Analysis of dead space and fragmentation of the archive." << std::endl
+					<< "reBuild        b      api  <Source arc.> <Target arc.> Rewriting the archive without dead space." << std::endl
+					<< "adJust         j      api  <Source arc.> <Action> ...  Replacing, deleting or renaming single entry in place." << std::endl << std::endl
 					<< "* Display modifiers:" << std::endl
 					<< "Modifier       Symbol Result" << std::endl
 					<< "ignore All     a      This modifier uses the following two at the same time." << std::endl
 					<< "ignore Pause   p      Pause at end of the program will be ignored." << std::endl
 					<< "ignore Info    i      All information output while the program is running will be skipped." << std::endl << std::endl
+					<< "* Options:" << std::endl
+					<< "--fst64        Packing modes create extended archive (FST64) for data larger than 4 GB." << std::endl
+					<< "--align=N      Packing and rebuild modes align data of entries to N bytes ('N:stored' - only uncompressed)." << std::endl
+					<< "--trace=FILE   Unpacking modes write access trace (paths of read entries) to FILE." << std::endl
+					<< "--order=FILE   Packing modes place data of entries in order of access trace FILE." << std::endl
+					<< "--memory=N     Limit memory of buffers and work in flight to N MB, show peak memory at the end." << std::endl
+					<< "--dry-run      Pack mode shows projected size and time without creating the archive." << std::endl
+					<< "--dictionary   Packing modes compress small text entries with shared dictionary (implies --fst64)." << std::endl
+					<< "--events=FILE  Write events of all steps of the run to FILE in Chrome trace format." << std::endl
+					<< "--resume       Unpacking modes continue interrupted unpacking by journal of completed entries." << std::endl
+					<< "--incremental  Unpacking modes skip unchanged output files ('=content' - compare content too)." << std::endl
+					<< "--nested       Show and unpack archives nested into the archive recursively (decoded in memory)." << std::endl
+					<< "--regex        Grep mode takes the text as regular expression." << std::endl
+					<< "--toc-order    Rebuild mode places data of entries in order of table of contents." << std::endl << std::endl
 					<< "To view full help, use '-h' command." << std::endl;
 	}
 	else
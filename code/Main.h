@@ -7,21 +7,53 @@
 #define FileH
 
 #include "FstFile.h"
+#include "FstDiff.h"
+#include "FstPatch.h"
+#include "FstCensus.h"
+#include "FstIndex.h"
+#include "FstGrep.h"
+#include "FstCompact.h"
+#include "FstEdit.h"
+#include "Listing.h"
 #include "FileMark.h"
 
 extern ErrorData LastError;///< Defined in ErrorDescription.cpp
 extern std::vector<std::string> FstFileErrorDescription;
 
-void Gap(cnv::dword, cnv::unsint);
-void Gap16(cnv::dword, cnv::unsint);
+void Gap(cnv::qword, cnv::unsint);
+void Gap16(cnv::qword, cnv::unsint);
 void ArchiveHead();
 void ArchiveEntry(cnv::unsint);
+void ArchiveTable();
+int  NestedTable();
+int  UnpackNested();
+void NestedReport();
 int  Show(char*);
+void SkippedInfo();
 int  Unpack(char*);
 int  Extract(char*, cnv::unsint);
+int  Range(char*, cnv::unsint, std::string, char*);
 int  List(char*);
 int  Pack(char*, char*);
+void PackInfo(char*);
+void DryRunInfo();
+int  PackDirectory(char*, char*, char*);
 int  Complex(char*);
+int  Diff(char*, char*);
+int  MakePatch(char*, char*, char*);
+int  ApplyPatch(char*, char*, char*);
+int  Census(char*);
+int  BuildIndex(char*, char*);
+int  FindPath(char*, char*);
+int  Grep(char*, char*, char*);
+void LayoutInfo();
+int  Layout(char*);
+int  Rebuild(char*, char*);
+int  Adjust(char*, std::string, std::string, char*);
+int  Output(char*, char*);
+void MemoryInfo();
+void ExportEvents();
+int  ApplyOption(std::string);
 #endif
 
 /// \mainpage FstFile technical documentation
\ No newline at end of file